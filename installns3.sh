@@ -53,6 +53,7 @@ cd ../../..
 pwd
 
 ln -sf $(pwd)/ns3/vanet/ $(pwd)/ns-3-dev/scratch/
+ln -sfn $(pwd)/ns3/vanet/test $(pwd)/ns-3-dev/scratch/vanet-test
 ln -sf $(pwd)/ns3/src/*.cc $(pwd)/ns3/src/*.h $(pwd)/ns-3-dev/contrib/nr/model/
 ln -sf $(pwd)/ns3/src/lte-model/* $(pwd)/ns-3-dev/src/lte/model/
 ln -sf $(pwd)/ns3/cmake/* $(pwd)/ns-3-dev/contrib/nr/
@@ -48,13 +48,17 @@ def main():
     bridge.start()
     
     try:
-        bridge.send_vehicles_num(10)
         sent = 0
+        first_tick = True
         while bridge.is_simulation_running():
-            vehicle_data = collect_vehicle_data(all_vehicles)
-            bridge.send_vehicles_position(vehicle_data)
-            if sent < 2:
-                time.sleep(2)
+            # States and carla_time come from the same snapshot, so ns-3 places the
+            # vehicles at the time they were actually sampled
+            snapshot = world.get_snapshot()
+            carla_time = snapshot.timestamp.elapsed_seconds
+            vehicle_data = collect_vehicle_data(all_vehicles, snapshot)
+            requests = []
+            # The first tick only places the vehicles; transfers start on the next ones
+            if not first_tick and sent < 2:
                 # bridge.send_transfer_requests([
                 #     {
                 #         "source": all_vehicles[1].id, 
@@ -73,7 +77,7 @@ def main():
                 #         "tx_power": 0.1
                 #     },
                 # ])
-                bridge.send_transfer_requests([
+                requests = [
                 # {"source":ego_vehicle.id, "target":all_vehicles[0].id, "size":500},
                 {"source":all_vehicles[1].id, "target":all_vehicles[2].id, "size":1000},
                 {"source":all_vehicles[1].id, "target":all_vehicles[2].id, "size":1000},
@@ -93,8 +97,13 @@ def main():
                 # # {"source":all_vehicles[1].id, "target":all_vehicles[8].id, "size":67002},
                 # # {"source":all_vehicles[1].id, "target":all_vehicles[9].id, "size":70002},
                 # # {"source":0, "target":2, "size":200},
-                ])
+                ]
                 sent += 1
+            # All inputs of the tick in one message; ns-3 answers with one tick_result
+            # (sync ack plus the receptions since the previous tick)
+            bridge.send_tick_bundle(vehicle_data, requests, carla_time,
+                                    vehicles_num=len(all_vehicles) if first_tick else None)
+            first_tick = False
             time.sleep(1)
             
     except KeyboardInterrupt:
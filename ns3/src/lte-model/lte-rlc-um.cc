@@ -36,6 +36,28 @@ NS_LOG_COMPONENT_DEFINE("LteRlcUm");
 
 NS_OBJECT_ENSURE_REGISTERED(LteRlcUm);
 
+/**
+ * Prepare the first segment S0 of an SDU for reassembly without materializing the
+ * virtual payload of the segments still to come.
+ *
+ * Application payloads are zero-area ("virtual") bytes. Packet::AddAtEnd() merges
+ * zero areas only if the head buffer is exclusively owned and ends in its zero
+ * area; otherwise it writes both sides out to real memory. A fragment cut from a
+ * received PDU never qualifies, so reassembling a large SDU used to allocate and
+ * zero-fill all of it. Appending an empty packet once gives S0 a private, flat
+ * copy (no larger than S0 itself) that ends in an empty zero area, so the zero
+ * bytes of the following segments stay virtual.
+ *
+ * \param s0 first segment of the SDU
+ * \return the segment to keep as m_keepS0
+ */
+static Ptr<Packet>
+KeepFirstSegment(Ptr<Packet> s0)
+{
+    s0->AddAtEnd(Create<Packet>());
+    return s0;
+}
+
 LteRlcUm::LteRlcUm()
     : m_maxTxBufferSize(99 * 1024 * 1024),
       m_txBufferSize(0),
@@ -757,7 +779,7 @@ LteRlcUm::ReassembleAndDeliver(Ptr<Packet> packet)
                 /**
                  * Keep S0
                  */
-                m_keepS0 = m_sdusBuffer.front();
+                m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                 m_sdusBuffer.pop_front();
                 break;
 
@@ -808,7 +830,7 @@ LteRlcUm::ReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
@@ -878,7 +900,7 @@ LteRlcUm::ReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
@@ -937,7 +959,7 @@ LteRlcUm::ReassembleAndDeliver(Ptr<Packet> packet)
                 /**
                  * Keep S0
                  */
-                m_keepS0 = m_sdusBuffer.front();
+                m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                 m_sdusBuffer.pop_front();
                 break;
 
@@ -988,7 +1010,7 @@ LteRlcUm::ReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
@@ -1044,7 +1066,7 @@ LteRlcUm::ReassembleAndDeliver(Ptr<Packet> packet)
                 /**
                  * Keep S0
                  */
-                m_keepS0 = m_sdusBuffer.front();
+                m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                 m_sdusBuffer.pop_front();
 
                 break;
@@ -1106,7 +1128,7 @@ LteRlcUm::ReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
@@ -2011,7 +2033,7 @@ LteRlcUm::NrSlReassembleAndDeliver(Ptr<Packet> packet)
                 /**
                  * Keep S0
                  */
-                m_keepS0 = m_sdusBuffer.front();
+                m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                 m_sdusBuffer.pop_front();
                 break;
 
@@ -2062,7 +2084,7 @@ LteRlcUm::NrSlReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
@@ -2132,7 +2154,7 @@ LteRlcUm::NrSlReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
@@ -2191,7 +2213,7 @@ LteRlcUm::NrSlReassembleAndDeliver(Ptr<Packet> packet)
                 /**
                  * Keep S0
                  */
-                m_keepS0 = m_sdusBuffer.front();
+                m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                 m_sdusBuffer.pop_front();
                 break;
 
@@ -2242,7 +2264,7 @@ LteRlcUm::NrSlReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
@@ -2298,7 +2320,7 @@ LteRlcUm::NrSlReassembleAndDeliver(Ptr<Packet> packet)
                 /**
                  * Keep S0
                  */
-                m_keepS0 = m_sdusBuffer.front();
+                m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                 m_sdusBuffer.pop_front();
 
                 break;
@@ -2360,7 +2382,7 @@ LteRlcUm::NrSlReassembleAndDeliver(Ptr<Packet> packet)
                     /**
                      * Keep S0
                      */
-                    m_keepS0 = m_sdusBuffer.front();
+                    m_keepS0 = KeepFirstSegment(m_sdusBuffer.front());
                     m_sdusBuffer.pop_front();
                 }
                 break;
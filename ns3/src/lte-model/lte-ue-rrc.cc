@@ -3618,13 +3618,17 @@ LteUeRrc::ActivateNrSlDrb(bool isTransmit, bool isReceive, const struct Sidelink
 
         if ((isTransmit && isReceive) || isReceive)
         {
-            // Do not call AddNrSlRxDrb() here; receive DRB will be added upon packet reception
-            std::set<uint8_t> bwpIdsSl = m_nrSlRrcSapUser->GetBwpIdContainer();
-            for (const auto& it : bwpIdsSl)
+            // Do not call AddNrSlRxDrb() here; receive DRB will be added upon packet reception.
+            // The SL BWPs are the ones with a MAC SAP, so walk those instead of copying
+            // the BWP id set for every bearer.
+            for (uint16_t bwpId = 0; bwpId < m_nrSlUeCmacSapProvider.size(); ++bwpId)
             {
-                NS_LOG_INFO("Communicating Rx destination to the MAC of SL BWP "
-                            << static_cast<uint16_t>(it));
-                m_nrSlUeCmacSapProvider.at(it)->AddNrSlRxDstL2Id(slInfoWithSrcId.m_dstL2Id);
+                if (m_nrSlUeCmacSapProvider[bwpId] == nullptr)
+                {
+                    continue;
+                }
+                NS_LOG_INFO("Communicating Rx destination to the MAC of SL BWP " << bwpId);
+                m_nrSlUeCmacSapProvider[bwpId]->AddNrSlRxDstL2Id(slInfoWithSrcId.m_dstL2Id);
             }
         }
 
@@ -3649,15 +3653,15 @@ LteUeRrc::ActivateNrSlDrb(bool isTransmit, bool isReceive, const struct Sidelink
          */
 
         // We are going to reuse RNTI assigned by the network for SL.
+        for (uint16_t bwpId = 0; bwpId < m_nrSlUeCmacSapProvider.size(); ++bwpId)
         {
-            std::set<uint8_t> slBwpIds = m_nrSlRrcSapUser->GetBwpIdContainer();
-            for (const auto& it : slBwpIds)
+            if (m_nrSlUeCmacSapProvider[bwpId] == nullptr)
             {
-                NS_LOG_INFO("Communicating RNTI " << m_rnti << " to PHY and MAC in  in BWP "
-                                                  << +it);
-                m_cphySapProvider.at(it)->SetRnti(m_rnti);
-                m_cmacSapProvider.at(it)->SetRnti(m_rnti);
+                continue;
             }
+            NS_LOG_INFO("Communicating RNTI " << m_rnti << " to PHY and MAC in  in BWP " << bwpId);
+            m_cphySapProvider.at(bwpId)->SetRnti(m_rnti);
+            m_cmacSapProvider.at(bwpId)->SetRnti(m_rnti);
         }
         // We use same SL-DRB creation and configuration logic than OOC
         if (isTransmit)
@@ -3676,12 +3680,14 @@ LteUeRrc::ActivateNrSlDrb(bool isTransmit, bool isReceive, const struct Sidelink
             Ptr<NrSlDataRadioBearerInfo> slDrbInfo = AddNrSlRxDrb(slInfoWithSrcId.m_srcL2Id,
                                                                   slInfoWithSrcId.m_dstL2Id,
                                                                   slInfoWithSrcId.m_lcId);
-            std::set<uint8_t> bwpIdsSl = m_nrSlRrcSapUser->GetBwpIdContainer();
-            for (const auto& it : bwpIdsSl)
+            for (uint16_t bwpId = 0; bwpId < m_nrSlUeCmacSapProvider.size(); ++bwpId)
             {
-                NS_LOG_INFO("Communicating Rx destination to the MAC of SL BWP "
-                            << static_cast<uint16_t>(it));
-                m_nrSlUeCmacSapProvider.at(it)->AddNrSlRxDstL2Id(slInfoWithSrcId.m_dstL2Id);
+                if (m_nrSlUeCmacSapProvider[bwpId] == nullptr)
+                {
+                    continue;
+                }
+                NS_LOG_INFO("Communicating Rx destination to the MAC of SL BWP " << bwpId);
+                m_nrSlUeCmacSapProvider[bwpId]->AddNrSlRxDstL2Id(slInfoWithSrcId.m_dstL2Id);
             }
         }
 
@@ -3833,10 +3839,8 @@ LteUeRrc::FinishSlDrbConfiguration(Ptr<NrSlDataRadioBearerInfo> slDrbInfo,
 {
     NS_LOG_FUNCTION(this << slDrbInfo << lcInfo);
 
-    // create PDCP/RLC stack
-    ObjectFactory rlcObjectFactory;
-    rlcObjectFactory.SetTypeId(LteRlcUm::GetTypeId());
-    Ptr<LteRlc> rlc = rlcObjectFactory.Create()->GetObject<LteRlc>();
+    // create PDCP/RLC stack; SL-DRBs are always RLC UM, so no ObjectFactory per bearer
+    Ptr<LteRlc> rlc = CreateObject<LteRlcUm>();
     rlc->SetNrSlMacSapProvider(m_nrSlMacSapProvider);
     rlc->SetRnti(m_rnti);
     rlc->SetLcId(slDrbInfo->m_logicalChannelIdentity);
@@ -3865,24 +3869,18 @@ LteUeRrc::FinishSlDrbConfiguration(Ptr<NrSlDataRadioBearerInfo> slDrbInfo,
 
     NS_ASSERT_MSG(numOfBwpsByBwpm != 0, "SL BWP manager failed to add SL LC for SL radio bearer");
 
-    uint8_t numOfSlBwps = m_nrSlRrcSapUser->GetBwpIdContainer().size();
+    // Only evaluated with asserts enabled: the BWP id set is not copied per bearer otherwise.
     NS_ASSERT_MSG(
-        numOfSlBwps == numOfBwpsByBwpm,
+        m_nrSlRrcSapUser->GetBwpIdContainer().size() == numOfBwpsByBwpm,
         " Bwp manager configured SL LC for incorrect number of SL BWPs : " << numOfBwpsByBwpm);
 
     NS_LOG_DEBUG("Size of slLcOnBwpMapping vector " << slLcOnBwpMapping.size());
 
-    std::vector<NrSlUeBwpmRrcSapProvider::SlLcInfoBwpm>::iterator itSlLcOnBwpMapping;
-
-    for (itSlLcOnBwpMapping = slLcOnBwpMapping.begin();
-         itSlLcOnBwpMapping != slLcOnBwpMapping.end();
-         ++itSlLcOnBwpMapping)
+    for (const auto& lcOnBwp : slLcOnBwpMapping)
     {
-        NS_LOG_DEBUG("RNTI " << m_rnti << " LCG id " << +itSlLcOnBwpMapping->lcInfo.lcGroup
-                             << " BWP Id " << +itSlLcOnBwpMapping->bwpId);
-        uint8_t bwpId = itSlLcOnBwpMapping->bwpId;
-        m_nrSlUeCmacSapProvider.at(bwpId)->AddNrSlLc(itSlLcOnBwpMapping->lcInfo,
-                                                     itSlLcOnBwpMapping->msu);
+        NS_LOG_DEBUG("RNTI " << m_rnti << " LCG id " << +lcOnBwp.lcInfo.lcGroup << " BWP Id "
+                             << +lcOnBwp.bwpId);
+        m_nrSlUeCmacSapProvider.at(lcOnBwp.bwpId)->AddNrSlLc(lcOnBwp.lcInfo, lcOnBwp.msu);
     }
 
     return slDrbInfo;
@@ -305,11 +305,33 @@ NrSlUeMacSchedulerFixedMcs::GetUpperBoundReselCounter(uint16_t pRsrv) const
     return uBound;
 }
 
+void
+NrSlUeMacSchedulerFixedMcs::SetSuspended(bool suspended)
+{
+    NS_LOG_FUNCTION(this << suspended);
+    m_suspended = suspended;
+    if (suspended)
+    {
+        m_grantInfo.clear();
+    }
+}
+
+bool
+NrSlUeMacSchedulerFixedMcs::IsSuspended() const
+{
+    return m_suspended;
+}
+
 void
 NrSlUeMacSchedulerFixedMcs::DoSchedNrSlTriggerReq(const SfnSf& sfn)
 {
     NS_LOG_FUNCTION(this << sfn);
 
+    if (m_suspended)
+    {
+        return;
+    }
+
     if (!GetMacHarq()->GetNumAvailableHarqIds())
     {
         // Cannot create new grants at this time but there may be existing
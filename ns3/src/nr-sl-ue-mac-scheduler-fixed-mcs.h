@@ -59,6 +59,22 @@ class NrSlUeMacSchedulerFixedMcs : public NrSlUeMacScheduler
      */
     ~NrSlUeMacSchedulerFixedMcs() override;
 
+    /**
+     * \brief Suspend or resume the scheduling of this UE
+     *
+     * While suspended, the per-slot trigger returns at once: no destination selection,
+     * LCP, sensing-based resource selection or grant publishing. Suspending drops the
+     * grants not published yet.
+     *
+     * \param suspended True to suspend, false to resume
+     */
+    void SetSuspended(bool suspended);
+    /**
+     * \brief Whether the scheduling of this UE is suspended
+     * \return True if suspended
+     */
+    bool IsSuspended() const;
+
   protected:
     void DoRemoveNrSlLcConfigReq(uint8_t lcid, uint32_t dstL2Id) override;
 
@@ -548,6 +564,7 @@ class NrSlUeMacSchedulerFixedMcs : public NrSlUeMacScheduler
     bool m_allowMultipleDestinationsPerSlot{
         false}; //!< Allow scheduling of multiple destinations in same slot
     mutable Ptr<NrSlUeMacHarq> m_nrSlUeMacHarq{nullptr}; //!< Pointer to cache object
+    bool m_suspended{false}; //!< No scheduling at all, e.g. while the UE is parked
 };
 
 } // namespace ns3
@@ -1,5 +1,6 @@
 #include "cam-application.h"
 #include "geo-networking.h"
+#include "link-kpi.h"
 #include "ns3/llc-snap-header.h"
 #include "ns3/log.h"
 #include "ns3/mac48-address.h"
@@ -11,11 +12,24 @@
 #include "ns3/socket.h"
 #include "ns3/internet-module.h"
 
+#include <algorithm>
+#include <cmath>
+
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE("CamApplication");
 
+namespace {
+// CAM generation triggers, ETSI EN 302 637-2 section 6.1.3
+constexpr double kCamHeadingDelta = 4.0;   // deg
+constexpr double kCamPositionDelta = 4.0;  // m
+constexpr double kCamSpeedDelta = 0.5;     // m/s
+const Time kGenCamMax = Seconds(1);
+// Below this speed the heading of the velocity vector is noise.
+constexpr double kCamHeadingMinSpeed = 0.1;  // m/s
+} // namespace
+
 NS_OBJECT_ENSURE_REGISTERED(CamSender);
 TypeId CamSender::GetTypeId() {
   static TypeId tid = TypeId("ns3::CamSender")
@@ -44,27 +58,132 @@ void CamSender::SetBroadcastAddress(Ipv4Address addr, uint16_t port) {
 void CamSender::SetInterval(const Time& interval) { m_interval = interval; }
 void CamSender::SetBroadcastRadius(const uint16_t radius) { m_radius = radius; }
 bool CamSender::IsRunning() { return m_running; };
-void CamSender::ScheduleCam(uint32_t bytes, Ipv4Address dest_addr) { 
-  Simulator::Schedule(MilliSeconds(0), [this, bytes, dest_addr] { SendCam(bytes, dest_addr); });
+void CamSender::ScheduleCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId) { 
+  Simulator::Schedule(MilliSeconds(0), [this, bytes, dest_addr, pktId] {
+    if (m_running) {  // the vehicle may have despawned in between
+      SendCam(bytes, dest_addr, pktId);
+    }
+  });
+}
+void CamSender::SendCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId) { std::cout << "[WARN] CamSender::SendCam should be overridden\n"; }
+void CamSender::SetMaxFragmentSize(const uint32_t bytes) { m_maxFragmentSize = std::max(bytes, 1u); }
+uint16_t CamSender::GetFragmentCount(uint32_t bytes) const {
+  const uint64_t count = (static_cast<uint64_t>(bytes) + m_maxFragmentSize - 1) / m_maxFragmentSize;
+  return static_cast<uint16_t>(std::clamp<uint64_t>(count, 1, UINT16_MAX));
+}
+uint32_t CamSender::GetFragmentSize(uint32_t bytes, uint16_t index, uint16_t count) {
+  return bytes / count + (index < bytes % count ? 1 : 0);
+}
+void CamSender::ReportTransmit(uint32_t bytes, Ipv4Address dest) {
+  if (m_kpi) {
+    m_kpi->OnTransmit(m_vehicleId, Simulator::Now().GetMilliSeconds(), dest, bytes);
+  }
+}
+Ptr<Packet> CamSender::CreateCam(uint32_t bytes, int32_t pktId, uint16_t index, uint16_t count) {
+  Ptr<MobilityModel> mobility = GetNode()->GetObject<MobilityModel>();
+  NS_ASSERT(mobility);
+  Vector pos = mobility->GetPosition();
+  Vector vel = mobility->GetVelocity();
+  double speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
+  double heading = std::atan2(vel.y, vel.x) * 180.0 / M_PI;
+
+  // Virtual payload: a zero area that carries only its size down the stack; the
+  // CamHeader in front holds everything the receiver reads.
+  Ptr<Packet> packet = Create<Packet>(bytes);
+  CamHeader camHeader;
+  camHeader.SetVehicleId(m_vehicleId);
+  camHeader.SetPositionX(pos.x);
+  camHeader.SetPositionY(pos.y);
+  camHeader.SetSpeed(speed);
+  camHeader.SetHeading(heading);
+  camHeader.SetTimestamp(Simulator::Now().GetMilliSeconds());
+  camHeader.SetPktId(pktId);
+  camHeader.SetFragment(index, count);
+  packet->AddHeader(camHeader);
+  return packet;
+}
+void CamSender::EnableAutoCam(CamTimerWheel* wheel, uint32_t bytes, Time jitter, Time notBefore) {
+  if (!m_camWheel) {
+    m_camTimer = wheel->Add([this] { CheckCamTriggers(); });
+  }
+  m_camWheel = wheel;
+  m_autoCamBytes = bytes;
+  m_camJitter = jitter;
+  m_autoCamNotBefore = notBefore;
+  if (m_running) {
+    StartAutoCam();
+  }
 }
-void CamSender::SendCam(uint32_t bytes, Ipv4Address dest_addr) { std::cout << "[WARN] CamSender::SendCam should be overridden\n"; }
 void CamSender::StartApplication() { m_running = true; }
 void CamSender::StopApplication() {
   m_running = false;
   if (m_sendEvent.IsPending()) {
     Simulator::Cancel(m_sendEvent);
   }
+  if (m_camWheel) {
+    m_camWheel->Cancel(m_camTimer);
+  }
+  m_camSent = false;  // a resumed slot carries a different vehicle
   if (m_socket) {
     m_socket->Close();
+    m_socket = nullptr;  // StartApplication() opens a new one
+  }
+}
+void CamSender::DoDispose() {
+  if (m_camWheel) {
+    m_camWheel->Remove(m_camTimer);
+    m_camWheel = nullptr;
   }
+  Application::DoDispose();
 }
 void CamSender::ScheduleNextCam() {
-  if (m_running) {
-    // Time jitter = MicroSeconds(m_jitterRng->GetInteger(0, 100000));
-    // Time nextTime = m_interval + jitter;
-    // m_sendEvent = Simulator::Schedule(nextTime, [this] { SendCam(); });
+  if (m_running && m_camWheel) {
+    const Time jitter = MicroSeconds(m_jitterRng->GetInteger(0, m_camJitter.GetMicroSeconds()));
+    m_camWheel->Arm(m_camTimer, m_interval + jitter);
+  }
+}
+void CamSender::StartAutoCam() {
+  if (!m_camWheel) {
+    return;
   }
+  // Random phase within one interval so that the fleet does not check in lockstep.
+  const Time holdoff = std::max(m_autoCamNotBefore - Simulator::Now(), Time(0));
+  const Time phase = MicroSeconds(m_jitterRng->GetInteger(0, m_interval.GetMicroSeconds()));
+  m_camWheel->Arm(m_camTimer, holdoff + phase);
 }
+void CamSender::CheckCamTriggers() {
+  if (!m_running) {
+    return;
+  }
+  Ptr<MobilityModel> mobility = GetNode()->GetObject<MobilityModel>();
+  const Vector pos = mobility->GetPosition();
+  const Vector vel = mobility->GetVelocity();
+  const double speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
+  const double heading = std::atan2(vel.y, vel.x) * 180.0 / M_PI;
+  const Time now = Simulator::Now();
+
+  bool trigger = !m_camSent || now - m_lastCamTime >= kGenCamMax;
+  if (!trigger) {
+    const double dx = pos.x - m_lastCamPos.x;
+    const double dy = pos.y - m_lastCamPos.y;
+    trigger = std::sqrt(dx * dx + dy * dy) > kCamPositionDelta ||
+              std::abs(speed - m_lastCamSpeed) > kCamSpeedDelta ||
+              (speed >= kCamHeadingMinSpeed &&
+               std::abs(std::remainder(heading - m_lastCamHeading, 360.0)) > kCamHeadingDelta);
+  }
+  if (trigger) {
+    SendAutoCam(m_autoCamBytes);
+    m_camSent = true;
+    m_lastCamTime = now;
+    m_lastCamPos = pos;
+    m_lastCamSpeed = speed;
+    if (speed >= kCamHeadingMinSpeed) {
+      m_lastCamHeading = heading;
+    }
+  }
+  ScheduleNextCam();
+}
+void CamSender::SendAutoCam(uint32_t bytes) { SendCam(bytes, m_broadcastAddr); }
 
 NS_OBJECT_ENSURE_REGISTERED(CamReceiver);
 TypeId CamReceiver::GetTypeId() {
@@ -74,33 +193,102 @@ TypeId CamReceiver::GetTypeId() {
                           .AddConstructor<CamReceiver>();
   return tid;
 }
-CamReceiver::CamReceiver() : m_socket(nullptr), m_vehicleId(0), m_packetsReceived(0) {}
+CamReceiver::CamReceiver() : m_socket(nullptr), m_vehicleId(0), m_packetsReceived(0) {
+  m_transfers.SetCallback([this](const TransferTracker::Completion& transfer) { ReportTransfer(transfer); });
+}
 CamReceiver::~CamReceiver() { m_socket = nullptr; }
-void CamReceiver::SetVehicleId(const uint32_t id) { m_vehicleId = id; }
+void CamReceiver::SetVehicleId(const uint32_t id) {
+  m_vehicleId = id;
+  if (m_kpi) {
+    // Bound to a (new) CARLA id: the KPIs follow the id its CAMs are matched by.
+    m_kpi->AddVehicle(m_vehicleId, m_addr, GetNode()->GetObject<MobilityModel>());
+  }
+}
 void CamReceiver::SetIp(const Ipv4Address& addr) { m_addr = addr; }
 void CamReceiver::SetPort(const uint16_t port) { m_port = port; }
 void CamReceiver::SetReplyFunction(std::function<void(const std::string&)> replyFunction) {
   m_replyFunction = replyFunction;
 }
+void CamReceiver::SetGroupFilter(std::function<bool(uint32_t, uint64_t, uint32_t, double)> filter) {
+  m_groupFilter = filter;
+}
 void CamReceiver::StartApplication() {}
 void CamReceiver::StopApplication() {}
 void CamReceiver::HandleRead(Ptr<Socket> socket) { std::cout << "[WARN] CamReceiver::HandleRead should be overridden\n"; }
+void CamReceiver::ReceiveCam(const CamHeader& camHeader, uint32_t payloadBytes) {
+  m_packetsReceived++;
+  m_transfers.Receive(camHeader.GetVehicleId(), camHeader.GetPktId(), camHeader.GetTimestamp(),
+                      camHeader.GetFragmentIndex(), camHeader.GetFragmentCount(), payloadBytes);
+}
+void CamReceiver::SetKpi(LinkKpi* kpi) {
+  m_kpi = kpi;
+  m_kpi->AddVehicle(m_vehicleId, m_addr, GetNode()->GetObject<MobilityModel>());
+  m_kpi->SetListening(m_vehicleId, static_cast<bool>(m_socket));
+}
+void CamReceiver::SetListening(bool listening) {
+  if (m_kpi) {
+    m_kpi->SetListening(m_vehicleId, listening);
+  }
+}
+void CamReceiver::ReportTransfer(const TransferTracker::Completion& transfer) {
+  if (m_kpi) {
+    const Time sent = MilliSeconds(transfer.sendTimeMs);
+    m_kpi->OnDelivered(transfer.senderId, m_vehicleId, transfer.sendTimeMs, transfer.firstRx - sent,
+                       transfer.lastRx - sent, transfer.bytes, transfer.complete);
+  }
+  if (!m_replyFunction) {
+    return;
+  }
+  // One record per transfer: receive_timestamp is the last fragment, packet_size the
+  // payload of all fragments received.
+  const int64_t firstRx = transfer.firstRx.GetMilliSeconds();
+  const int64_t lastRx = transfer.lastRx.GetMilliSeconds();
+  const int64_t sent = static_cast<int64_t>(transfer.sendTimeMs);
+  try {
+    std::string msg = R"({"type":"cam_received",)"
+                      R"("sender_id":)" + std::to_string(transfer.senderId) +
+                      R"(,"receiver_id":)" + std::to_string(m_vehicleId) +
+                      R"(,"pkt_id":)" + std::to_string(transfer.pktId) +
+                      R"(,"receive_timestamp":)" + std::to_string(lastRx) +
+                      R"(,"first_receive_timestamp":)" + std::to_string(firstRx) +
+                      R"(,"send_timestamp":)" + std::to_string(transfer.sendTimeMs) +
+                      R"(,"first_byte_latency":)" + std::to_string(firstRx - sent) +
+                      R"(,"last_byte_latency":)" + std::to_string(lastRx - sent) +
+                      R"(,"packet_size":)" + std::to_string(transfer.bytes) +
+                      R"(,"fragments":)" + std::to_string(transfer.fragments) +
+                      R"(,"fragments_received":)" + std::to_string(transfer.received) +
+                      R"(,"complete":)" + (transfer.complete ? "true" : "false") +
+                      R"(,"is_last_packet":)" + std::to_string(transfer.complete) +
+                      R"(})";
+    // Only a queue push; the bridge thread batches the actual writes.
+    m_replyFunction(msg);
+  } catch (std::exception& e) {
+    NS_LOG_ERROR("CamReceiver::ReportTransfer m_replyFunction error: " << e.what());
+  } catch (...) {
+    NS_LOG_ERROR("CamReceiver::ReportTransfer m_replyFunction: unknown exception caught");
+  }
+}
 
 // ==================== DSRC derived classes ====================
 NS_OBJECT_ENSURE_REGISTERED(CamSenderDSRC);
 void CamSenderDSRC::StartApplication() {
+  if (m_suspended) {
+    return;  // parked; Resume() restarts it
+  }
   m_running = true;
 
   if (!m_socket) {
     m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+    m_socket->SetAllowBroadcast(true);  // autonomous CAMs
   }
+  StartAutoCam();
 }
 
 void CamSenderDSRC::StopApplication() {
   CamSender::StopApplication();
 }
 
-void CamSenderDSRC::SendCam(uint32_t bytes, Ipv4Address dest_addr) {
+void CamSenderDSRC::SendCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId) {
 
   NS_ASSERT(m_running);
   NS_ASSERT(m_socket);
@@ -109,45 +297,36 @@ void CamSenderDSRC::SendCam(uint32_t bytes, Ipv4Address dest_addr) {
   NS_ASSERT(mobility);
 
   Vector pos = mobility->GetPosition();
-  Vector vel = mobility->GetVelocity();
-  double speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
-  double heading = std::atan2(vel.y, vel.x) * 180.0 / M_PI;
-
-  Ptr<Packet> packet = Create<Packet>(bytes);
-
-  CamHeader camHeader;
-  camHeader.SetVehicleId(m_vehicleId);
-  camHeader.SetPositionX(pos.x);
-  camHeader.SetPositionY(pos.y);
-  camHeader.SetSpeed(speed);
-  camHeader.SetHeading(heading);
-  camHeader.SetTimestamp(Simulator::Now().GetMilliSeconds());
-  packet->AddHeader(camHeader);
+  InetSocketAddress destination = InetSocketAddress(dest_addr, m_port); // dest port
+  // m_socket->SetAllowBroadcast(true);
 
-  GeoNetHeader geoHeader;
-  geoHeader.SetVersion(1);
-  geoHeader.SetNextHeader(PROT_NUM_CAM);
-  geoHeader.SetMessageType(GeoNetHeader::GEOBROADCAST);
-  geoHeader.SetSourcePosition(pos.x, pos.y);
-  geoHeader.SetSourceId(m_vehicleId);
-  geoHeader.SetRadius(m_radius);
-  geoHeader.SetLifetime(10);
-  packet->AddHeader(geoHeader);
+  const uint16_t count = GetFragmentCount(bytes);
+  for (uint16_t i = 0; i < count; ++i) {
+    Ptr<Packet> packet = CreateCam(GetFragmentSize(bytes, i, count), pktId, i, count);
 
-  LlcSnapHeader llc;
-  llc.SetType(PROT_NUM_GEONETWORKING);
-  packet->AddHeader(llc);
+    GeoNetHeader geoHeader;
+    geoHeader.SetVersion(1);
+    geoHeader.SetNextHeader(PROT_NUM_CAM);
+    geoHeader.SetMessageType(GeoNetHeader::GEOBROADCAST);
+    geoHeader.SetSourcePosition(pos.x, pos.y);
+    geoHeader.SetSourceId(m_vehicleId);
+    geoHeader.SetRadius(m_radius);
+    geoHeader.SetLifetime(10);
+    packet->AddHeader(geoHeader);
 
-  InetSocketAddress destination = InetSocketAddress(dest_addr, m_port); // dest port
-  // m_socket->SetAllowBroadcast(true);
+    LlcSnapHeader llc;
+    llc.SetType(PROT_NUM_GEONETWORKING);
+    packet->AddHeader(llc);
 
-  m_socket->SendTo(packet, 0, destination);
+    m_socket->SendTo(packet, 0, destination);
+    m_packetsSent++;
+  }
+  ReportTransmit(bytes, dest_addr);
 
-  m_packetsSent++;
   NS_LOG_INFO("Vehicle " << m_vehicleId << "(ip = " << m_addr << ") sent CAM at "
                          << Simulator::Now().GetSeconds() << "s"
                          << " Position: (" << pos.x << "," << pos.y << ")"
-                         << " Speed: " << speed << " Heading: " << heading << " size: " << packet->GetSize() << " bytes"
+                         << " pkt_id: " << pktId << " size: " << bytes << " bytes in " << count << " fragments"
                          << " Dest: " << dest_addr << ":" << m_port);
 }
 
@@ -167,6 +346,9 @@ TypeId CamSenderDSRC::GetTypeId() {
   return tid;
 }
 void CamReceiverDSRC::StartApplication() {
+  if (m_suspended) {
+    return;  // parked; Resume() restarts it
+  }
   if (!m_socket) {
     m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
     InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), m_port);
@@ -174,17 +356,21 @@ void CamReceiverDSRC::StartApplication() {
   }
 
   m_socket->SetRecvCallback(MakeCallback(&CamReceiverDSRC::HandleRead, this));
+  SetListening(true);
 }
 
 void CamReceiverDSRC::StopApplication() {
+  m_transfers.Flush();
+  SetListening(false);
   if (m_socket) {
     m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
     m_socket->Close();
+    m_socket = nullptr;
   }
 }
 
 void CamReceiverDSRC::HandleRead(Ptr<Socket> socket) {
-  std::cout << "[DEBUG] CamReceiverDSRC::HandleRead called\n";
+  NS_LOG_FUNCTION(this << socket);
   Ptr<Packet> packet;
   Address from;
 
@@ -192,7 +378,7 @@ void CamReceiverDSRC::HandleRead(Ptr<Socket> socket) {
     InetSocketAddress inetAddr = InetSocketAddress::ConvertFrom(from);
     Ipv4Address src = inetAddr.GetIpv4();
     uint16_t srcPort = inetAddr.GetPort();
-    std::cout << "[DEBUG] CamReceiverDSRC::HandleRead received packet from " << src << ":" << srcPort << ", size: " << packet->GetSize() << " bytes\n";
+    NS_LOG_DEBUG("CamReceiverDSRC::HandleRead received packet from " << src << ":" << srcPort << ", size: " << packet->GetSize() << " bytes");
     LlcSnapHeader llc;
     packet->RemoveHeader(llc);
 
@@ -207,7 +393,7 @@ void CamReceiverDSRC::HandleRead(Ptr<Socket> socket) {
       double dx = myPos.x - geoHeader.GetSourcePositionX();
       double dy = myPos.y - geoHeader.GetSourcePositionY();
       double distance = std::sqrt(dx * dx + dy * dy);
-      std::cout << "[DEBUG] CamReceiverDSRC::HandleRead distance: " << distance << ", radius: " << geoHeader.GetRadius() << "\n";
+      NS_LOG_DEBUG("CamReceiverDSRC::HandleRead distance: " << distance << ", radius: " << geoHeader.GetRadius());
       if (distance <= geoHeader.GetRadius()) {
         if (geoHeader.GetNextHeader() == PROT_NUM_CAM) {
           CamHeader camHeader;
@@ -225,31 +411,12 @@ void CamReceiverDSRC::HandleRead(Ptr<Socket> socket) {
                       << " Timestamp: " << camHeader.GetTimestamp() << " ms"
                       << " Distance: " << distance << "m"
                       << " GeoNet sourceId: " << geoHeader.GetSourceId()
+                      << " pkt_id: " << camHeader.GetPktId()
+                      << " Fragment: " << camHeader.GetFragmentIndex() + 1 << "/" << camHeader.GetFragmentCount()
                       << " Packet size: " << packetSize << " bytes"
                     );
 
-          m_packetsReceived++;
-
-          try{
-            if(m_replyFunction) {
-              std::string msg = R"({"type":"cam_received",)"
-                                R"("sender_id":)" + std::to_string(camHeader.GetVehicleId()) +
-                                R"(,"receiver_id":)" + std::to_string(m_vehicleId) + 
-                                R"(,"receive_timestamp":)" + std::to_string(Simulator::Now().GetMilliSeconds()) +
-                                R"(,"send_timestamp":)" + std::to_string(camHeader.GetTimestamp()) +
-                                R"(,"packet_size":)" + std::to_string(packetSize) +
-                                R"(,"is_last_packet":)" + std::to_string(true) + 
-                                R"(})";
-              // m_replyFunction(msg);
-                Simulator::ScheduleNow([this, msg]() {
-                    m_replyFunction(msg);
-                });
-            }
-          } catch(std::exception &e){ 
-            NS_LOG_ERROR("CamReceiver::HandleRead m_replyFunction error: " << e.what());
-          } catch (...) { 
-            NS_LOG_ERROR("CamReceiver::HandleRead m_replyFunction: unknown exception caught");
-          }
+          ReceiveCam(camHeader, packetSize);
         }
       } else {
         NS_LOG_INFO("Node " << GetNode()->GetId() << " (Vehicle " << m_vehicleId << ")" 
@@ -266,6 +433,9 @@ void CamReceiverDSRC::HandleRead(Ptr<Socket> socket) {
 NS_OBJECT_ENSURE_REGISTERED(CamSenderNR);
 
 void CamSenderNR::StartApplication() {
+  if (m_suspended) {
+    return;  // parked; Resume() restarts it
+  }
   m_running = true;
   if (!m_socket) {
     m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
@@ -276,9 +446,10 @@ void CamSenderNR::StartApplication() {
       return;
     }
   }
+  StartAutoCam();
 }
 
-void CamSenderNR::SendCam(uint32_t bytes, Ipv4Address dest_addr)
+void CamSenderNR::SendCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId)
 {
     // bytes = 1000;
     // std::cout << "CamSenderNR::SendCam(uint32_t bytes, Ipv4Address dest_addr)\n";
@@ -288,31 +459,20 @@ void CamSenderNR::SendCam(uint32_t bytes, Ipv4Address dest_addr)
     NS_ASSERT(mobility);
 
     InetSocketAddress destination = InetSocketAddress(dest_addr, m_port); // dest port
-    // InetSocketAddress destination = InetSocketAddress(Ipv4Address("225.0.0.0"), m_port); // dest port
-    Ptr<Packet> packet = Create<Packet>(bytes);
-
     Vector pos = mobility->GetPosition();
-    Vector vel = mobility->GetVelocity();
-    double speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
-    double heading = std::atan2(vel.y, vel.x) * 180.0 / M_PI;
-    CamHeader camHeader;
-    camHeader.SetVehicleId(m_vehicleId);
-    camHeader.SetPositionX(pos.x);
-    camHeader.SetPositionY(pos.y);
-    camHeader.SetSpeed(speed);
-    camHeader.SetHeading(heading);
-    camHeader.SetTimestamp(Simulator::Now().GetMilliSeconds());
-    packet->AddHeader(camHeader);
 
     // std::cout << "Addheader\n";
 
-    m_socket->SendTo(packet, 0, destination);
-
-    m_packetsSent++;
+    const uint16_t count = GetFragmentCount(bytes);
+    for (uint16_t i = 0; i < count; ++i) {
+        m_socket->SendTo(CreateCam(GetFragmentSize(bytes, i, count), pktId, i, count), 0, destination);
+        m_packetsSent++;
+    }
+    ReportTransmit(bytes, dest_addr);
     NS_LOG_INFO("Vehicle " << m_vehicleId << "(ip = " << m_addr << ") sent CAM at "
                   << Simulator::Now().GetSeconds() << "s"
                   << " Position: (" << pos.x << "," << pos.y << ")"
-                  << " Speed: " << speed << " Heading: " << heading << " size: " << packet->GetSize() << " bytes"
+                  << " pkt_id: " << pktId << " size: " << bytes << " bytes in " << count << " fragments"
                   << " Dest: " << dest_addr << ":" << m_port
               );
 }
@@ -329,60 +489,108 @@ void CamSenderNR::StopApplication() {
 }
 
 void CamSenderNR::ScheduleCam(uint32_t bytes, Ipv4Address dest_addr, 
-                               uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id) { 
+                               uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id,
+                               int32_t pktId) { 
   const Time sendDelay = Simulator::Now().IsZero() ? MilliSeconds(20) : MilliSeconds(0);
-  Simulator::Schedule(sendDelay, [this, bytes, dest_addr, sc_start, sc_num, tx_power, src_L2Id, dest_L2Id] { 
-    SendCam(bytes, dest_addr, sc_start, sc_num, tx_power, src_L2Id, dest_L2Id); 
+  Simulator::Schedule(sendDelay, [this, bytes, dest_addr, sc_start, sc_num, tx_power, src_L2Id, dest_L2Id, pktId] { 
+    if (m_running) {  // the vehicle may have despawned in between
+      SendCam(bytes, dest_addr, sc_start, sc_num, tx_power, src_L2Id, dest_L2Id, pktId); 
+    }
   });
 }
 
 void CamSenderNR::SendCam(uint32_t bytes, Ipv4Address dest_addr, 
-                               uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id)
+                               uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id,
+                               int32_t pktId)
 {
-  NS_LOG_FUNCTION(this << bytes << dest_addr << (uint32_t)sc_start << (uint32_t)sc_num << tx_power << dest_L2Id);
-  
-  Ptr<Packet> packet = Create<Packet>(bytes);
-
-  Ptr<MobilityModel> mobility = GetNode()->GetObject<MobilityModel>();
-  Vector pos = mobility->GetPosition();
-  Vector vel = mobility->GetVelocity();
-  double speed = std::sqrt(vel.x * vel.x + vel.y * vel.y);
-  double heading = std::atan2(vel.y, vel.x) * 180.0 / M_PI;
-  CamHeader camHeader;
-  camHeader.SetVehicleId(m_vehicleId);
-  camHeader.SetPositionX(pos.x);
-  camHeader.SetPositionY(pos.y);
-  camHeader.SetSpeed(speed);
-  camHeader.SetHeading(heading);
-  camHeader.SetTimestamp(Simulator::Now().GetMilliSeconds());
-  packet->AddHeader(camHeader);
-
-  // std::cout << "packet created\n";
+  NS_LOG_FUNCTION(this << bytes << dest_addr << (uint32_t)sc_start << (uint32_t)sc_num << tx_power << dest_L2Id << pktId);
 
     // 获取发送方和接收方的 L2 ID
   uint32_t srcL2Id = src_L2Id; // 使用传入的发送方 L2 ID
   uint32_t dstL2Id = dest_L2Id; // 使用传入的接收方 L2 ID
 
-  // 构建 CARLA 传输指令
-  CarlaTxCommand cmd;
-  cmd.srcL2Id = srcL2Id;
-  cmd.dstL2Id = dstL2Id;
-  cmd.maxDataSize = (int)packet->GetSize() + 35; // 包含头部的总数据大小
-  cmd.slSubchannelStart = sc_start;
-  cmd.slSubchannelSize = sc_num;
-  // cmd.txPower = tx_power;
-
-  // 调用调度器接口，下发指令
-  m_scheduler->AddCarlaTxCommand(cmd);
-  
-  // std::cout << "CarlaTxCommand added to scheduler\n";
-
   InetSocketAddress destination = InetSocketAddress(dest_addr, m_port);
-  m_socket->SendTo(packet, 0, destination);
+  const uint16_t count = GetFragmentCount(bytes);
+  for (uint16_t i = 0; i < count; ++i) {
+    Ptr<Packet> packet = CreateCam(GetFragmentSize(bytes, i, count), pktId, i, count);
+
+    // 构建 CARLA 传输指令
+    CarlaTxCommand cmd;
+    cmd.srcL2Id = srcL2Id;
+    cmd.dstL2Id = dstL2Id;
+    cmd.maxDataSize = (int)packet->GetSize() + 35; // 包含头部的总数据大小
+    cmd.slSubchannelStart = sc_start;
+    cmd.slSubchannelSize = sc_num;
+    // cmd.txPower = tx_power;
+
+    // 调用调度器接口，下发指令
+    m_scheduler->AddCarlaTxCommand(cmd);
+
+    m_socket->SendTo(packet, 0, destination);
+    m_packetsSent++;
+  }
+  ReportTransmit(bytes, dest_addr);
 
   std::cout << "CamSenderNR: scheduled CAM, srcL2Id=" << srcL2Id << ", dstL2Id=" << dstL2Id
               << ", Subchannel=[" << (uint32_t)sc_start << ", " << (uint32_t)(sc_start+sc_num-1) << "]"
-              << ", size=" << packet->GetSize() << " bytes\n";
+              << ", pkt_id=" << pktId << ", size=" << bytes << " bytes in " << count << " fragments\n";
+}
+
+void CamSenderNR::SetGroup(Ipv4Address addr, uint16_t port, uint32_t l2Id) {
+  m_groupAddr = addr;
+  m_groupPort = port;
+  m_groupL2Id = l2Id;
+}
+
+Time CamSenderNR::ScheduleGroupCam(uint32_t bytes, uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id,
+                                   int32_t pktId) {
+  const Time sendDelay = Simulator::Now().IsZero() ? MilliSeconds(20) : MilliSeconds(0);
+  Simulator::Schedule(sendDelay, [this, bytes, sc_start, sc_num, tx_power, src_L2Id, pktId] {
+    if (m_running) {  // the vehicle may have despawned in between
+      SendGroupCam(bytes, sc_start, sc_num, tx_power, src_L2Id, pktId);
+    }
+  });
+  return Simulator::Now() + sendDelay;
+}
+
+void CamSenderNR::SendGroupCam(uint32_t bytes, uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id,
+                               int32_t pktId)
+{
+  NS_LOG_FUNCTION(this << bytes << (uint32_t)sc_start << (uint32_t)sc_num << tx_power << pktId);
+  NS_ASSERT(m_running);
+  NS_ASSERT(m_socket);
+
+  const uint16_t count = GetFragmentCount(bytes);
+  for (uint16_t i = 0; i < count; ++i) {
+    Ptr<Packet> packet = CreateCam(GetFragmentSize(bytes, i, count), pktId, i, count);
+    if (sc_num > 0) {
+      CarlaTxCommand cmd;
+      cmd.srcL2Id = src_L2Id;
+      cmd.dstL2Id = m_groupL2Id;
+      cmd.maxDataSize = (int)packet->GetSize() + 35; // 包含头部的总数据大小
+      cmd.slSubchannelStart = sc_start;
+      cmd.slSubchannelSize = sc_num;
+      m_scheduler->AddCarlaTxCommand(cmd);
+    }
+    m_socket->SendTo(packet, 0, InetSocketAddress(m_groupAddr, m_groupPort));
+    m_packetsSent++;
+  }
+  ReportTransmit(bytes, m_groupAddr);
+
+  if (sc_num > 0) {
+    std::cout << "CamSenderNR: scheduled group CAM, srcL2Id=" << src_L2Id << ", dstL2Id=" << m_groupL2Id
+              << ", Subchannel=[" << (uint32_t)sc_start << ", " << (uint32_t)(sc_start+sc_num-1) << "]"
+              << ", pkt_id=" << pktId << ", size=" << bytes << " bytes in " << count << " fragments\n";
+  } else {
+    NS_LOG_INFO("Vehicle " << m_vehicleId << " sent group CAM at " << Simulator::Now().GetSeconds()
+                << "s, pkt_id=" << pktId << ", size=" << bytes << " bytes in " << count << " fragments");
+  }
+}
+
+void CamSenderNR::SendAutoCam(uint32_t bytes) {
+  if (m_groupPort != 0) {
+    SendGroupCam(bytes, 0, 0, 0.0, 0);
+  }
 }
 
 Ptr<NrSlUeMacSchedulerManual> CamSenderNR::GetScheduler()
@@ -416,23 +624,50 @@ TypeId CamReceiverNR::GetTypeId() {
 }
 
 void CamReceiverNR::StartApplication() {
+  if (m_suspended) {
+    return;  // parked; Resume() restarts it
+  }
   if (!m_socket) {
     m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
     InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), m_port);
     m_socket->Bind(local);
   }
   m_socket->SetRecvCallback(MakeCallback(&CamReceiverNR::HandleRead, this));
+  if (m_groupPort != 0) {
+    if (!m_groupSocket) {
+      m_groupSocket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+      m_groupSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_groupPort));
+    }
+    m_groupSocket->SetRecvCallback(MakeCallback(&CamReceiverNR::HandleGroupRead, this));
+  }
+  SetListening(true);
 }
 
 void CamReceiverNR::StopApplication() {
+    m_transfers.Flush();
+    SetListening(false);
     if (m_socket) {
         m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
         m_socket->Close();
+        m_socket = nullptr;
+    }
+    if (m_groupSocket) {
+        m_groupSocket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        m_groupSocket->Close();
+        m_groupSocket = nullptr;
     }
 }
 
 void CamReceiverNR::HandleRead(Ptr<Socket> socket) {
-    std::cout << "CamReceiverNR::HandleRead\n";
+    Receive(socket, false);
+}
+
+void CamReceiverNR::HandleGroupRead(Ptr<Socket> socket) {
+    Receive(socket, true);
+}
+
+void CamReceiverNR::Receive(Ptr<Socket> socket, bool group) {
+    NS_LOG_FUNCTION(this << socket << group);
     Ptr<Packet> packet;
     Address from;
     while ((packet = socket->RecvFrom(from))) {
@@ -451,30 +686,20 @@ void CamReceiverNR::HandleRead(Ptr<Socket> socket) {
                     << " Speed: " << camHeader.GetSpeed()
                     << " Heading: " << camHeader.GetHeading()
                     << " Timestamp: " << camHeader.GetTimestamp() << " ms"
+                    << " pkt_id: " << camHeader.GetPktId()
+                    << " Fragment: " << camHeader.GetFragmentIndex() + 1 << "/" << camHeader.GetFragmentCount()
                     << " Packet size: " << packetSize << " bytes"
                     << " Src IP: " << src << ":" << srcPort);
-        m_packetsReceived++;
-        try {
-            if (m_replyFunction) {
-                std::string msg = R"({"type":"cam_received",)"
-                                  R"("sender_id":)" + std::to_string(camHeader.GetVehicleId()) +
-                                  R"(,"receiver_id":)" + std::to_string(m_vehicleId) +
-                                  R"(,"receive_timestamp":)" + std::to_string(Simulator::Now().GetMilliSeconds()) +
-                                  R"(,"send_timestamp":)" + std::to_string(camHeader.GetTimestamp()) +
-                                  R"(,"packet_size":)" + std::to_string(packetSize) +
-                                  R"(,"is_last_packet":)" + std::to_string(true) +
-                                  R"(})";
-                // m_replyFunction(msg);
-                // 异步调度发送，避免阻塞HandleRead
-                Simulator::ScheduleNow([this, msg]() {
-                    m_replyFunction(msg);
-                });
+        if (group && m_groupFilter) {
+            Vector myPos = GetNode()->GetObject<MobilityModel>()->GetPosition();
+            double dx = myPos.x - camHeader.GetPositionX();
+            double dy = myPos.y - camHeader.GetPositionY();
+            if (!m_groupFilter(camHeader.GetVehicleId(), camHeader.GetTimestamp(), m_vehicleId,
+                               std::sqrt(dx * dx + dy * dy))) {
+                continue;  // overheard, but not addressed to this vehicle
             }
-        } catch (std::exception& e) {
-            NS_LOG_ERROR("CamReceiverNR::HandleRead m_replyFunction error: " << e.what());
-        } catch (...) {
-            NS_LOG_ERROR("CamReceiverNR::HandleRead unknown exception");
         }
+        ReceiveCam(camHeader, packetSize);
     }
 }
 
@@ -13,28 +13,59 @@
 #include "ns3/nr-module.h"
 #include "ns3/onoff-application.h"
 
+#include "cam-timer-wheel.h"
+#include "transfer-tracker.h"
+
 namespace ns3 {
 
+class CamHeader;
+class LinkKpi;
+
 class CamSender : public Application {
 public:
     static TypeId GetTypeId();
     CamSender();
     ~CamSender() override;
     virtual void SetVehicleId(uint32_t id);
+    uint32_t GetVehicleId() const { return m_vehicleId; }
     virtual void SetIp(const Ipv4Address& addr);
     virtual void SetPort(uint16_t port);
     virtual void SetBroadcastAddress(Ipv4Address addr, uint16_t port);
     virtual void SetInterval(const Time& interval);
     virtual void SetBroadcastRadius(uint16_t radius);
-    virtual void ScheduleCam(uint32_t bytes, Ipv4Address dest_addr);
-    virtual void SendCam(uint32_t bytes, Ipv4Address dest_addr);
+    // pktId is the CARLA packet id reported back on reception, -1 for none.
+    virtual void ScheduleCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId = -1);
+    virtual void SendCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId = -1);
+    // Transfers larger than this are sent as several CAMs that the receiver reassembles.
+    void SetMaxFragmentSize(uint32_t bytes);
+    // Reports every transfer to `kpi`, if set.
+    void SetKpi(LinkKpi* kpi) { m_kpi = kpi; }
+    // Autonomous CAMs per ETSI EN 302 637-2: checked every interval (T_GenCamMin) plus
+    // up to `jitter`, sent on a heading/position/speed change or once T_GenCamMax has
+    // passed. The checks of all senders share `wheel`. Nothing is sent before `notBefore`.
+    void EnableAutoCam(CamTimerWheel* wheel, uint32_t bytes, Time jitter, Time notBefore);
     bool IsRunning();
+    // Stop/restart outside the start/stop times, for pooled vehicle slots. A suspended
+    // sender ignores a start that is still scheduled.
+    void Suspend() { m_suspended = true; StopApplication(); }
+    void Resume() { m_suspended = false; StartApplication(); }
 
 protected:
     // Application lifecycle hooks (to be overridden)
     void StartApplication() override;
     void StopApplication() override;
+    void DoDispose() override;
     virtual void ScheduleNextCam();
+    // Where autonomous CAMs go; by default a broadcast to m_broadcastAddr.
+    virtual void SendAutoCam(uint32_t bytes);
+    void StartAutoCam();
+    void CheckCamTriggers();
+    uint16_t GetFragmentCount(uint32_t bytes) const;
+    // Payload of fragment `index`; the first ones carry the remainder.
+    static uint32_t GetFragmentSize(uint32_t bytes, uint16_t index, uint16_t count);
+    // Virtual payload of `bytes` behind a CamHeader stamped with the current state.
+    Ptr<Packet> CreateCam(uint32_t bytes, int32_t pktId, uint16_t index, uint16_t count);
+    void ReportTransmit(uint32_t bytes, Ipv4Address dest);
 
     Ptr<Socket> m_socket;
     Ipv4Address m_addr;
@@ -45,8 +76,23 @@ protected:
     uint16_t m_radius;
     EventId m_sendEvent;
     bool m_running;
+    bool m_suspended{false};
     uint32_t m_packetsSent;
+    uint32_t m_maxFragmentSize{65000};  // below the 65507-byte UDP limit with the headers
+    LinkKpi* m_kpi{nullptr};
     Ptr<UniformRandomVariable> m_jitterRng;
+
+    CamTimerWheel* m_camWheel{nullptr};
+    CamTimerWheel::TimerId m_camTimer{0};
+    uint32_t m_autoCamBytes{0};
+    Time m_camJitter;
+    Time m_autoCamNotBefore;
+    // State carried by the last autonomous CAM, for the trigger conditions
+    bool m_camSent{false};
+    Time m_lastCamTime;
+    Vector m_lastCamPos;
+    double m_lastCamSpeed{0.0};
+    double m_lastCamHeading{0.0};
 };
 
 class CamReceiver : public Application {
@@ -55,19 +101,40 @@ public:
     CamReceiver();
     ~CamReceiver() override;
     virtual void SetVehicleId(uint32_t id);
+    uint32_t GetVehicleId() const { return m_vehicleId; }
     virtual void SetReplyFunction(std::function<void(const std::string&)> replyFunction);
+    // Decides whether a groupcast CAM (sender id, send timestamp ms, receiver id, distance
+    // to the sender in m) is reported; unset means all are.
+    void SetGroupFilter(std::function<bool(uint32_t, uint64_t, uint32_t, double)> filter);
     virtual void SetIp(const Ipv4Address& addr);
     virtual void SetPort(uint16_t port);
+    void SetGroupPort(uint16_t port) { m_groupPort = port; }
+    // Registers the vehicle with `kpi` and reports every completed transfer to it; call
+    // once the application is on its node.
+    void SetKpi(LinkKpi* kpi);
+    // Same as CamSender::Suspend()/Resume().
+    void Suspend() { m_suspended = true; StopApplication(); }
+    void Resume() { m_suspended = false; StartApplication(); }
 protected:
     void StartApplication() override;
     void StopApplication() override;
     virtual void HandleRead(Ptr<Socket> socket);
+    // Feeds one received CAM into the transfer tracker.
+    void ReceiveCam(const CamHeader& camHeader, uint32_t payloadBytes);
+    void ReportTransfer(const TransferTracker::Completion& transfer);
+    void SetListening(bool listening);
     Ptr<Socket> m_socket;
+    Ptr<Socket> m_groupSocket;  // groupcast CAMs, if a group port is set
     Ipv4Address m_addr;
     uint16_t m_port{5000};
+    uint16_t m_groupPort{0};
     uint32_t m_vehicleId;
     uint32_t m_packetsReceived;
+    bool m_suspended{false};
     std::function<void(const std::string&)> m_replyFunction;
+    std::function<bool(uint32_t, uint64_t, uint32_t, double)> m_groupFilter;
+    TransferTracker m_transfers;
+    LinkKpi* m_kpi{nullptr};
 };
 
 
@@ -78,7 +145,7 @@ public:
   static TypeId GetTypeId();
   void StartApplication() override;
   void StopApplication() override;
-  void SendCam(uint32_t bytes, Ipv4Address dest_addr) override;
+  void SendCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId = -1) override;
 };
 class CamReceiverDSRC : public CamReceiver {
 public:
@@ -95,13 +162,33 @@ public:
     static TypeId GetTypeId();
     void StartApplication() override;
     void StopApplication() override;
-    void SendCam(uint32_t bytes, Ipv4Address dest_addr) override;
+    void SendCam(uint32_t bytes, Ipv4Address dest_addr, int32_t pktId = -1) override;
+    // One CarlaTxCommand with the given resources per fragment.
     void ScheduleCam(uint32_t bytes, Ipv4Address dest_addr, 
-                               uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id);
+                               uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id,
+                               int32_t pktId = -1);
     void SendCam(uint32_t bytes, Ipv4Address dest_addr, 
-                                uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id);
+                                uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id, uint32_t dest_L2Id,
+                                int32_t pktId = -1);
+    // Sidelink group all groupcast CAMs go to: IP multicast address, port, destination L2 id.
+    void SetGroup(Ipv4Address addr, uint16_t port, uint32_t l2Id);
+    // One transmission for every receiver of the group; sc_num = 0 leaves the
+    // resources to the scheduler. Returns the time the CAM will be stamped with.
+    Time ScheduleGroupCam(uint32_t bytes, uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id,
+                          int32_t pktId = -1);
+    void SendGroupCam(uint32_t bytes, uint8_t sc_start, uint8_t sc_num, double tx_power, uint32_t src_L2Id,
+                      int32_t pktId = -1);
     Ptr<NrSlUeMacSchedulerManual> GetScheduler();
     Ptr<NrSlUeMacSchedulerManual> m_scheduler = nullptr;
+
+protected:
+    // Autonomous CAMs go to the sidelink group, resources chosen by the scheduler.
+    void SendAutoCam(uint32_t bytes) override;
+
+private:
+    Ipv4Address m_groupAddr;
+    uint16_t m_groupPort{0};
+    uint32_t m_groupL2Id{0};
 };
 class CamReceiverNR : public CamReceiver {
 public:
@@ -109,6 +196,10 @@ public:
     void StartApplication() override;
     void StopApplication() override;
     void HandleRead(Ptr<Socket> socket) override;
+
+private:
+    void HandleGroupRead(Ptr<Socket> socket);
+    void Receive(Ptr<Socket> socket, bool group);
 };
 
 } // namespace ns3
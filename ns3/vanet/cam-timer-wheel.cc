@@ -0,0 +1,147 @@
+#include "cam-timer-wheel.h"
+
+#include "ns3/simulator.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+CamTimerWheel::CamTimerWheel(Time tick) : m_tick(tick) {}
+
+CamTimerWheel::TimerId CamTimerWheel::Add(std::function<void()> callback) {
+  TimerId id;
+  if (!m_freeIds.empty()) {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+  } else {
+    id = static_cast<TimerId>(m_timers.size());
+    m_timers.emplace_back();
+  }
+  m_timers[id].callback = std::move(callback);
+  return id;
+}
+
+void CamTimerWheel::Remove(TimerId id) {
+  Cancel(id);
+  m_timers[id].callback = nullptr;
+  m_freeIds.push_back(id);
+}
+
+void CamTimerWheel::Arm(TimerId id, Time delay) {
+  Timer& t = m_timers[id];
+  if (t.armed) {
+    --m_armed;
+  }
+  ++t.gen;
+  t.armed = true;
+  ++m_armed;
+
+  const bool idle = !m_dispatching && !m_event.IsPending();
+  if (idle) {
+    m_now = CurrentTick();  // the slots were emptied when the wheel went idle
+  }
+  const int64_t tickSteps = m_tick.GetTimeStep();
+  const int64_t dueSteps = (Simulator::Now() + std::max(delay, Time(0))).GetTimeStep();
+  const uint64_t due = std::max<uint64_t>((dueSteps + tickSteps - 1) / tickSteps, m_now + 1);
+  Insert({id, t.gen, due});
+
+  if (m_dispatching) {
+    return;  // Dispatch() schedules the next tick when it is done
+  }
+  if (idle) {
+    ScheduleDispatch(NextTick());
+  } else if (due < m_nextTick) {
+    m_event.Cancel();
+    ScheduleDispatch(due);
+  }
+}
+
+void CamTimerWheel::Cancel(TimerId id) {
+  Timer& t = m_timers[id];
+  if (t.armed) {
+    t.armed = false;
+    --m_armed;
+  }
+  ++t.gen;
+}
+
+void CamTimerWheel::Insert(const Entry& e) {
+  if (e.due - m_now < kSlots) {
+    m_level0[e.due & kMask].push_back(e);
+  } else if ((e.due >> kSlotBits) - (m_now >> kSlotBits) < kSlots) {
+    m_level1[(e.due >> kSlotBits) & kMask].push_back(e);
+  } else {
+    m_overflow.push_back(e);
+  }
+}
+
+void CamTimerWheel::Cascade(std::vector<Entry>& slot) {
+  std::vector<Entry> entries;
+  entries.swap(slot);
+  for (const Entry& e : entries) {
+    const Timer& t = m_timers[e.id];
+    if (t.armed && t.gen == e.gen) {
+      Insert(e);
+    }
+  }
+}
+
+void CamTimerWheel::Dispatch() {
+  m_dispatching = true;
+  m_now = m_nextTick;
+  if ((m_now & kMask) == 0) {
+    if (((m_now >> kSlotBits) & kMask) == 0) {
+      Cascade(m_overflow);
+    }
+    Cascade(m_level1[(m_now >> kSlotBits) & kMask]);
+  }
+
+  m_firing.swap(m_level0[m_now & kMask]);
+  for (const Entry& e : m_firing) {
+    Timer& t = m_timers[e.id];
+    if (!t.armed || t.gen != e.gen) {
+      continue;  // cancelled or re-armed since
+    }
+    t.armed = false;
+    --m_armed;
+    t.callback();
+  }
+  m_firing.clear();
+  m_dispatching = false;
+
+  if (m_armed == 0) {
+    // Idle: drop the stale entries, Arm() restarts the wheel at the then current tick.
+    for (auto& slot : m_level0) {
+      slot.clear();
+    }
+    for (auto& slot : m_level1) {
+      slot.clear();
+    }
+    m_overflow.clear();
+    return;
+  }
+  ScheduleDispatch(NextTick());
+}
+
+void CamTimerWheel::ScheduleDispatch(uint64_t tick) {
+  m_nextTick = tick;
+  const Time at = TimeStep(tick * static_cast<uint64_t>(m_tick.GetTimeStep()));
+  m_event = Simulator::Schedule(at - Simulator::Now(), &CamTimerWheel::Dispatch, this);
+}
+
+uint64_t CamTimerWheel::NextTick() const {
+  // Never past the next level-0 turn, where level 1 has to be cascaded.
+  const uint64_t boundary = ((m_now >> kSlotBits) + 1) << kSlotBits;
+  for (uint64_t tick = m_now + 1; tick < boundary; ++tick) {
+    if (!m_level0[tick & kMask].empty()) {
+      return tick;
+    }
+  }
+  return boundary;
+}
+
+uint64_t CamTimerWheel::CurrentTick() const {
+  return static_cast<uint64_t>(Simulator::Now().GetTimeStep() / m_tick.GetTimeStep());
+}
+
+} // namespace ns3
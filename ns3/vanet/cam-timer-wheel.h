@@ -0,0 +1,84 @@
+#ifndef CAM_TIMER_WHEEL_H
+#define CAM_TIMER_WHEEL_H
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Hierarchical timer wheel for the periodic per-vehicle CAM checks.
+ *
+ * Thousands of vehicles re-arming a ~100 ms timer would otherwise keep as many
+ * events in the ns-3 scheduler. Here all timers share one dispatcher event per
+ * non-empty tick: level 0 has 256 slots of one tick (2.56 s at 10 ms), level 1 has
+ * 256 slots of 256 ticks, and anything further out waits in an overflow list that
+ * is re-filed every full level-1 turn. Expiries are rounded up to the next tick, so
+ * a timer never fires early; empty ticks are skipped, and nothing runs while no
+ * timer is armed.
+ *
+ * Re-arming or cancelling only bumps the timer's generation; the stale slot entry
+ * is dropped when its tick comes up. Simulator thread only.
+ */
+class CamTimerWheel {
+public:
+  using TimerId = uint32_t;
+
+  explicit CamTimerWheel(Time tick = MilliSeconds(10));
+
+  // The callback runs in the dispatcher event and may re-arm its own timer.
+  TimerId Add(std::function<void()> callback);
+  void Remove(TimerId id);
+  // Fires once after at least `delay`; re-arming replaces a pending expiry.
+  void Arm(TimerId id, Time delay);
+  void Cancel(TimerId id);
+
+  size_t GetNArmed() const { return m_armed; }
+
+private:
+  static constexpr uint32_t kSlotBits = 8;
+  static constexpr uint32_t kSlots = 1u << kSlotBits;
+  static constexpr uint64_t kMask = kSlots - 1;
+
+  struct Timer {
+    std::function<void()> callback;
+    uint32_t gen{0};
+    bool armed{false};
+  };
+  struct Entry {
+    TimerId id;
+    uint32_t gen;
+    uint64_t due;  // absolute tick
+  };
+
+  void Insert(const Entry& e);
+  void Cascade(std::vector<Entry>& slot);
+  void Dispatch();
+  void ScheduleDispatch(uint64_t tick);
+  uint64_t NextTick() const;
+  uint64_t CurrentTick() const;
+
+  Time m_tick;
+  uint64_t m_now{0};       // last tick processed
+  uint64_t m_nextTick{0};  // tick of m_event
+  std::deque<Timer> m_timers;  // stable addresses: callbacks may Add() while running
+  std::vector<TimerId> m_freeIds;
+  std::array<std::vector<Entry>, kSlots> m_level0;
+  std::array<std::vector<Entry>, kSlots> m_level1;
+  std::vector<Entry> m_overflow;
+  std::vector<Entry> m_firing;  // reused by Dispatch()
+  size_t m_armed{0};
+  bool m_dispatching{false};
+  EventId m_event;
+};
+
+} // namespace ns3
+
+#endif
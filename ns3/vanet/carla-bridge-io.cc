@@ -0,0 +1,496 @@
+#include "carla-bridge-io.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <optional>
+
+namespace ns3 {
+
+namespace {
+
+constexpr size_t kRecvChunkSize = 64 * 1024;
+constexpr int kMaxEvents = 8;
+constexpr size_t kMaxIov = 256;
+constexpr std::chrono::milliseconds kMinConnectBackoff(100);
+constexpr std::chrono::milliseconds kMaxConnectBackoff(2000);
+
+bool IsAutoHost(const std::string& host) {
+  return host.empty() || host == "auto";
+}
+
+} // namespace
+
+CarlaBridgeIo::CarlaBridgeIo(uint16_t listenPort, uint16_t callbackPort, std::string callbackHost)
+    : m_listenPort(listenPort),
+      m_callbackPort(callbackPort),
+      m_autoHost(IsAutoHost(callbackHost)),
+      m_connectBackoff(kMinConnectBackoff),
+      m_callbackHost(m_autoHost ? std::string() : std::move(callbackHost)) {}
+
+CarlaBridgeIo::~CarlaBridgeIo() {
+  Stop(std::chrono::milliseconds(0));
+}
+
+void CarlaBridgeIo::SetFrameHandler(FrameHandler handler) {
+  m_frameHandler = std::move(handler);
+}
+
+void CarlaBridgeIo::SetConnectHandler(ConnectHandler handler) {
+  m_connectHandler = std::move(handler);
+}
+
+void CarlaBridgeIo::SetDisconnectHandler(DisconnectHandler handler) {
+  m_disconnectHandler = std::move(handler);
+}
+
+bool CarlaBridgeIo::Start() {
+  if (m_running) {
+    return true;
+  }
+  m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (m_epollFd < 0 || m_wakeFd < 0 || m_listenFd < 0) {
+    perror("[ERR] bridge I/O setup failed");
+    return false;
+  }
+
+  int opt = 1;
+  setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = INADDR_ANY;
+  address.sin_port = htons(m_listenPort);
+  if (bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    perror("bind failed");
+    return false;
+  }
+  if (listen(m_listenFd, 1) < 0) {
+    perror("listen failed");
+    return false;
+  }
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = m_wakeFd;
+  epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+  ev.data.fd = m_listenFd;
+  epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &ev);
+
+  std::cout << "[INFO] Waiting for Carla on port " << m_listenPort << "...\n";
+  m_nextConnectAttempt = std::chrono::steady_clock::now();
+  m_running = true;
+  m_thread = std::thread(&CarlaBridgeIo::Loop, this);
+  return true;
+}
+
+void CarlaBridgeIo::Stop(std::chrono::milliseconds flushTimeout) {
+  if (m_thread.joinable()) {
+    m_flushDeadline = std::chrono::steady_clock::now() + flushTimeout;
+    m_stopping = true;
+    Flush();
+    m_thread.join();
+  }
+  m_running = false;
+  for (int* fd : {&m_clientFd, &m_callbackFd, &m_listenFd, &m_wakeFd, &m_epollFd}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+  m_callbackState = CallbackState::DISCONNECTED;
+}
+
+bool CarlaBridgeIo::Enqueue(std::string msg, bool queueWhileDisconnected) {
+  if (!queueWhileDisconnected && m_callbackState != CallbackState::CONNECTED) {
+    return false;
+  }
+  msg.append("\r\n");
+  if (m_pendingBytes.fetch_add(msg.size(), std::memory_order_relaxed) + msg.size() > kMaxPendingBytes) {
+    m_pendingBytes.fetch_sub(msg.size(), std::memory_order_relaxed);
+    ++m_droppedMessages;
+    return false;
+  }
+  m_outQueue.Push(std::move(msg));
+  // Only the first message of a batch costs a wakeup; it starts the batching timer.
+  if (!m_batchArmed.exchange(true, std::memory_order_acq_rel)) {
+    Wake();
+  }
+  return true;
+}
+
+void CarlaBridgeIo::Flush() {
+  if (!m_flushRequested.exchange(true, std::memory_order_acq_rel)) {
+    Wake();
+  }
+}
+
+bool CarlaBridgeIo::IsCallbackConnected() const {
+  return m_callbackState == CallbackState::CONNECTED;
+}
+
+std::string CarlaBridgeIo::GetCallbackHost() const {
+  std::lock_guard<std::mutex> lock(m_hostMutex);
+  return m_callbackHost;
+}
+
+size_t CarlaBridgeIo::GetDroppedMessages() const {
+  return m_droppedMessages;
+}
+
+void CarlaBridgeIo::Wake() {
+  if (m_wakeFd >= 0) {
+    const uint64_t one = 1;
+    [[maybe_unused]] ssize_t ret = write(m_wakeFd, &one, sizeof(one));
+  }
+}
+
+int CarlaBridgeIo::ComputeTimeoutMs() const {
+  using namespace std::chrono;
+  const auto now = steady_clock::now();
+  std::optional<steady_clock::time_point> wakeAt;
+  if (m_callbackState == CallbackState::DISCONNECTED && WantsCallback()) {
+    wakeAt = m_nextConnectAttempt;
+  }
+  if (m_batchDeadline && (!wakeAt || *m_batchDeadline < *wakeAt)) {
+    wakeAt = m_batchDeadline;
+  }
+  if (m_stopping && (!wakeAt || m_flushDeadline < *wakeAt)) {
+    wakeAt = m_flushDeadline;
+  }
+  if (!wakeAt) {
+    return -1;
+  }
+  return *wakeAt <= now ? 0 : static_cast<int>(ceil<milliseconds>(*wakeAt - now).count());
+}
+
+void CarlaBridgeIo::Loop() {
+  epoll_event events[kMaxEvents];
+  while (true) {
+    const int n = epoll_wait(m_epollFd, events, kMaxEvents, ComputeTimeoutMs());
+    if (n < 0 && errno != EINTR) {
+      perror("[ERR] epoll_wait failed");
+      break;
+    }
+    for (int i = 0; i < n; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == m_wakeFd) {
+        uint64_t count;
+        [[maybe_unused]] ssize_t ret = read(m_wakeFd, &count, sizeof(count));
+        if (m_flushRequested.exchange(false, std::memory_order_acq_rel)) {
+          FlushOutbound();
+        } else if (!m_batchDeadline && m_batchArmed.load(std::memory_order_acquire)) {
+          m_batchDeadline = std::chrono::steady_clock::now() + kMaxBatchDelay;
+        }
+      } else if (fd == m_listenFd) {
+        HandleAccept();
+      } else if (fd == m_clientFd) {
+        HandleClientReadable();
+      } else if (fd == m_callbackFd) {
+        HandleCallbackEvent(events[i].events);
+      }
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (m_batchDeadline && now >= *m_batchDeadline) {
+      FlushOutbound();
+    }
+    if (m_callbackState == CallbackState::DISCONNECTED && now >= m_nextConnectAttempt &&
+        WantsCallback()) {
+      StartConnect();
+    }
+
+    if (m_stopping) {
+      const bool hasOutbound = HasOutbound();
+      const bool canFlush = m_callbackState != CallbackState::DISCONNECTED;
+      if (!hasOutbound || !canFlush || now >= m_flushDeadline) {
+        if (hasOutbound) {
+          std::cerr << "[WARN] Bridge stopped with unsent messages for Carla\n";
+        }
+        break;
+      }
+    }
+  }
+}
+
+bool CarlaBridgeIo::HasOutbound() const {
+  return m_pendingBytes.load(std::memory_order_acquire) > 0;
+}
+
+// The callback connection is kept up while CARLA is attached or data is waiting.
+bool CarlaBridgeIo::WantsCallback() const {
+  if (m_stopping || GetCallbackHost().empty()) {
+    return false;
+  }
+  return m_clientFd >= 0 || HasOutbound();
+}
+
+void CarlaBridgeIo::HandleAccept() {
+  sockaddr_in address{};
+  socklen_t addrlen = sizeof(address);
+  const int fd = accept4(m_listenFd, reinterpret_cast<sockaddr*>(&address), &addrlen,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      perror("accept failed");
+    }
+    return;
+  }
+  if (m_clientFd >= 0) {
+    std::cout << "[INFO] New Carla connection on port " << m_listenPort << " replaces the previous one.\n";
+    CloseClient();
+  }
+  m_clientFd = fd;
+  int opt = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+  epoll_event ev{};
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.fd = fd;
+  epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev);
+
+  char peerIp[INET_ADDRSTRLEN] = {0};
+  const char* peerIpText = inet_ntop(AF_INET, &address.sin_addr, peerIp, sizeof(peerIp));
+  std::string peer = peerIpText != nullptr ? peerIpText : "";
+  std::cout << "[INFO] Carla connected on port " << m_listenPort
+            << (peer.empty() ? "" : " from " + peer) << ".\n";
+  if (m_autoHost && !peer.empty()) {
+    std::lock_guard<std::mutex> lock(m_hostMutex);
+    if (m_callbackHost != peer) {
+      m_callbackHost = peer;
+      std::cout << "[INFO] Auto-detected Carla callback host as " << peer << ".\n";
+    }
+  }
+  if (m_callbackState == CallbackState::DISCONNECTED) {
+    m_connectBackoff = kMinConnectBackoff;
+    m_nextConnectAttempt = std::chrono::steady_clock::now();
+  }
+  if (m_connectHandler) {
+    m_connectHandler(peer);
+  }
+}
+
+void CarlaBridgeIo::HandleClientReadable() {
+  while (m_clientFd >= 0) {
+    char* buffer = m_framer.PrepareWrite(kRecvChunkSize);
+    const ssize_t bytes = recv(m_clientFd, buffer, m_framer.WritableSize(), 0);
+    if (bytes > 0) {
+      m_framer.Commit(static_cast<size_t>(bytes));
+      if (m_frameHandler) {
+        m_frameHandler(m_framer);
+      }
+      continue;
+    }
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    std::cout << "[INFO] Carla disconnected or error on port " << m_listenPort
+              << "; waiting for reconnection.\n";
+    CloseClient();
+  }
+}
+
+void CarlaBridgeIo::CloseClient() {
+  epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_clientFd, nullptr);
+  close(m_clientFd);
+  m_clientFd = -1;
+  m_framer.Clear();
+  m_framer.UseDelimitedFrames();
+  if (m_disconnectHandler) {
+    m_disconnectHandler();
+  }
+  std::cout << "[INFO] Receiver connection on port " << m_listenPort << " closed.\n";
+}
+
+void CarlaBridgeIo::StartConnect() {
+  const std::string host = GetCallbackHost();
+  if (host.empty()) {
+    return;  // Not known until CARLA connects in auto mode.
+  }
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(m_callbackPort);
+  if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+    std::cerr << "[ERR] Invalid Carla callback host: " << host << "\n";
+    CloseCallback(true);
+    return;
+  }
+
+  std::cout << "[INFO] Connecting to Carla on port " << m_callbackPort << "...\n";
+  m_callbackFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (m_callbackFd < 0) {
+    perror("[ERR] socket failed");
+    CloseCallback(true);
+    return;
+  }
+  int opt = 1;
+  setsockopt(m_callbackFd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+  epoll_event ev{};
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+  ev.data.fd = m_callbackFd;
+  epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_callbackFd, &ev);
+  m_callbackWantsWrite = true;
+
+  if (connect(m_callbackFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+    m_callbackState = CallbackState::CONNECTED;
+    m_connectBackoff = kMinConnectBackoff;
+    std::cout << "[INFO] Connected to Carla on port " << m_callbackPort << ".\n";
+    FlushOutbound();
+    return;
+  }
+  if (errno != EINPROGRESS) {
+    perror("[ERR] connect failed");
+    CloseCallback(true);
+    return;
+  }
+  m_callbackState = CallbackState::CONNECTING;
+}
+
+void CarlaBridgeIo::HandleCallbackEvent(uint32_t events) {
+  if (m_callbackState == CallbackState::CONNECTING) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(m_callbackFd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0) {
+      std::cerr << "[ERR] connect failed: " << std::strerror(err) << "\n";
+      CloseCallback(true);
+      return;
+    }
+    if ((events & EPOLLOUT) == 0) {
+      return;
+    }
+    m_callbackState = CallbackState::CONNECTED;
+    m_connectBackoff = kMinConnectBackoff;
+    std::cout << "[INFO] Connected to Carla on port " << m_callbackPort << ".\n";
+    FlushOutbound();
+    return;
+  }
+
+  if (events & EPOLLIN) {
+    // CARLA never talks back on 5557; reading only detects an orderly close.
+    char scratch[512];
+    ssize_t bytes;
+    while ((bytes = recv(m_callbackFd, scratch, sizeof(scratch), 0)) > 0) {
+    }
+    if (bytes == 0) {
+      std::cout << "[INFO] Carla closed the connection on port " << m_callbackPort << ".\n";
+      CloseCallback(true);
+      return;
+    }
+  }
+  if (events & (EPOLLERR | EPOLLHUP)) {
+    std::cerr << "[ERR] Connection to Carla on port " << m_callbackPort << " failed\n";
+    CloseCallback(true);
+    return;
+  }
+  if (events & EPOLLOUT) {
+    FlushOutbound();
+  }
+}
+
+void CarlaBridgeIo::CloseCallback(bool retry) {
+  if (m_callbackFd >= 0) {
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_callbackFd, nullptr);
+    close(m_callbackFd);
+    m_callbackFd = -1;
+  }
+  m_callbackState = CallbackState::DISCONNECTED;
+  m_callbackWantsWrite = false;
+  if (m_inflightOffset > 0) {
+    // A partially written message cannot be resumed on a new connection.
+    m_pendingBytes -= m_inflight[m_inflightHead].size() - m_inflightOffset;
+    ++m_inflightHead;
+    m_inflightOffset = 0;
+    ++m_droppedMessages;
+  }
+  if (retry) {
+    m_nextConnectAttempt = std::chrono::steady_clock::now() + m_connectBackoff;
+    m_connectBackoff = std::min(m_connectBackoff * 2, kMaxConnectBackoff);
+  }
+}
+
+bool CarlaBridgeIo::FlushOutbound() {
+  // Reset before draining: a message pushed from now on either gets drained below or
+  // arms the next batch.
+  m_batchArmed.store(false, std::memory_order_release);
+  m_batchDeadline.reset();
+  if (m_callbackState != CallbackState::CONNECTED) {
+    return false;  // the queue is kept and written once the connection is up
+  }
+
+  std::string msg;
+  while (m_outQueue.Pop(msg)) {
+    m_inflight.push_back(std::move(msg));
+  }
+
+  iovec iov[kMaxIov];
+  while (m_inflightHead < m_inflight.size()) {
+    size_t count = 0;
+    for (size_t i = m_inflightHead; i < m_inflight.size() && count < kMaxIov; ++i, ++count) {
+      const size_t skip = (i == m_inflightHead) ? m_inflightOffset : 0;
+      iov[count].iov_base = m_inflight[i].data() + skip;
+      iov[count].iov_len = m_inflight[i].size() - skip;
+    }
+    const ssize_t sent = writev(m_callbackFd, iov, static_cast<int>(count));
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        UpdateCallbackInterest(true);
+        return false;
+      }
+      perror("[ERR] send failed");
+      CloseCallback(true);
+      return false;
+    }
+
+    m_pendingBytes.fetch_sub(static_cast<size_t>(sent), std::memory_order_acq_rel);
+    size_t remaining = static_cast<size_t>(sent);
+    while (remaining > 0) {
+      const size_t left = m_inflight[m_inflightHead].size() - m_inflightOffset;
+      if (remaining < left) {
+        m_inflightOffset += remaining;
+        break;
+      }
+      remaining -= left;
+      ++m_inflightHead;
+      m_inflightOffset = 0;
+    }
+  }
+
+  m_inflight.clear();
+  m_inflightHead = 0;
+  UpdateCallbackInterest(false);
+  return true;
+}
+
+void CarlaBridgeIo::UpdateCallbackInterest(bool wantWrite) {
+  if (m_callbackFd < 0 || m_callbackWantsWrite == wantWrite) {
+    return;
+  }
+  epoll_event ev{};
+  ev.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+  ev.data.fd = m_callbackFd;
+  epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_callbackFd, &ev);
+  m_callbackWantsWrite = wantWrite;
+}
+
+} // namespace ns3
@@ -0,0 +1,138 @@
+#ifndef CARLA_BRIDGE_IO_H
+#define CARLA_BRIDGE_IO_H
+
+#include "ingress-framer.h"
+#include "mpsc-queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Single epoll-driven I/O thread for the CARLA bridge. It owns the ingress listen
+ * socket (5556), the accepted CARLA client and the outbound callback connection
+ * (5557). Every socket is non-blocking: the callback connection is (re)opened with a
+ * non-blocking connect() and a retry backoff, so nothing on the simulator thread ever
+ * waits on the network.
+ *
+ * Outbound messages are pushed with Enqueue() into a lock-free queue from any
+ * thread. The I/O thread writes them in batches: the first message after a write
+ * arms a short batching timer, and Flush() (e.g. after a sync_ack) writes
+ * immediately. Everything queued by then goes out in one writev(). Inbound frames
+ * are reassembled in an IngressFramer and passed to the frame handler on the I/O
+ * thread.
+ */
+class CarlaBridgeIo {
+public:
+  // Called on the I/O thread whenever new ingress bytes were committed to the framer.
+  using FrameHandler = std::function<void(IngressFramer&)>;
+  // Called on the I/O thread when the CARLA client connects (peer ip) or goes away.
+  using ConnectHandler = std::function<void(const std::string&)>;
+  using DisconnectHandler = std::function<void()>;
+
+  // callbackHost "auto" (or empty) uses the address of the ingress peer.
+  CarlaBridgeIo(uint16_t listenPort, uint16_t callbackPort, std::string callbackHost);
+  ~CarlaBridgeIo();
+
+  CarlaBridgeIo(const CarlaBridgeIo&) = delete;
+  CarlaBridgeIo& operator=(const CarlaBridgeIo&) = delete;
+
+  void SetFrameHandler(FrameHandler handler);
+  void SetConnectHandler(ConnectHandler handler);
+  void SetDisconnectHandler(DisconnectHandler handler);
+
+  // Binds the listen socket and starts the I/O thread.
+  bool Start();
+  // Flushes queued outbound bytes (bounded by flushTimeout) and joins the I/O thread.
+  void Stop(std::chrono::milliseconds flushTimeout = std::chrono::milliseconds(1000));
+
+  // Queues one message for port 5557; the "\r\n" delimiter is appended here.
+  // With queueWhileDisconnected == false the message is dropped if the callback
+  // connection is not up, matching a one-shot best-effort send.
+  bool Enqueue(std::string msg, bool queueWhileDisconnected = true);
+  // Writes everything queued so far without waiting for the batching timer.
+  void Flush();
+
+  bool IsCallbackConnected() const;
+  std::string GetCallbackHost() const;
+  size_t GetDroppedMessages() const;
+
+  static constexpr size_t kMaxPendingBytes = 64 * 1024 * 1024;
+  // Upper bound on how long a message may wait for its batch without a Flush().
+  static constexpr std::chrono::milliseconds kMaxBatchDelay{10};
+
+private:
+  enum class CallbackState {
+    DISCONNECTED,
+    CONNECTING,
+    CONNECTED,
+  };
+
+  void Loop();
+  void Wake();
+  void HandleAccept();
+  void HandleClientReadable();
+  void CloseClient();
+  void StartConnect();
+  void HandleCallbackEvent(uint32_t events);
+  void CloseCallback(bool retry);
+  bool FlushOutbound();
+  void UpdateCallbackInterest(bool wantWrite);
+  bool HasOutbound() const;
+  bool WantsCallback() const;
+  int ComputeTimeoutMs() const;
+
+  uint16_t m_listenPort;
+  uint16_t m_callbackPort;
+  bool m_autoHost;
+
+  FrameHandler m_frameHandler;
+  ConnectHandler m_connectHandler;
+  DisconnectHandler m_disconnectHandler;
+
+  int m_epollFd{-1};
+  int m_wakeFd{-1};
+  int m_listenFd{-1};
+  int m_clientFd{-1};
+  int m_callbackFd{-1};
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::atomic<bool> m_stopping{false};
+  std::chrono::steady_clock::time_point m_flushDeadline;
+
+  IngressFramer m_framer;
+
+  // Callback connection, touched only by the I/O thread except where noted.
+  std::atomic<CallbackState> m_callbackState{CallbackState::DISCONNECTED};
+  bool m_callbackWantsWrite{false};
+  std::chrono::steady_clock::time_point m_nextConnectAttempt;
+  std::chrono::milliseconds m_connectBackoff;
+
+  mutable std::mutex m_hostMutex;
+  std::string m_callbackHost;
+
+  // Producers push into m_outQueue; the I/O thread moves messages to m_inflight and
+  // keeps them there until writev() has taken every byte.
+  MpscQueue<std::string> m_outQueue;
+  std::atomic<size_t> m_pendingBytes{0};
+  std::atomic<size_t> m_droppedMessages{0};
+  std::atomic<bool> m_batchArmed{false};
+  std::atomic<bool> m_flushRequested{false};
+  std::optional<std::chrono::steady_clock::time_point> m_batchDeadline;
+  std::vector<std::string> m_inflight;
+  size_t m_inflightHead{0};
+  size_t m_inflightOffset{0};  // bytes of m_inflight[m_inflightHead] already written
+};
+
+} // namespace ns3
+
+#endif
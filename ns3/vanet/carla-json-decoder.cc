@@ -0,0 +1,521 @@
+#include "carla-json-decoder.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace ns3 {
+
+namespace {
+
+constexpr int kMaxSkipDepth = 64;
+
+} // namespace
+
+CarlaJsonDecoder::Status CarlaJsonDecoder::Decode(std::string_view data,
+                                                  Result& result,
+                                                  std::vector<VehicleSample>& vehicles,
+                                                  std::vector<TransferRequest>& requests) {
+  m_begin = data.data();
+  m_cur = m_begin;
+  m_end = m_begin + data.size();
+  m_unsupported = false;
+  m_errorOffset = 0;
+  m_dropped = 0;
+  result = Result();
+  vehicles.clear();
+  requests.clear();
+
+  Type payloadType = Type::NONE;
+  std::string_view typeName;
+  bool ok = Expect('{');
+  if (ok && SkipWs() && *m_cur == '}') {
+    ++m_cur;
+  } else {
+    while (ok) {
+      std::string_view key;
+      if (!ParseKey(key)) {
+        ok = false;
+        break;
+      }
+      if (key == "type") {
+        ok = ParseString(typeName);
+      } else if (key == "vehicles_position") {
+        payloadType = Type::VEHICLES_POSITION;
+        ok = ParseVehicleArray(vehicles);
+      } else if (key == "transfer_requests") {
+        payloadType = Type::TRANSFER_REQUESTS;
+        ok = ParseTransferArray(requests);
+      } else if (key == "vehicles_num") {
+        payloadType = Type::VEHICLES_NUM;
+        double num = 0;
+        ok = ParseNumber(num);
+        result.vehiclesNum = static_cast<int>(num);
+      } else if (key == "sync_request") {
+        payloadType = Type::SYNC_REQUEST;
+        ok = ParseSync(result.sync);
+      } else if (key == "vehicles_despawn") {
+        payloadType = Type::VEHICLES_DESPAWN;
+        ok = ParseIntArray(result.despawned);
+      } else if (key == "tick_bundle") {
+        payloadType = Type::TICK_BUNDLE;
+        ok = ParseTickBundle(result, vehicles, requests);
+      } else if (key == "carla_time") {
+        ok = ParseNumber(result.carlaTime);
+      } else {
+        ok = SkipValue();
+      }
+      if (!ok || !SkipWs()) {
+        ok = false;
+        break;
+      }
+      if (*m_cur == ',') {
+        ++m_cur;
+        continue;
+      }
+      ok = Expect('}');
+      break;
+    }
+  }
+
+  if (ok && SkipWs()) {
+    ok = false;  // trailing garbage after the object
+  }
+  if (!ok) {
+    m_errorOffset = static_cast<size_t>(m_cur - m_begin);
+    return m_unsupported ? Status::UNSUPPORTED : Status::MALFORMED;
+  }
+
+  const bool typeMatches =
+      (typeName == "vehicles_position" && payloadType == Type::VEHICLES_POSITION) ||
+      (typeName == "transfer_requests" && payloadType == Type::TRANSFER_REQUESTS) ||
+      (typeName == "vehicles_num" && payloadType == Type::VEHICLES_NUM) ||
+      (typeName == "sync_request" && payloadType == Type::SYNC_REQUEST) ||
+      (typeName == "vehicles_despawn" && payloadType == Type::VEHICLES_DESPAWN) ||
+      (typeName == "tick_bundle" && payloadType == Type::TICK_BUNDLE);
+  if (!typeMatches) {
+    // Other message types, or a type without its payload: let the generic path report it.
+    return Status::UNSUPPORTED;
+  }
+  result.droppedRecords = m_dropped;
+  result.type = payloadType;
+  return Status::OK;
+}
+
+size_t CarlaJsonDecoder::GetErrorOffset() const { return m_errorOffset; }
+
+// Returns false only at end of input.
+bool CarlaJsonDecoder::SkipWs() {
+  while (m_cur < m_end &&
+         (*m_cur == ' ' || *m_cur == '\t' || *m_cur == '\n' || *m_cur == '\r')) {
+    ++m_cur;
+  }
+  return m_cur < m_end;
+}
+
+bool CarlaJsonDecoder::Expect(char c) {
+  if (!SkipWs() || *m_cur != c) {
+    return false;
+  }
+  ++m_cur;
+  return true;
+}
+
+bool CarlaJsonDecoder::ParseKey(std::string_view& key) {
+  return ParseString(key) && Expect(':');
+}
+
+bool CarlaJsonDecoder::ParseString(std::string_view& value) {
+  if (!Expect('"')) {
+    return false;
+  }
+  const char* start = m_cur;
+  const void* quote = std::memchr(m_cur, '"', m_end - m_cur);
+  if (quote == nullptr) {
+    return false;
+  }
+  const char* stop = static_cast<const char*>(quote);
+  if (std::memchr(start, '\\', stop - start) != nullptr) {
+    // Escaped keys and type names never occur in CARLA's messages.
+    m_unsupported = true;
+    return false;
+  }
+  value = std::string_view(start, stop - start);
+  m_cur = stop + 1;
+  return true;
+}
+
+bool CarlaJsonDecoder::ParseNumber(double& value) {
+  if (!SkipWs()) {
+    return false;
+  }
+  const auto [ptr, ec] = std::from_chars(m_cur, m_end, value);
+  if (ec != std::errc() || ptr == m_cur) {
+    return false;
+  }
+  m_cur = ptr;
+  return true;
+}
+
+bool CarlaJsonDecoder::SkipValue(int depth) {
+  if (depth > kMaxSkipDepth || !SkipWs()) {
+    return false;
+  }
+  const char c = *m_cur;
+  if (c == '"') {
+    ++m_cur;
+    while (m_cur < m_end && *m_cur != '"') {
+      m_cur += (*m_cur == '\\') ? 2 : 1;
+    }
+    if (m_cur >= m_end) {
+      return false;
+    }
+    ++m_cur;
+    return true;
+  }
+  if (c == '{' || c == '[') {
+    const char close = (c == '{') ? '}' : ']';
+    ++m_cur;
+    if (SkipWs() && *m_cur == close) {
+      ++m_cur;
+      return true;
+    }
+    while (true) {
+      if (c == '{') {
+        std::string_view key;
+        if (!ParseKey(key)) {
+          return false;
+        }
+      }
+      if (!SkipValue(depth + 1) || !SkipWs()) {
+        return false;
+      }
+      if (*m_cur == ',') {
+        ++m_cur;
+        continue;
+      }
+      if (*m_cur != close) {
+        return false;
+      }
+      ++m_cur;
+      return true;
+    }
+  }
+  // Literals and numbers: consume up to the next structural character.
+  const char* start = m_cur;
+  while (m_cur < m_end && *m_cur != ',' && *m_cur != '}' && *m_cur != ']' && *m_cur != ' ' &&
+         *m_cur != '\t' && *m_cur != '\n' && *m_cur != '\r') {
+    ++m_cur;
+  }
+  return m_cur > start;
+}
+
+bool CarlaJsonDecoder::ParseVector(Vector& v) {
+  if (!Expect('{')) {
+    return false;
+  }
+  if (SkipWs() && *m_cur == '}') {
+    ++m_cur;
+    return true;
+  }
+  while (true) {
+    std::string_view key;
+    if (!ParseKey(key)) {
+      return false;
+    }
+    bool ok;
+    if (key == "x") {
+      ok = ParseNumber(v.x);
+    } else if (key == "y") {
+      ok = ParseNumber(v.y);
+    } else if (key == "z") {
+      ok = ParseNumber(v.z);
+    } else {
+      ok = SkipValue();
+    }
+    if (!ok || !SkipWs()) {
+      return false;
+    }
+    if (*m_cur == ',') {
+      ++m_cur;
+      continue;
+    }
+    return Expect('}');
+  }
+}
+
+bool CarlaJsonDecoder::ParseVehicle(VehicleSample& v, bool& complete) {
+  if (!Expect('{')) {
+    return false;
+  }
+  bool hasPosition = false;
+  bool hasVelocity = false;
+  if (SkipWs() && *m_cur == '}') {
+    ++m_cur;
+  } else {
+    while (true) {
+      std::string_view key;
+      if (!ParseKey(key)) {
+        return false;
+      }
+      bool ok;
+      double number = 0;
+      if (key == "carla_id") {
+        ok = ParseNumber(number);
+        v.carlaId = static_cast<int>(number);
+      } else if (key == "id") {
+        ok = ParseNumber(number);
+        v.index = static_cast<int>(number);
+      } else if (key == "position") {
+        ok = ParseVector(v.position);
+        hasPosition = true;
+      } else if (key == "velocity") {
+        ok = ParseVector(v.velocity);
+        hasVelocity = true;
+      } else if (key == "acceleration") {
+        ok = ParseVector(v.acceleration);
+      } else if (key == "yaw_rate") {
+        ok = ParseNumber(v.yawRate);
+      } else {
+        ok = SkipValue();
+      }
+      if (!ok || !SkipWs()) {
+        return false;
+      }
+      if (*m_cur == ',') {
+        ++m_cur;
+        continue;
+      }
+      if (!Expect('}')) {
+        return false;
+      }
+      break;
+    }
+  }
+  complete = hasPosition && hasVelocity;
+  return true;
+}
+
+bool CarlaJsonDecoder::ParseVehicleArray(std::vector<VehicleSample>& out) {
+  if (!Expect('[')) {
+    return false;
+  }
+  if (SkipWs() && *m_cur == ']') {
+    ++m_cur;
+    return true;
+  }
+  while (true) {
+    bool complete = false;
+    if (!ParseVehicle(out.emplace_back(), complete) || !SkipWs()) {
+      return false;
+    }
+    if (!complete) {
+      out.pop_back();
+      ++m_dropped;
+    }
+    if (*m_cur == ',') {
+      ++m_cur;
+      continue;
+    }
+    return Expect(']');
+  }
+}
+
+bool CarlaJsonDecoder::ParseIntArray(std::vector<int>& out) {
+  if (!Expect('[')) {
+    return false;
+  }
+  if (SkipWs() && *m_cur == ']') {
+    ++m_cur;
+    return true;
+  }
+  while (true) {
+    double number = 0;
+    if (!ParseNumber(number) || !SkipWs()) {
+      return false;
+    }
+    out.push_back(static_cast<int>(number));
+    if (*m_cur == ',') {
+      ++m_cur;
+      continue;
+    }
+    return Expect(']');
+  }
+}
+
+bool CarlaJsonDecoder::ParseTransferRequest(TransferRequest& r, bool& complete) {
+  if (!Expect('{')) {
+    return false;
+  }
+  bool hasSource = false;
+  bool hasTarget = false;
+  bool hasSize = false;
+  bool hasScStart = false;
+  bool hasScNum = false;
+  if (SkipWs() && *m_cur == '}') {
+    ++m_cur;
+  } else {
+    while (true) {
+      std::string_view key;
+      if (!ParseKey(key)) {
+        return false;
+      }
+      bool ok;
+      double number = 0;
+      if (key == "source") {
+        ok = ParseNumber(number);
+        r.source = static_cast<int>(number);
+        hasSource = true;
+      } else if (key == "target") {
+        ok = ParseNumber(number);
+        r.target = static_cast<int>(number);
+        hasTarget = true;
+      } else if (key == "size") {
+        ok = ParseNumber(number);
+        r.size = static_cast<int>(number);
+        hasSize = true;
+      } else if (key == "pkt_id") {
+        ok = ParseNumber(number);
+        r.pktId = static_cast<int>(number);
+      } else if (key == "sc_start") {
+        ok = ParseNumber(number);
+        r.scStart = static_cast<uint8_t>(number);
+        hasScStart = true;
+      } else if (key == "sc_num") {
+        ok = ParseNumber(number);
+        r.scNum = static_cast<uint8_t>(number);
+        hasScNum = true;
+      } else if (key == "tx_power") {
+        ok = ParseNumber(r.txPower);
+      } else if (key == "targets") {
+        ok = ParseIntArray(r.targets);
+        r.groupcast = true;
+      } else if (key == "radius") {
+        ok = ParseNumber(r.radius);
+        r.groupcast = true;
+      } else {
+        ok = SkipValue();
+      }
+      if (!ok || !SkipWs()) {
+        return false;
+      }
+      if (*m_cur == ',') {
+        ++m_cur;
+        continue;
+      }
+      if (!Expect('}')) {
+        return false;
+      }
+      break;
+    }
+  }
+  r.hasSubChannel = hasScStart && hasScNum;
+  if (!r.hasSubChannel) {
+    r.txPower = TransferRequest().txPower;  // tx_power only applies with a sub-channel
+  }
+  complete = hasSource && (hasTarget || r.groupcast) && hasSize;
+  return true;
+}
+
+bool CarlaJsonDecoder::ParseTransferArray(std::vector<TransferRequest>& out) {
+  if (!Expect('[')) {
+    return false;
+  }
+  if (SkipWs() && *m_cur == ']') {
+    ++m_cur;
+    return true;
+  }
+  while (true) {
+    bool complete = false;
+    if (!ParseTransferRequest(out.emplace_back(), complete) || !SkipWs()) {
+      return false;
+    }
+    if (!complete) {
+      out.pop_back();
+      ++m_dropped;
+    }
+    if (*m_cur == ',') {
+      ++m_cur;
+      continue;
+    }
+    return Expect(']');
+  }
+}
+
+bool CarlaJsonDecoder::ParseTickBundle(Result& result,
+                                       std::vector<VehicleSample>& vehicles,
+                                       std::vector<TransferRequest>& requests) {
+  if (!Expect('{')) {
+    return false;
+  }
+  if (SkipWs() && *m_cur == '}') {
+    ++m_cur;
+    return true;
+  }
+  while (true) {
+    std::string_view key;
+    if (!ParseKey(key)) {
+      return false;
+    }
+    bool ok;
+    if (key == "vehicles_position") {
+      ok = ParseVehicleArray(vehicles);
+      result.hasVehicles = true;
+    } else if (key == "transfer_requests") {
+      ok = ParseTransferArray(requests);
+    } else if (key == "vehicles_num") {
+      double num = 0;
+      ok = ParseNumber(num);
+      result.vehiclesNum = static_cast<int>(num);
+      result.hasVehiclesNum = true;
+    } else if (key == "sync_request") {
+      ok = ParseSync(result.sync);
+      result.hasSync = true;
+    } else if (key == "vehicles_despawn") {
+      ok = ParseIntArray(result.despawned);
+    } else {
+      ok = SkipValue();
+    }
+    if (!ok || !SkipWs()) {
+      return false;
+    }
+    if (*m_cur == ',') {
+      ++m_cur;
+      continue;
+    }
+    return Expect('}');
+  }
+}
+
+bool CarlaJsonDecoder::ParseSync(SyncRequest& sync) {
+  if (!Expect('{')) {
+    return false;
+  }
+  if (SkipWs() && *m_cur == '}') {
+    ++m_cur;
+    return true;
+  }
+  while (true) {
+    std::string_view key;
+    if (!ParseKey(key)) {
+      return false;
+    }
+    bool ok;
+    if (key == "carla_time") {
+      ok = ParseNumber(sync.carlaTime);
+    } else if (key == "request_time") {
+      ok = ParseNumber(sync.requestTime);
+    } else {
+      ok = SkipValue();
+    }
+    if (!ok || !SkipWs()) {
+      return false;
+    }
+    if (*m_cur == ',') {
+      ++m_cur;
+      continue;
+    }
+    return Expect('}');
+  }
+}
+
+} // namespace ns3
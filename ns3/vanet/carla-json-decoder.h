@@ -0,0 +1,90 @@
+#ifndef CARLA_JSON_DECODER_H
+#define CARLA_JSON_DECODER_H
+
+#include "carla-messages.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Single-pass decoder for the JSON messages CARLA sends every tick
+ * (vehicles_position, transfer_requests, vehicles_num, vehicles_despawn,
+ * sync_request, or all of them at once in a tick_bundle).
+ *
+ * It walks the frame once and writes straight into the caller-owned, reused
+ * record vectors: no DOM, no exceptions and no per-field allocation. Unknown keys
+ * (heading, speed, ...) are skipped. Anything it does not understand is reported
+ * as UNSUPPORTED so the caller can fall back to the generic nlohmann::json path.
+ */
+class CarlaJsonDecoder {
+public:
+  enum class Type {
+    NONE,
+    VEHICLES_POSITION,
+    TRANSFER_REQUESTS,
+    VEHICLES_NUM,
+    SYNC_REQUEST,
+    VEHICLES_DESPAWN,
+    TICK_BUNDLE,
+  };
+
+  enum class Status {
+    OK,
+    UNSUPPORTED,  // valid-looking message outside the fast path (other types, escapes, ...)
+    MALFORMED,
+  };
+
+  struct Result {
+    Type type{Type::NONE};
+    int vehiclesNum{0};
+    SyncRequest sync;
+    double carlaTime{-1.0};  // optional sample time of a vehicles_position message
+    size_t droppedRecords{0};  // array entries missing required fields, already removed
+    std::vector<int> despawned;  // VEHICLES_DESPAWN, or a TICK_BUNDLE's vehicles_despawn
+    // Parts present in a TICK_BUNDLE
+    bool hasVehiclesNum{false};
+    bool hasVehicles{false};
+    bool hasSync{false};
+  };
+
+  // Records land in vehicles/requests; both are cleared first and keep their capacity.
+  Status Decode(std::string_view data,
+                Result& result,
+                std::vector<VehicleSample>& vehicles,
+                std::vector<TransferRequest>& requests);
+
+  // Byte offset at which the last MALFORMED/UNSUPPORTED decode stopped.
+  size_t GetErrorOffset() const;
+
+private:
+  bool SkipWs();
+  bool Expect(char c);
+  bool ParseKey(std::string_view& key);
+  bool ParseString(std::string_view& value);
+  bool ParseNumber(double& value);
+  bool SkipValue(int depth = 0);
+  bool ParseVector(Vector& v);
+  bool ParseVehicle(VehicleSample& v, bool& complete);
+  bool ParseVehicleArray(std::vector<VehicleSample>& out);
+  bool ParseIntArray(std::vector<int>& out);
+  bool ParseTransferRequest(TransferRequest& r, bool& complete);
+  bool ParseTransferArray(std::vector<TransferRequest>& out);
+  bool ParseSync(SyncRequest& sync);
+  bool ParseTickBundle(Result& result,
+                       std::vector<VehicleSample>& vehicles,
+                       std::vector<TransferRequest>& requests);
+
+  const char* m_begin{nullptr};
+  const char* m_cur{nullptr};
+  const char* m_end{nullptr};
+  bool m_unsupported{false};
+  size_t m_errorOffset{0};
+  size_t m_dropped{0};
+};
+
+} // namespace ns3
+
+#endif
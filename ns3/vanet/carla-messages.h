@@ -0,0 +1,77 @@
+#ifndef CARLA_MESSAGES_H
+#define CARLA_MESSAGES_H
+
+#include "ns3/vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+// Typed form of the inbound CARLA messages, shared by the JSON and binary decoders.
+
+struct VehicleSample {
+  int carlaId{-1};
+  int index{-1};
+  Vector position;
+  Vector velocity;
+  Vector acceleration;  // optional, zero if CARLA does not send it
+  double yawRate{0.0};  // rad/s, optional
+};
+
+struct TransferRequest {
+  int source{-1};
+  int target{-1};       // unused by a groupcast
+  int size{0};
+  int pktId{-1};
+  bool hasSubChannel{false};
+  uint8_t scStart{0};
+  uint8_t scNum{0};
+  double txPower{0.1};  // W, 0.1W = 20dBm
+  // Groupcast: sent once to the sidelink group; reported by the receivers in `targets`,
+  // or by every receiver within `radius` m, or (neither given) by all that decode it.
+  bool groupcast{false};
+  double radius{0.0};
+  std::vector<int> targets;
+};
+
+struct SyncRequest {
+  double carlaTime{0.0};
+  double requestTime{0.0};
+};
+
+// Latest vehicle states of the whole fleet, published by the bridge thread as one unit.
+struct VehicleStateSnapshot {
+  uint64_t seq{0};          // bumped on every publish
+  double carlaTime{-1.0};   // CARLA time the states were sampled at, < 0 if unknown
+  std::vector<VehicleSample> vehicles;
+};
+
+// One inbound message, queued by the bridge thread and applied on the simulator thread.
+struct CarlaCommand {
+  enum class Kind : uint8_t {
+    VEHICLES_NUM,
+    VEHICLES_POSITION,
+    TRANSFER_REQUESTS,
+    SYNC_REQUEST,
+    TICK_BUNDLE,  // all inputs of one tick; the parts present are flagged below
+    VEHICLES_DESPAWN,
+    KPI_REQUEST,  // publish a link_kpi summary now
+  };
+
+  Kind kind{Kind::VEHICLES_NUM};
+  bool hasVehiclesNum{false};
+  bool hasVehicles{false};
+  bool hasSync{false};
+  int vehiclesNum{0};
+  double vehiclesTime{-1.0};  // sample time of `vehicles`, < 0 if the message had none
+  SyncRequest sync;
+  // The vehicle states themselves are decoded straight into the back buffer of the
+  // vehicle state snapshot, which PushCommand() publishes.
+  std::vector<TransferRequest> requests;
+  std::vector<int> despawned;  // CARLA ids whose actors were destroyed
+};
+
+} // namespace ns3
+
+#endif
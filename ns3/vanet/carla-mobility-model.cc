@@ -0,0 +1,172 @@
+#include "carla-mobility-model.h"
+
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("CarlaMobilityModel");
+
+NS_OBJECT_ENSURE_REGISTERED(CarlaMobilityModel);
+
+namespace {
+
+constexpr double kMinSpeed = 1e-3;    // m/s, below this the heading is meaningless
+constexpr double kMinYawRate = 1e-6;  // rad/s, below this the track is a straight line
+
+} // namespace
+
+TypeId CarlaMobilityModel::GetTypeId() {
+  static TypeId tid =
+      TypeId("ns3::CarlaMobilityModel")
+          .SetParent<MobilityModel>()
+          .SetGroupName("Mobility")
+          .AddConstructor<CarlaMobilityModel>()
+          .AddAttribute("PositionTolerance",
+                        "A sample closer than this to the extrapolated position (m) is skipped",
+                        DoubleValue(0.02),
+                        MakeDoubleAccessor(&CarlaMobilityModel::m_positionTolerance),
+                        MakeDoubleChecker<double>(0.0))
+          .AddAttribute("VelocityTolerance",
+                        "A sample closer than this to the extrapolated velocity (m/s) is skipped",
+                        DoubleValue(0.02),
+                        MakeDoubleAccessor(&CarlaMobilityModel::m_velocityTolerance),
+                        MakeDoubleChecker<double>(0.0))
+          .AddAttribute("MaxExtrapolation",
+                        "How long after the last sample the position keeps being extrapolated",
+                        TimeValue(Seconds(1.0)),
+                        MakeTimeAccessor(&CarlaMobilityModel::m_maxExtrapolation),
+                        MakeTimeChecker());
+  return tid;
+}
+
+CarlaMobilityModel::CarlaMobilityModel()
+    : m_positionTolerance(0.02),
+      m_velocityTolerance(0.02),
+      m_maxExtrapolation(Seconds(1.0)) {}
+
+CarlaMobilityModel::~CarlaMobilityModel() = default;
+
+bool CarlaMobilityModel::SetState(Time sampleTime, const Vector& position, const Vector& velocity,
+                                  const Vector& acceleration, double yawRate) {
+  sampleTime = std::min(sampleTime, Simulator::Now());
+  if (m_hasSample) {
+    if (sampleTime < m_reference) {
+      return false;  // older than the state we already have
+    }
+    if (CalculateDistance(PositionAt(sampleTime), position) <= m_positionTolerance &&
+        CalculateDistance(VelocityAt(sampleTime), velocity) <= m_velocityTolerance) {
+      return false;
+    }
+  }
+
+  m_hasSample = true;
+  m_reference = sampleTime;
+  m_position = position;
+  m_velocity = velocity;
+  m_acceleration = acceleration;
+  m_yawRate = yawRate;
+  m_speed = std::hypot(velocity.x, velocity.y);
+  if (m_speed >= kMinSpeed) {
+    m_heading = std::atan2(velocity.y, velocity.x);
+    m_tangentialAcceleration = (acceleration.x * velocity.x + acceleration.y * velocity.y) / m_speed;
+  } else {
+    // Starting from standstill: the vehicle sets off along its acceleration.
+    m_speed = 0.0;
+    m_heading = std::atan2(acceleration.y, acceleration.x);
+    m_tangentialAcceleration = std::hypot(acceleration.x, acceleration.y);
+  }
+  m_stopAfter = (m_tangentialAcceleration < 0.0) ? m_speed / -m_tangentialAcceleration : -1.0;
+  NS_LOG_LOGIC("sample at " << sampleTime.As(Time::S) << " pos " << position << " vel " << velocity);
+  NotifyCourseChange();
+  return true;
+}
+
+double CarlaMobilityModel::Elapsed(Time t, bool& moving) const {
+  double dt = std::max(0.0, (t - m_reference).GetSeconds());
+  moving = true;
+  const double horizon = m_maxExtrapolation.GetSeconds();
+  if (dt >= horizon) {
+    dt = horizon;
+    moving = false;
+  }
+  if (m_stopAfter >= 0.0 && dt >= m_stopAfter) {
+    dt = m_stopAfter;
+    moving = false;
+  }
+  return dt;
+}
+
+Vector CarlaMobilityModel::PositionAt(Time t) const {
+  bool moving;
+  const double dt = Elapsed(t, moving);
+  const double speed = m_speed + m_tangentialAcceleration * dt;
+  const double heading = m_heading + m_yawRate * dt;
+  double dx;
+  double dy;
+  if (std::abs(m_yawRate) < kMinYawRate) {
+    const double distance = m_speed * dt + 0.5 * m_tangentialAcceleration * dt * dt;
+    dx = distance * std::cos(m_heading);
+    dy = distance * std::sin(m_heading);
+  } else {
+    // Closed-form integral of speed(t) * (cos, sin)(heading(t)).
+    const double w = m_yawRate;
+    const double a = m_tangentialAcceleration;
+    dx = (speed * w * std::sin(heading) - m_speed * w * std::sin(m_heading) +
+          a * (std::cos(heading) - std::cos(m_heading))) /
+         (w * w);
+    dy = (-speed * w * std::cos(heading) + m_speed * w * std::cos(m_heading) +
+          a * (std::sin(heading) - std::sin(m_heading))) /
+         (w * w);
+  }
+  const double dz = m_velocity.z * dt + 0.5 * m_acceleration.z * dt * dt;
+  return Vector(m_position.x + dx, m_position.y + dy, m_position.z + dz);
+}
+
+Vector CarlaMobilityModel::VelocityAt(Time t) const {
+  bool moving;
+  const double dt = Elapsed(t, moving);
+  if (!moving) {
+    return Vector(0.0, 0.0, 0.0);
+  }
+  const double speed = m_speed + m_tangentialAcceleration * dt;
+  const double heading = m_heading + m_yawRate * dt;
+  return Vector(speed * std::cos(heading), speed * std::sin(heading),
+                m_velocity.z + m_acceleration.z * dt);
+}
+
+Vector CarlaMobilityModel::DoGetPosition() const {
+  return PositionAt(Simulator::Now());
+}
+
+Vector CarlaMobilityModel::DoGetVelocity() const {
+  return VelocityAt(Simulator::Now());
+}
+
+void CarlaMobilityModel::DoSetPosition(const Vector& position) {
+  // Moves the vehicle but keeps its motion: the extrapolated velocity, the tangential
+  // acceleration along the current heading and the yaw rate carry on from there.
+  const Time now = Simulator::Now();
+  Vector velocity;
+  Vector acceleration;
+  double yawRate = 0.0;
+  if (m_hasSample) {
+    bool moving;
+    const double dt = Elapsed(now, moving);
+    if (moving) {
+      const double heading = m_heading + m_yawRate * dt;
+      velocity = VelocityAt(now);
+      acceleration = Vector(m_tangentialAcceleration * std::cos(heading),
+                            m_tangentialAcceleration * std::sin(heading), m_acceleration.z);
+      yawRate = m_yawRate;
+    }
+  }
+  m_hasSample = false;  // an explicit position always applies
+  SetState(now, position, velocity, acceleration, yawRate);
+}
+
+} // namespace ns3
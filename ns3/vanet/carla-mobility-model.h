@@ -0,0 +1,61 @@
+#ifndef CARLA_MOBILITY_MODEL_H
+#define CARLA_MOBILITY_MODEL_H
+
+#include "ns3/mobility-model.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/*
+ * Mobility driven by timestamped CARLA samples. Between two samples the position is
+ * dead-reckoned from the last one with a constant turn rate and acceleration model:
+ * the horizontal velocity turns at the yaw rate while the speed changes with the
+ * tangential acceleration; z follows plain constant acceleration.
+ *
+ * SetState() ignores a sample the extrapolation already predicts within the
+ * tolerances, so a vehicle that keeps its course (or stands still) does not fire
+ * CourseChange and does not invalidate channel state every tick. Extrapolation stops
+ * once the vehicle would come to a halt, and after MaxExtrapolation without samples.
+ */
+class CarlaMobilityModel : public MobilityModel {
+public:
+  static TypeId GetTypeId();
+  CarlaMobilityModel();
+  ~CarlaMobilityModel() override;
+
+  // Returns false if the sample was within the tolerances and therefore skipped.
+  bool SetState(Time sampleTime, const Vector& position, const Vector& velocity,
+                const Vector& acceleration, double yawRate);
+
+private:
+  Vector DoGetPosition() const override;
+  void DoSetPosition(const Vector& position) override;
+  Vector DoGetVelocity() const override;
+
+  Vector PositionAt(Time t) const;
+  Vector VelocityAt(Time t) const;
+  // Seconds from the reference sample to t, clamped to where extrapolation stops;
+  // `moving` turns false once it has.
+  double Elapsed(Time t, bool& moving) const;
+
+  Time m_reference;  // sample time of the state below
+  Vector m_position;
+  Vector m_velocity;
+  Vector m_acceleration;
+  double m_yawRate{0.0};
+  // Horizontal motion in polar form, derived from the sample.
+  double m_speed{0.0};
+  double m_heading{0.0};
+  double m_tangentialAcceleration{0.0};
+  double m_stopAfter{-1.0};  // s after m_reference the speed reaches zero, < 0 if never
+  bool m_hasSample{false};
+
+  double m_positionTolerance;
+  double m_velocityTolerance;
+  Time m_maxExtrapolation;
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,427 @@
+#include "carla-shm-transport.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <new>
+
+namespace ns3 {
+
+using namespace carla_shm;
+
+namespace {
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free");
+static_assert(sizeof(VehicleRecord) == 88, "VehicleRecord must match the wire record");
+
+constexpr uint64_t kRecordHeaderSize = 8;  // u32 length + u32 reserved
+// How long Stop() keeps offering the last results to a client that is still attached.
+constexpr std::chrono::milliseconds kStopFlushWait(1000);
+// Also bounds how long an enqueued result waits without an explicit Flush().
+constexpr std::chrono::milliseconds kLoopWait(10);
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint32_t RoundUpPow2(uint32_t value) {
+  uint32_t p = 64;
+  while (p < value) {
+    p <<= 1;
+  }
+  return p;
+}
+
+uint32_t* FutexWord(std::atomic<uint32_t>& word) {
+  return reinterpret_cast<uint32_t*>(&word);
+}
+
+void FutexWait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::milliseconds timeout) {
+  timespec ts{};
+  ts.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  ts.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+  syscall(SYS_futex, FutexWord(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>& word) {
+  syscall(SYS_futex, FutexWord(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+// Copies len bytes to/from the ring starting at logical offset pos, wrapping once.
+void CopyIn(uint8_t* data, uint32_t capacity, uint64_t pos, const void* src, size_t len) {
+  const size_t offset = pos & (capacity - 1);
+  const size_t first = std::min<size_t>(len, capacity - offset);
+  std::memcpy(data + offset, src, first);
+  std::memcpy(data, static_cast<const uint8_t*>(src) + first, len - first);
+}
+
+void CopyOut(const uint8_t* data, uint32_t capacity, uint64_t pos, void* dst, size_t len) {
+  const size_t offset = pos & (capacity - 1);
+  const size_t first = std::min<size_t>(len, capacity - offset);
+  std::memcpy(dst, data + offset, first);
+  std::memcpy(static_cast<uint8_t*>(dst) + first, data, len - first);
+}
+
+void InitRing(RingControl& ring, uint64_t dataOffset, uint32_t capacity) {
+  ring.head.store(0);
+  ring.tail.store(0);
+  ring.wakeSeq.store(0);
+  ring.sleeping.store(0);
+  ring.dataOffset = dataOffset;
+  ring.capacity = capacity;
+}
+
+} // namespace
+
+CarlaShmTransport::~CarlaShmTransport() {
+  Stop();
+  if (m_base != nullptr) {
+    if (!m_owner && m_header != nullptr) {
+      m_header->clientAttached.store(0);
+    }
+    munmap(m_base, m_size);
+    m_base = nullptr;
+    m_header = nullptr;
+  }
+  if (m_owner) {
+    shm_unlink(m_name.c_str());
+  }
+}
+
+bool CarlaShmTransport::Map(int fd, size_t size) {
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    perror("[ERR] mmap of shared-memory transport failed");
+    return false;
+  }
+  m_base = static_cast<uint8_t*>(addr);
+  m_size = size;
+  m_header = reinterpret_cast<SegmentHeader*>(m_base);
+  return true;
+}
+
+bool CarlaShmTransport::Create(const std::string& name, uint32_t ringBytes, uint32_t maxVehicles) {
+  const uint32_t ringCapacity = RoundUpPow2(ringBytes);
+  const uint64_t headerSize = AlignUp(sizeof(SegmentHeader), 64);
+  const uint64_t tableBytes = AlignUp(uint64_t(maxVehicles) * sizeof(VehicleRecord), 64);
+  const uint64_t size = headerSize + 2 * uint64_t(ringCapacity) + 2 * tableBytes;
+
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    if (errno == EEXIST) {
+      std::cerr << "[ERR] Shared-memory segment " << name << " already exists: another ns-3 "
+                << "instance uses it, or a crashed run left it behind (remove /dev/shm" << name
+                << " or pick another --shmName)\n";
+    } else {
+      perror("[ERR] shm_open failed");
+    }
+    return false;
+  }
+  if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+    perror("[ERR] ftruncate of shared-memory segment failed");
+    close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  m_name = name;
+  m_owner = true;
+  if (!Map(fd, size)) {
+    return false;
+  }
+
+  SegmentHeader* header = new (m_base) SegmentHeader();
+  header->size = size;
+  header->clientAttached.store(0);
+  InitRing(header->commands, headerSize, ringCapacity);
+  InitRing(header->results, headerSize + ringCapacity, ringCapacity);
+  header->vehicles.seq.store(0);
+  header->vehicles.published.store(0);
+  header->vehicles.count[0] = header->vehicles.count[1] = 0;
+  header->vehicles.carlaTime[0] = header->vehicles.carlaTime[1] = -1.0;
+  header->vehicles.capacity = maxVehicles;
+  header->vehicles.dataOffset[0] = headerSize + 2 * uint64_t(ringCapacity);
+  header->vehicles.dataOffset[1] = header->vehicles.dataOffset[0] + tableBytes;
+  header->version = kVersion;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kMagic;
+
+  std::cout << "[INFO] Shared-memory transport " << name << " created ("
+            << (size >> 10) << " KiB, rings " << (ringCapacity >> 10) << " KiB, "
+            << maxVehicles << " vehicles)\n";
+  return true;
+}
+
+bool CarlaShmTransport::Attach(const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    perror("[ERR] shm_open failed");
+    return false;
+  }
+  struct stat st{};
+  if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+    std::cerr << "[ERR] Shared-memory segment " << name << " is not initialized\n";
+    close(fd);
+    return false;
+  }
+  m_name = name;
+  m_owner = false;
+  if (!Map(fd, static_cast<size_t>(st.st_size))) {
+    return false;
+  }
+  if (m_header->magic != kMagic || m_header->version != kVersion || m_header->size != m_size) {
+    std::cerr << "[ERR] Shared-memory segment " << name << " has an incompatible layout\n";
+    return false;
+  }
+  m_header->clientAttached.store(1);
+  return true;
+}
+
+void CarlaShmTransport::SetCommandHandler(CommandHandler handler) {
+  m_commandHandler = std::move(handler);
+}
+
+void CarlaShmTransport::SetVehicleTableHandler(VehicleTableHandler handler) {
+  m_vehicleTableHandler = std::move(handler);
+}
+
+bool CarlaShmTransport::Start() {
+  if (m_header == nullptr || !m_owner) {
+    return false;
+  }
+  m_running = true;
+  m_thread = std::thread(&CarlaShmTransport::Loop, this);
+  return true;
+}
+
+void CarlaShmTransport::Stop() {
+  if (m_thread.joinable()) {
+    const auto deadline = std::chrono::steady_clock::now() + kStopFlushWait;
+    while (!Flush() && IsClientAttached() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    m_running = false;
+    // Wake the loop in case it sleeps on the command ring.
+    m_header->commands.wakeSeq.fetch_add(1);
+    FutexWake(m_header->commands.wakeSeq);
+    m_thread.join();
+  }
+}
+
+bool CarlaShmTransport::IsClientAttached() const {
+  return m_header != nullptr && m_header->clientAttached.load() != 0;
+}
+
+size_t CarlaShmTransport::GetDroppedMessages() const {
+  return m_droppedMessages;
+}
+
+bool CarlaShmTransport::Enqueue(std::string msg, bool queueWhileDisconnected) {
+  if (!queueWhileDisconnected && !IsClientAttached()) {
+    return false;
+  }
+  m_outQueue.Push(std::move(msg));
+  return true;
+}
+
+bool CarlaShmTransport::Flush() {
+  if (m_header == nullptr) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(m_flushMutex);
+  RingControl& ring = m_header->results;
+  while (!m_backlog.empty() && RingWrite(m_base, ring, m_backlog.front())) {
+    m_backlogBytes -= m_backlog.front().size();
+    m_backlog.pop_front();
+  }
+  std::string msg;
+  while (m_outQueue.Pop(msg)) {
+    if (m_backlog.empty() && RingWrite(m_base, ring, msg)) {
+      continue;
+    }
+    // The ring is full because CARLA is not reading right now; keep the order and retry
+    // on the next Flush() rather than stalling the caller (often the simulator thread).
+    if (kRecordHeaderSize + msg.size() > ring.capacity ||
+        m_backlogBytes + msg.size() > kMaxBacklogBytes) {
+      if (m_droppedMessages.fetch_add(1) == 0) {
+        std::cerr << "[WARN] Shared-memory results backlog full (" << m_backlogBytes
+                  << " bytes), dropping messages; further drops are only counted\n";
+      }
+      continue;
+    }
+    m_backlogBytes += msg.size();
+    m_backlog.push_back(std::move(msg));
+  }
+  return m_backlog.empty();
+}
+
+void CarlaShmTransport::Loop() {
+  std::string record;
+  std::vector<VehicleSample> vehicles;
+  double carlaTime = -1.0;
+  while (m_running) {
+    bool any = false;
+    // Checked before every record so a table published ahead of a sync_request is
+    // always handed over first.
+    if (ReadVehicleTable(vehicles, carlaTime) && m_vehicleTableHandler) {
+      m_vehicleTableHandler(vehicles, carlaTime);
+    }
+    while (RingRead(m_base, m_header->commands, record)) {
+      any = true;
+      if (ReadVehicleTable(vehicles, carlaTime) && m_vehicleTableHandler) {
+        m_vehicleTableHandler(vehicles, carlaTime);
+      }
+      if (m_commandHandler) {
+        m_commandHandler(record);
+      }
+    }
+    Flush();
+    if (!any) {
+      RingWait(m_header->commands, kLoopWait);
+    }
+  }
+}
+
+bool CarlaShmTransport::ReadVehicleTable(std::vector<VehicleSample>& out, double& carlaTime) {
+  VehicleTableControl& table = m_header->vehicles;
+  while (true) {
+    const uint32_t seq = table.seq.load(std::memory_order_acquire);
+    if (seq == m_lastTableSeq) {
+      return false;
+    }
+    const uint32_t buffer = table.published.load(std::memory_order_acquire);
+    const uint32_t count = std::min(table.count[buffer], table.capacity);
+    carlaTime = table.carlaTime[buffer];
+    const auto* records = reinterpret_cast<const VehicleRecord*>(m_base + table.dataOffset[buffer]);
+    out.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      VehicleRecord r;
+      std::memcpy(&r, records + i, sizeof(r));
+      out[i].carlaId = r.carlaId;
+      out[i].index = r.index;
+      out[i].position = Vector(r.position[0], r.position[1], r.position[2]);
+      out[i].velocity = Vector(r.velocity[0], r.velocity[1], r.velocity[2]);
+      out[i].acceleration = Vector(r.acceleration[0], r.acceleration[1], r.acceleration[2]);
+      out[i].yawRate = r.yawRate;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Another publish during the copy may have reused this buffer: copy again.
+    if (table.seq.load(std::memory_order_relaxed) == seq) {
+      m_lastTableSeq = seq;
+      return true;
+    }
+  }
+}
+
+bool CarlaShmTransport::PublishVehicles(const std::vector<VehicleSample>& vehicles, double carlaTime) {
+  if (m_header == nullptr) {
+    return false;
+  }
+  VehicleTableControl& table = m_header->vehicles;
+  if (vehicles.size() > table.capacity) {
+    std::cerr << "[ERR] " << vehicles.size() << " vehicles exceed the shared table capacity "
+              << table.capacity << "\n";
+    return false;
+  }
+  const uint32_t buffer = 1 - table.published.load(std::memory_order_relaxed);
+  auto* records = reinterpret_cast<VehicleRecord*>(m_base + table.dataOffset[buffer]);
+  for (size_t i = 0; i < vehicles.size(); ++i) {
+    const VehicleSample& v = vehicles[i];
+    const VehicleRecord r{v.carlaId, v.index,
+                          {v.position.x, v.position.y, v.position.z},
+                          {v.velocity.x, v.velocity.y, v.velocity.z},
+                          {v.acceleration.x, v.acceleration.y, v.acceleration.z},
+                          v.yawRate};
+    std::memcpy(records + i, &r, sizeof(r));
+  }
+  table.count[buffer] = static_cast<uint32_t>(vehicles.size());
+  table.carlaTime[buffer] = carlaTime;
+  table.published.store(buffer, std::memory_order_release);
+  table.seq.fetch_add(1, std::memory_order_acq_rel);
+  // Let a sleeping ns-3 loop pick the table up even without a following command.
+  RingControl& ring = m_header->commands;
+  ring.wakeSeq.fetch_add(1);
+  if (ring.sleeping.load()) {
+    FutexWake(ring.wakeSeq);
+  }
+  return true;
+}
+
+bool CarlaShmTransport::SendCommand(std::string_view msg) {
+  return m_header != nullptr && RingWrite(m_base, m_header->commands, msg);
+}
+
+bool CarlaShmTransport::ReceiveResult(std::string& msg, std::chrono::milliseconds timeout) {
+  if (m_header == nullptr) {
+    return false;
+  }
+  if (RingRead(m_base, m_header->results, msg)) {
+    return true;
+  }
+  RingWait(m_header->results, timeout);
+  return RingRead(m_base, m_header->results, msg);
+}
+
+bool CarlaShmTransport::RingWrite(uint8_t* base, RingControl& ring, std::string_view record) {
+  const uint64_t need = kRecordHeaderSize + AlignUp(record.size(), 8);
+  if (need > ring.capacity) {
+    return false;
+  }
+  const uint64_t head = ring.head.load(std::memory_order_relaxed);
+  const uint64_t tail = ring.tail.load(std::memory_order_acquire);
+  if (ring.capacity - (head - tail) < need) {
+    return false;
+  }
+  uint8_t* data = base + ring.dataOffset;
+  const uint32_t header[2] = {static_cast<uint32_t>(record.size()), 0};
+  CopyIn(data, ring.capacity, head, header, sizeof(header));
+  CopyIn(data, ring.capacity, head + kRecordHeaderSize, record.data(), record.size());
+  ring.head.store(head + need);
+  ring.wakeSeq.fetch_add(1);
+  if (ring.sleeping.load()) {
+    FutexWake(ring.wakeSeq);
+  }
+  return true;
+}
+
+bool CarlaShmTransport::RingRead(uint8_t* base, RingControl& ring, std::string& record) {
+  const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+  const uint64_t head = ring.head.load(std::memory_order_acquire);
+  if (head == tail) {
+    return false;
+  }
+  const uint8_t* data = base + ring.dataOffset;
+  uint32_t header[2];
+  CopyOut(data, ring.capacity, tail, header, sizeof(header));
+  if (header[0] > head - tail - kRecordHeaderSize) {
+    std::cerr << "[ERR] Corrupt shared-memory ring record, resetting the ring\n";
+    ring.tail.store(head, std::memory_order_release);
+    return false;
+  }
+  record.resize(header[0]);
+  CopyOut(data, ring.capacity, tail + kRecordHeaderSize, record.data(), header[0]);
+  ring.tail.store(tail + kRecordHeaderSize + AlignUp(header[0], 8), std::memory_order_release);
+  return true;
+}
+
+void CarlaShmTransport::RingWait(RingControl& ring, std::chrono::milliseconds timeout) {
+  const uint32_t seq = ring.wakeSeq.load();
+  ring.sleeping.store(1);
+  if (ring.head.load() == ring.tail.load(std::memory_order_relaxed)) {
+    FutexWait(ring.wakeSeq, seq, timeout);
+  }
+  ring.sleeping.store(0);
+}
+
+} // namespace ns3
@@ -0,0 +1,157 @@
+#ifndef CARLA_SHM_TRANSPORT_H
+#define CARLA_SHM_TRANSPORT_H
+
+#include "carla-messages.h"
+#include "mpsc-queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Shared-memory replacement for the two loopback TCP connections when CARLA's
+ * bridge runs on the same host. One POSIX shm segment holds
+ *   - a command ring (CARLA -> ns-3) and a result ring (ns-3 -> CARLA), both
+ *     single-producer/single-consumer byte rings of length-prefixed records. A record
+ *     is one message exactly as it would travel over TCP: a JSON message (without the
+ *     "\n\r" delimiter) or a binary wire-format frame (see carla-wire-format.h);
+ *   - a double-buffered vehicle-state table CARLA publishes every tick, so positions
+ *     do not have to be serialized at all.
+ * Consumers sleep on a futex in the ring and producers only wake them when they
+ * actually sleep.
+ *
+ * ns-3 creates the segment (Create + Start); the CARLA side attaches to it (Attach)
+ * and uses PublishVehicles / SendCommand / ReceiveResult, or is the Python client in
+ * src/bridge/carla_ns3_shm.py.
+ */
+namespace carla_shm {
+
+constexpr uint32_t kMagic = 0x4D534E43;  // "CNSM"
+constexpr uint32_t kVersion = 2;
+
+struct alignas(64) RingControl {
+  std::atomic<uint64_t> head;  // bytes produced
+  char pad0[56];
+  std::atomic<uint64_t> tail;  // bytes consumed
+  char pad1[56];
+  std::atomic<uint32_t> wakeSeq;   // futex word, bumped after every record
+  std::atomic<uint32_t> sleeping;  // consumer is (about to be) blocked on wakeSeq
+  uint64_t dataOffset;
+  uint32_t capacity;  // power of two
+};
+
+// Same fields as the binary VEHICLES_POSITION kinematics record.
+struct VehicleRecord {
+  int32_t carlaId;
+  int32_t index;
+  double position[3];
+  double velocity[3];
+  double acceleration[3];
+  double yawRate;  // rad/s
+};
+
+struct alignas(64) VehicleTableControl {
+  std::atomic<uint32_t> seq;        // bumped after every publish
+  std::atomic<uint32_t> published;  // buffer (0/1) readers should use
+  uint32_t count[2];
+  double carlaTime[2];              // sample time of each buffer, < 0 if unknown
+  uint32_t capacity;                // records per buffer
+  uint64_t dataOffset[2];
+};
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;
+  std::atomic<uint32_t> clientAttached;
+  RingControl commands;
+  RingControl results;
+  VehicleTableControl vehicles;
+};
+
+} // namespace carla_shm
+
+class CarlaShmTransport {
+public:
+  // Called on the transport thread for every command record.
+  using CommandHandler = std::function<void(std::string_view)>;
+  // Called on the transport thread when CARLA published a new vehicle table (with its
+  // sample time, < 0 if unknown); always before the command records that follow it.
+  // The handler may swap the table out; whatever vector it leaves is reused as is.
+  using VehicleTableHandler = std::function<void(std::vector<VehicleSample>&, double)>;
+
+  CarlaShmTransport() = default;
+  ~CarlaShmTransport();
+
+  CarlaShmTransport(const CarlaShmTransport&) = delete;
+  CarlaShmTransport& operator=(const CarlaShmTransport&) = delete;
+
+  // ---- ns-3 side ----
+  // Fails if a segment of that name exists: another ns-3 instance owns it, or a crashed
+  // run left it behind (remove it from /dev/shm then).
+  bool Create(const std::string& name, uint32_t ringBytes = 4 * 1024 * 1024,
+              uint32_t maxVehicles = 4096);
+  void SetCommandHandler(CommandHandler handler);
+  void SetVehicleTableHandler(VehicleTableHandler handler);
+  bool Start();
+  void Stop();
+  // Same contract as CarlaBridgeIo: Enqueue() from any thread, Flush() writes the
+  // queued messages into the result ring. Flush() never waits: what does not fit stays
+  // queued, in order, for a later Flush() (the transport thread flushes every few ms);
+  // only a backlog beyond kMaxBacklogBytes drops messages. Returns true if nothing is
+  // left queued.
+  bool Enqueue(std::string msg, bool queueWhileDisconnected = true);
+  bool Flush();
+  bool IsClientAttached() const;
+
+  // ---- CARLA side ----
+  bool Attach(const std::string& name);
+  bool PublishVehicles(const std::vector<VehicleSample>& vehicles, double carlaTime = -1.0);
+  bool SendCommand(std::string_view msg);
+  bool ReceiveResult(std::string& msg, std::chrono::milliseconds timeout);
+
+  size_t GetDroppedMessages() const;
+
+private:
+  bool Map(int fd, size_t size);
+  void Loop();
+  bool ReadVehicleTable(std::vector<VehicleSample>& out, double& carlaTime);
+
+  static bool RingWrite(uint8_t* base, carla_shm::RingControl& ring, std::string_view record);
+  static bool RingRead(uint8_t* base, carla_shm::RingControl& ring, std::string& record);
+  static void RingWait(carla_shm::RingControl& ring, std::chrono::milliseconds timeout);
+
+  std::string m_name;
+  bool m_owner{false};
+  uint8_t* m_base{nullptr};
+  size_t m_size{0};
+  carla_shm::SegmentHeader* m_header{nullptr};
+
+  CommandHandler m_commandHandler;
+  VehicleTableHandler m_vehicleTableHandler;
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  uint32_t m_lastTableSeq{0};
+
+  static constexpr size_t kMaxBacklogBytes = 16 * 1024 * 1024;
+
+  MpscQueue<std::string> m_outQueue;
+  std::mutex m_flushMutex;  // Flush() may be called from more than one thread
+  std::deque<std::string> m_backlog;  // did not fit into the result ring yet; m_flushMutex
+  size_t m_backlogBytes{0};
+  std::atomic<size_t> m_droppedMessages{0};
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,137 @@
+#include "carla-wire-format.h"
+
+#include <bit>
+#include <cstring>
+
+namespace ns3 {
+namespace carla_wire {
+
+namespace {
+
+template <typename T>
+T Load(const char* p) {
+  T value;
+  if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1) {
+    std::memcpy(&value, p, sizeof(T));
+  } else {
+    unsigned char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = static_cast<unsigned char>(p[sizeof(T) - 1 - i]);
+    }
+    std::memcpy(&value, bytes, sizeof(T));
+  }
+  return value;
+}
+
+bool HasRecords(const FrameHeader& header, std::string_view frame, size_t recordSize,
+                size_t prefixSize = 0) {
+  return header.payloadLength == prefixSize + static_cast<uint64_t>(header.count) * recordSize &&
+         frame.size() == kHeaderSize + header.payloadLength;
+}
+
+} // namespace
+
+bool DecodeHeader(std::string_view frame, FrameHeader& header, const char*& error) {
+  if (frame.size() < kHeaderSize) {
+    error = "frame shorter than header";
+    return false;
+  }
+  const char* p = frame.data();
+  header.magic = Load<uint32_t>(p);
+  header.version = Load<uint8_t>(p + 4);
+  header.type = static_cast<MessageType>(Load<uint8_t>(p + 5));
+  header.flags = Load<uint16_t>(p + 6);
+  header.count = Load<uint32_t>(p + 8);
+  header.payloadLength = Load<uint32_t>(p + kLengthOffset);
+  if (header.magic != kMagic) {
+    error = "bad magic";
+    return false;
+  }
+  if (header.version != kVersion) {
+    error = "unsupported version";
+    return false;
+  }
+  if (frame.size() != kHeaderSize + header.payloadLength) {
+    error = "payload length mismatch";
+    return false;
+  }
+  return true;
+}
+
+bool DecodeVehicles(const FrameHeader& header, std::string_view frame,
+                    std::vector<VehicleSample>& out, double& carlaTime) {
+  const bool kinematics = (header.flags & kVehicleFlagKinematics) != 0;
+  const size_t recordSize = kinematics ? kKinematicVehicleRecordSize : kVehicleRecordSize;
+  const size_t prefixSize = kinematics ? sizeof(double) : 0;
+  if (!HasRecords(header, frame, recordSize, prefixSize)) {
+    return false;
+  }
+  const char* p = frame.data() + kHeaderSize;
+  carlaTime = kinematics ? Load<double>(p) : -1.0;
+  p += prefixSize;
+  out.reserve(out.size() + header.count);
+  for (uint32_t i = 0; i < header.count; ++i, p += recordSize) {
+    VehicleSample& v = out.emplace_back();
+    v.carlaId = Load<int32_t>(p);
+    v.index = Load<int32_t>(p + 4);
+    v.position = Vector(Load<double>(p + 8), Load<double>(p + 16), Load<double>(p + 24));
+    v.velocity = Vector(Load<double>(p + 32), Load<double>(p + 40), Load<double>(p + 48));
+    if (kinematics) {
+      v.acceleration = Vector(Load<double>(p + 56), Load<double>(p + 64), Load<double>(p + 72));
+      v.yawRate = Load<double>(p + 80);
+    }
+  }
+  return true;
+}
+
+bool DecodeTransferRequests(const FrameHeader& header, std::string_view frame,
+                            std::vector<TransferRequest>& out) {
+  if (!HasRecords(header, frame, kTransferRecordSize)) {
+    return false;
+  }
+  out.reserve(out.size() + header.count);
+  const char* p = frame.data() + kHeaderSize;
+  for (uint32_t i = 0; i < header.count; ++i, p += kTransferRecordSize) {
+    TransferRequest& r = out.emplace_back();
+    const uint8_t flags = Load<uint8_t>(p + 16);
+    r.source = Load<int32_t>(p);
+    r.target = Load<int32_t>(p + 4);
+    r.size = Load<int32_t>(p + 8);
+    r.pktId = Load<int32_t>(p + 12);
+    r.hasSubChannel = (flags & kTransferFlagSubChannel) != 0;
+    r.groupcast = (flags & kTransferFlagGroupcast) != 0;
+    if (r.groupcast) {
+      r.radius = r.target;
+      r.target = -1;
+    }
+    r.scStart = Load<uint8_t>(p + 17);
+    r.scNum = Load<uint8_t>(p + 18);
+    r.txPower = Load<double>(p + 20);
+  }
+  return true;
+}
+
+bool DecodeSyncRequest(const FrameHeader& header, std::string_view frame, SyncRequest& out) {
+  if (header.count != 1 || !HasRecords(header, frame, kSyncRecordSize)) {
+    return false;
+  }
+  const char* p = frame.data() + kHeaderSize;
+  out.carlaTime = Load<double>(p);
+  out.requestTime = Load<double>(p + 8);
+  return true;
+}
+
+bool DecodeDespawn(const FrameHeader& header, std::string_view frame, std::vector<int>& out) {
+  if (!HasRecords(header, frame, kDespawnRecordSize)) {
+    return false;
+  }
+  out.reserve(out.size() + header.count);
+  const char* p = frame.data() + kHeaderSize;
+  for (uint32_t i = 0; i < header.count; ++i, p += kDespawnRecordSize) {
+    out.push_back(Load<int32_t>(p));
+  }
+  return true;
+}
+
+} // namespace carla_wire
+} // namespace ns3
@@ -0,0 +1,92 @@
+#ifndef CARLA_WIRE_FORMAT_H
+#define CARLA_WIRE_FORMAT_H
+
+#include "carla-messages.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Optional binary encoding of the CARLA -> ns-3 messages. A client switches to it by
+ * sending the JSON handshake {"type": "wire_format", "wire_format": "binary"}; every
+ * following frame on the connection is then length-prefixed instead of "\n\r"-delimited.
+ *
+ * All integers and floats are little-endian. Every frame starts with a 16-byte header:
+ *   u32 magic "CNS3" | u8 version | u8 type | u16 flags | u32 count | u32 payload length
+ * followed by `count` packed records:
+ *   VEHICLES_POSITION  56 B: i32 carla_id, i32 index, f64 pos xyz, f64 vel xyz
+ *                      With flags bit0 (kinematics) the payload starts with f64 carla_time
+ *                      (sample time) and each record grows to 88 B: the 56 B above,
+ *                      then f64 accel xyz, f64 yaw_rate (rad/s)
+ *   TRANSFER_REQUESTS  28 B: i32 source, i32 target, i32 size, i32 pkt_id,
+ *                            u8 flags (bit0: sc_start/sc_num valid, bit1: groupcast),
+ *                            u8 sc_start, u8 sc_num, u8 reserved, f64 tx_power
+ *                      A groupcast carries its radius in m in `target` (0: no radius);
+ *                      target lists are JSON only
+ *   VEHICLES_NUM        0 B: the vehicle count travels in the header `count` field
+ *   SYNC_REQUEST       16 B: f64 carla_time, f64 request_time (count = 1)
+ *   WIRE_FORMAT         0 B: switches the connection back to JSON (`count` is ignored)
+ *   VEHICLES_DESPAWN    4 B: i32 carla_id
+ *   KPI_REQUEST         0 B: asks for a link_kpi summary (count = 0)
+ */
+namespace carla_wire {
+
+constexpr uint32_t kMagic = 0x334E5343;  // "CNS3"
+constexpr uint8_t kVersion = 1;
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kLengthOffset = 12;
+
+constexpr size_t kVehicleRecordSize = 56;
+constexpr size_t kKinematicVehicleRecordSize = 88;
+constexpr size_t kTransferRecordSize = 28;
+constexpr size_t kSyncRecordSize = 16;
+constexpr size_t kDespawnRecordSize = 4;
+
+constexpr uint8_t kTransferFlagSubChannel = 0x01;
+constexpr uint8_t kTransferFlagGroupcast = 0x02;
+constexpr uint16_t kVehicleFlagKinematics = 0x0001;
+
+enum class MessageType : uint8_t {
+  VEHICLES_POSITION = 1,
+  TRANSFER_REQUESTS = 2,
+  VEHICLES_NUM = 3,
+  SYNC_REQUEST = 4,
+  WIRE_FORMAT = 5,
+  VEHICLES_DESPAWN = 6,
+  KPI_REQUEST = 7,
+};
+
+enum class Format : uint8_t {
+  JSON = 0,
+  BINARY = 1,
+};
+
+struct FrameHeader {
+  uint32_t magic{0};
+  uint8_t version{0};
+  MessageType type{MessageType::VEHICLES_POSITION};
+  uint16_t flags{0};
+  uint32_t count{0};
+  uint32_t payloadLength{0};
+};
+
+// Validates the fixed header; returns false (and leaves `error` set) on a malformed frame.
+bool DecodeHeader(std::string_view frame, FrameHeader& header, const char*& error);
+
+// Decoders append into caller-owned vectors so their capacity is reused across ticks.
+// carlaTime is set to the sample time of a kinematics frame, -1 otherwise.
+bool DecodeVehicles(const FrameHeader& header, std::string_view frame,
+                    std::vector<VehicleSample>& out, double& carlaTime);
+bool DecodeTransferRequests(const FrameHeader& header, std::string_view frame,
+                            std::vector<TransferRequest>& out);
+bool DecodeSyncRequest(const FrameHeader& header, std::string_view frame, SyncRequest& out);
+bool DecodeDespawn(const FrameHeader& header, std::string_view frame, std::vector<int>& out);
+
+} // namespace carla_wire
+} // namespace ns3
+
+#endif
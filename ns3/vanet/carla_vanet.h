@@ -1,20 +1,37 @@
 #ifndef CARLA_VANET_H
 #define CARLA_VANET_H
+#include "carla-messages.h"
+
 #include <nlohmann/json.hpp>
+#include <string_view>
+#include <vector>
 using json = nlohmann::json;
 
-void ProcessData_VehiclePosition(const json& vehicleArray);
-void ProcessData_TransferRequests(const json &requests);
+namespace ns3 {
+class IngressFramer;
+}
+
+void ProcessData_VehiclePosition(const std::vector<ns3::VehicleSample> &vehicleArray);
+void ProcessData_TransferRequests(const std::vector<ns3::TransferRequest> &requests);
 void ProcessData_VehiclesNum(const int &num);
-void ProcessJsonData(const std::string &data);
-void ProcessReceivedData(std::string &receive_buffer);
+void ProcessData_VehiclesDespawn(const std::vector<int> &carlaIds);
+void ProcessData_SyncRequest(const ns3::SyncRequest &syncData);
+void ProcessJsonData(std::string_view data);
+void ProcessBinaryData(std::string_view data);
+void ProcessReceivedData(ns3::IngressFramer &framer);
 
 void SocketServerThread();
 void UpdateVehiclePositions();
 void SendSimulationEndSignal();
-void SendMsgToCarla(const std::string &msg, bool try_reconnect);
-void SocketSenderServerConnect();
+void SendMsgToCarla(std::string msg, bool try_reconnect);
+void FlushMsgsToCarla();
+void ReportReception(const std::string &msg);
 void SocketSenderServerDisconnect();
+bool WaitForSyncRequest();
+void AckSyncTargetsWithinLookahead();
+void CompleteSyncTarget(double carlaTime);
+bool ScheduleSyncGate();
+void SyncGate(double carlaTime);
 
 void InitializeVehicles_DSRC(uint32_t nVehicles);
 void InitializeVehicles_NR_V2X_Mode2(uint32_t nVehicles);
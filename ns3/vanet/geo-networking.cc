@@ -1,10 +1,45 @@
 #include "geo-networking.h"
+
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <limits>
 
 namespace ns3 {
 
+namespace {
+// Compact encodings: steps per unit of each fixed-point field. Decoding divides, so
+// a value already on the grid (12.3 m, ...) comes back as exactly the same double.
+constexpr double kPositionScale = 10.0;  // 0.1 m
+constexpr double kSpeedScale = 100.0;    // 0.01 m/s
+constexpr double kHeadingScale = 10.0;   // 0.1 deg
+
+template <typename T>
+T ToFixed(double value, double scale) {
+  const double scaled = std::round(value * scale);
+  return static_cast<T>(std::clamp<double>(scaled, std::numeric_limits<T>::min(),
+                                           std::numeric_limits<T>::max()));
+}
+
+// Latest time <= nowMs whose low 16 bits are deltaMs (ETSI generationDeltaTime).
+uint64_t ExpandDeltaTime(uint16_t deltaMs, uint64_t nowMs) {
+  uint64_t t = (nowMs & ~uint64_t{0xFFFF}) | deltaMs;
+  if (t > nowMs && t >= 0x10000) {
+    t -= 0x10000;
+  }
+  return t;
+}
+} // namespace
+
+bool GeoNetHeader::s_compact = false;
+
+void GeoNetHeader::SetCompactEncoding(const bool compact) { s_compact = compact; }
+
 GeoNetHeader::GeoNetHeader()
-    : m_version(1),
+    : m_compact(s_compact),
+      m_version(1),
       m_nextHeader(PROT_NUM_CAM),
       m_messageType(GEOBROADCAST),
       m_sourcePositionX(0.0),
@@ -26,7 +61,7 @@ TypeId GeoNetHeader::GetInstanceTypeId() const { return GetTypeId(); }
 
 uint32_t GeoNetHeader::GetSerializedSize() const {
   // version + nextHeader + messageType + posX + posY + sourceId + radius + lifetime
-  return 1 + 1 + 1 + 8 + 8 + 4 + 2 + 2;
+  return 1 + 1 + 1 + (m_compact ? 4 + 4 : 8 + 8) + 4 + 2 + 2;
 }
 
 void GeoNetHeader::Serialize(Buffer::Iterator start) const {
@@ -34,13 +69,18 @@ void GeoNetHeader::Serialize(Buffer::Iterator start) const {
   start.WriteU8(m_nextHeader);
   start.WriteU8(static_cast<uint8_t>(m_messageType));
 
-  uint64_t posX;
-  uint64_t posY;
-  std::memcpy(&posX, &m_sourcePositionX, sizeof(double));
-  std::memcpy(&posY, &m_sourcePositionY, sizeof(double));
+  if (m_compact) {
+    start.WriteHtonU32(static_cast<uint32_t>(ToFixed<int32_t>(m_sourcePositionX, kPositionScale)));
+    start.WriteHtonU32(static_cast<uint32_t>(ToFixed<int32_t>(m_sourcePositionY, kPositionScale)));
+  } else {
+    uint64_t posX;
+    uint64_t posY;
+    std::memcpy(&posX, &m_sourcePositionX, sizeof(double));
+    std::memcpy(&posY, &m_sourcePositionY, sizeof(double));
 
-  start.WriteHtonU64(posX);
-  start.WriteHtonU64(posY);
+    start.WriteHtonU64(posX);
+    start.WriteHtonU64(posY);
+  }
 
   start.WriteHtonU32(m_sourceId);
   start.WriteHtonU16(m_radius);
@@ -52,11 +92,16 @@ uint32_t GeoNetHeader::Deserialize(Buffer::Iterator start) {
   m_nextHeader = start.ReadU8();
   m_messageType = static_cast<GeoNetMessageType>(start.ReadU8());
 
-  const uint64_t posX = start.ReadNtohU64();
-  const uint64_t posY = start.ReadNtohU64();
+  if (m_compact) {
+    m_sourcePositionX = static_cast<int32_t>(start.ReadNtohU32()) / kPositionScale;
+    m_sourcePositionY = static_cast<int32_t>(start.ReadNtohU32()) / kPositionScale;
+  } else {
+    const uint64_t posX = start.ReadNtohU64();
+    const uint64_t posY = start.ReadNtohU64();
 
-  std::memcpy(&m_sourcePositionX, &posX, sizeof(double));
-  std::memcpy(&m_sourcePositionY, &posY, sizeof(double));
+    std::memcpy(&m_sourcePositionX, &posX, sizeof(double));
+    std::memcpy(&m_sourcePositionY, &posY, sizeof(double));
+  }
 
   m_sourceId = start.ReadNtohU32();
   m_radius = start.ReadNtohU16();
@@ -117,13 +162,21 @@ void GeoNetHeader::SetLifetime(const uint16_t seconds) { m_lifetime = seconds; }
 
 uint16_t GeoNetHeader::GetLifetime() const { return m_lifetime; }
 
+bool CamHeader::s_compact = false;
+
+void CamHeader::SetCompactEncoding(const bool compact) { s_compact = compact; }
+
 CamHeader::CamHeader()
-    : m_vehicleId(0),
+    : m_compact(s_compact),
+      m_vehicleId(0),
       m_positionX(0.0),
       m_positionY(0.0),
       m_speed(0.0),
       m_heading(0.0),
-      m_timestamp(0) {}
+      m_timestamp(0),
+      m_pktId(-1),
+      m_fragmentIndex(0),
+      m_fragmentCount(1) {}
 
 CamHeader::~CamHeader() {}
 
@@ -136,13 +189,39 @@ TypeId CamHeader::GetTypeId() {
 TypeId CamHeader::GetInstanceTypeId() const { return GetTypeId(); }
 
 uint32_t CamHeader::GetSerializedSize() const {
+  if (m_compact) {
+    // id + posX + posY (i32) + speed + heading + generation delta time (u16)
+    // + pkt id (i32) + fragment index + fragment count (u16)
+    return 4 + 4 + 4 + 2 + 2 + 2 + 4 + 2 + 2;
+  }
   return sizeof(m_vehicleId) + sizeof(m_positionX) + sizeof(m_positionY) +
-         sizeof(m_speed) + sizeof(m_heading) + sizeof(m_timestamp);
+         sizeof(m_speed) + sizeof(m_heading) + sizeof(m_timestamp) + sizeof(m_pktId) +
+         sizeof(m_fragmentIndex) + sizeof(m_fragmentCount);
 }
 
 void CamHeader::Serialize(Buffer::Iterator start) const {
   start.WriteHtonU32(m_vehicleId);
 
+  if (m_compact) {
+    double heading = std::fmod(m_heading, 360.0);
+    if (heading < 0.0) {
+      heading += 360.0;
+    }
+    uint16_t headingFixed = ToFixed<uint16_t>(heading, kHeadingScale);
+    if (headingFixed >= 3600) {
+      headingFixed = 0;  // 359.95 and up round to 360
+    }
+    start.WriteHtonU32(static_cast<uint32_t>(ToFixed<int32_t>(m_positionX, kPositionScale)));
+    start.WriteHtonU32(static_cast<uint32_t>(ToFixed<int32_t>(m_positionY, kPositionScale)));
+    start.WriteHtonU16(ToFixed<uint16_t>(m_speed, kSpeedScale));
+    start.WriteHtonU16(headingFixed);
+    start.WriteHtonU16(static_cast<uint16_t>(m_timestamp & 0xFFFF));
+    start.WriteHtonU32(static_cast<uint32_t>(m_pktId));
+    start.WriteHtonU16(m_fragmentIndex);
+    start.WriteHtonU16(m_fragmentCount);
+    return;
+  }
+
   uint64_t posX;
   uint64_t posY;
   uint64_t speed;
@@ -159,11 +238,26 @@ void CamHeader::Serialize(Buffer::Iterator start) const {
   start.WriteHtonU64(heading);
 
   start.WriteHtonU64(m_timestamp);
+  start.WriteHtonU32(static_cast<uint32_t>(m_pktId));
+  start.WriteHtonU16(m_fragmentIndex);
+  start.WriteHtonU16(m_fragmentCount);
 }
 
 uint32_t CamHeader::Deserialize(Buffer::Iterator start) {
   m_vehicleId = start.ReadNtohU32();
 
+  if (m_compact) {
+    m_positionX = static_cast<int32_t>(start.ReadNtohU32()) / kPositionScale;
+    m_positionY = static_cast<int32_t>(start.ReadNtohU32()) / kPositionScale;
+    m_speed = start.ReadNtohU16() / kSpeedScale;
+    m_heading = start.ReadNtohU16() / kHeadingScale;
+    m_timestamp = ExpandDeltaTime(start.ReadNtohU16(), Simulator::Now().GetMilliSeconds());
+    m_pktId = static_cast<int32_t>(start.ReadNtohU32());
+    m_fragmentIndex = start.ReadNtohU16();
+    m_fragmentCount = start.ReadNtohU16();
+    return GetSerializedSize();
+  }
+
   const uint64_t posX = start.ReadNtohU64();
   const uint64_t posY = start.ReadNtohU64();
   const uint64_t speed = start.ReadNtohU64();
@@ -175,6 +269,9 @@ uint32_t CamHeader::Deserialize(Buffer::Iterator start) {
   std::memcpy(&m_heading, &heading, sizeof(double));
 
   m_timestamp = start.ReadNtohU64();
+  m_pktId = static_cast<int32_t>(start.ReadNtohU32());
+  m_fragmentIndex = start.ReadNtohU16();
+  m_fragmentCount = start.ReadNtohU16();
 
   return GetSerializedSize();
 }
@@ -182,7 +279,8 @@ uint32_t CamHeader::Deserialize(Buffer::Iterator start) {
 void CamHeader::Print(std::ostream &os) const {
   os << "Vehicle ID: " << m_vehicleId << " Position: (" << m_positionX << ","
      << m_positionY << ")" << " Speed: " << m_speed << " Heading: " << m_heading
-     << " Timestamp: " << m_timestamp;
+     << " Timestamp: " << m_timestamp << " PktId: " << m_pktId << " Fragment: "
+     << m_fragmentIndex + 1 << "/" << m_fragmentCount;
 }
 
 void CamHeader::SetVehicleId(const uint32_t id) { m_vehicleId = id; }
@@ -209,4 +307,17 @@ void CamHeader::SetTimestamp(const uint64_t timestamp) { m_timestamp = timestamp
 
 uint64_t CamHeader::GetTimestamp() const { return m_timestamp; }
 
-} // namespace ns3
\ No newline at end of file
+void CamHeader::SetPktId(const int32_t pktId) { m_pktId = pktId; }
+
+int32_t CamHeader::GetPktId() const { return m_pktId; }
+
+void CamHeader::SetFragment(const uint16_t index, const uint16_t count) {
+  m_fragmentIndex = index;
+  m_fragmentCount = count;
+}
+
+uint16_t CamHeader::GetFragmentIndex() const { return m_fragmentIndex; }
+
+uint16_t CamHeader::GetFragmentCount() const { return m_fragmentCount; }
+
+} // namespace ns3
@@ -50,7 +50,13 @@ class GeoNetHeader final : public Header {
   void SetLifetime(uint16_t seconds);
   uint16_t GetLifetime() const;
 
+  // Source position as 0.1 m fixed point instead of doubles (19 instead of 27 bytes).
+  // Applies to headers constructed afterwards; sender and receiver must agree.
+  static void SetCompactEncoding(bool compact);
+
  private:
+  static bool s_compact;
+  bool m_compact;
   uint8_t m_version;
   uint8_t m_nextHeader;
   GeoNetMessageType m_messageType;
@@ -91,13 +97,34 @@ class CamHeader final : public Header {
   void SetTimestamp(uint64_t timestamp);
   uint64_t GetTimestamp() const;
 
+  // CARLA packet id of the transfer this CAM belongs to, -1 for autonomous CAMs.
+  void SetPktId(int32_t pktId);
+  int32_t GetPktId() const;
+
+  // Position of this CAM within a transfer split over several packets.
+  void SetFragment(uint16_t index, uint16_t count);
+  uint16_t GetFragmentIndex() const;
+  uint16_t GetFragmentCount() const;
+
+  // ETSI-like fixed point instead of doubles (26 instead of 52 bytes): position in
+  // 0.1 m, speed in 0.01 m/s, heading in 0.1 deg within [0, 360), and the timestamp
+  // as a 16-bit generation delta time (ms modulo 65536) that the receiver expands
+  // against its own clock. Applies to headers constructed afterwards; sender and
+  // receiver must agree.
+  static void SetCompactEncoding(bool compact);
+
  private:
+  static bool s_compact;
+  bool m_compact;
   uint32_t m_vehicleId;
   double m_positionX;
   double m_positionY;
   double m_speed;
   double m_heading;
   uint64_t m_timestamp;
+  int32_t m_pktId;
+  uint16_t m_fragmentIndex;
+  uint16_t m_fragmentCount;
 };
 
 }
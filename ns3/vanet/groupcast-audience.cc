@@ -0,0 +1,47 @@
+#include "groupcast-audience.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+void GroupcastAudience::Add(uint32_t senderId, uint64_t sendTimeMs,
+                            const std::vector<int>& targets, double radius) {
+  Expire(sendTimeMs);
+
+  auto [it, inserted] = m_entries.try_emplace(Key(senderId, sendTimeMs));
+  Entry& e = it->second;
+  if (inserted) {
+    m_order.emplace_back(sendTimeMs, it->first);
+  }
+  if (targets.empty() && radius <= 0.0) {
+    e.everyone = true;
+  }
+  e.radius = std::max(e.radius, radius);
+  if (!targets.empty()) {
+    e.targets.insert(e.targets.end(), targets.begin(), targets.end());
+    std::sort(e.targets.begin(), e.targets.end());
+    e.targets.erase(std::unique(e.targets.begin(), e.targets.end()), e.targets.end());
+  }
+}
+
+bool GroupcastAudience::Accepts(uint32_t senderId, uint64_t sendTimeMs,
+                                uint32_t receiverId, double distance) const {
+  auto it = m_entries.find(Key(senderId, sendTimeMs));
+  if (it == m_entries.end()) {
+    return true;
+  }
+  const Entry& e = it->second;
+  if (e.everyone || (e.radius > 0.0 && distance <= e.radius)) {
+    return true;
+  }
+  return std::binary_search(e.targets.begin(), e.targets.end(), static_cast<int>(receiverId));
+}
+
+void GroupcastAudience::Expire(uint64_t nowMs) {
+  while (!m_order.empty() && m_order.front().first + m_lifetimeMs < nowMs) {
+    m_entries.erase(m_order.front().second);
+    m_order.pop_front();
+  }
+}
+
+} // namespace ns3
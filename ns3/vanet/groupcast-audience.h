@@ -0,0 +1,63 @@
+#ifndef GROUPCAST_AUDIENCE_H
+#define GROUPCAST_AUDIENCE_H
+
+#include "carla-messages.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Who a groupcast CAM is meant for.
+ *
+ * A groupcast transfer goes out once on the sidelink group and every UE in range
+ * decodes it, but CARLA only wants cam_received for its audience: an explicit list
+ * of targets, everyone within a radius of the sender, or both. The sender records
+ * the audience under (sender id, send timestamp ms), which is exactly what the
+ * receiver finds in the CamHeader, and the receivers ask Accepts() before reporting.
+ * Vehicle ids are CARLA ids: VehicleRegistry::Bind() hands a slot's CARLA id to its
+ * applications, which stamp it into their CAMs and check it against the targets.
+ *
+ * Transfers from one sender stamped in the same millisecond share an entry (union of
+ * targets, largest radius). Entries expire after a fixed lifetime, oldest first.
+ * Simulator thread only.
+ */
+class GroupcastAudience {
+public:
+  // targets empty and radius <= 0: every receiver of the group.
+  void Add(uint32_t senderId, uint64_t sendTimeMs, const std::vector<int>& targets, double radius);
+  // The audience of a groupcast transfer request, keyed by its CARLA ids.
+  void Add(const TransferRequest& req, uint64_t sendTimeMs) {
+    Add(static_cast<uint32_t>(req.source), sendTimeMs, req.targets, req.radius);
+  }
+
+  // Unknown transfers are accepted: the filter only ever narrows a groupcast.
+  bool Accepts(uint32_t senderId, uint64_t sendTimeMs, uint32_t receiverId, double distance) const;
+
+  void SetLifetimeMs(uint64_t lifetimeMs) { m_lifetimeMs = lifetimeMs; }
+  size_t GetN() const { return m_entries.size(); }
+
+private:
+  struct Entry {
+    std::vector<int> targets;  // sorted
+    double radius{0.0};
+    bool everyone{false};
+  };
+
+  static uint64_t Key(uint32_t senderId, uint64_t sendTimeMs) {
+    return (static_cast<uint64_t>(senderId) << 40) | (sendTimeMs & ((uint64_t{1} << 40) - 1));
+  }
+  void Expire(uint64_t nowMs);
+
+  uint64_t m_lifetimeMs{2000};
+  std::unordered_map<uint64_t, Entry> m_entries;
+  std::deque<std::pair<uint64_t, uint64_t>> m_order;  // (send time ms, key), oldest first
+};
+
+} // namespace ns3
+
+#endif
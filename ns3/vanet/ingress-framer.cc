@@ -0,0 +1,148 @@
+#include "ingress-framer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace ns3 {
+
+IngressFramer::IngressFramer(size_t initialCapacity)
+    : m_buffer(new char[initialCapacity]),
+      m_capacity(initialCapacity),
+      m_readPos(0),
+      m_writePos(0),
+      m_scanPos(0) {}
+
+char* IngressFramer::PrepareWrite(size_t minSpace) {
+  if (m_capacity - m_writePos < minSpace) {
+    Reserve(minSpace);
+  }
+  return m_buffer.get() + m_writePos;
+}
+
+size_t IngressFramer::WritableSize() const { return m_capacity - m_writePos; }
+
+void IngressFramer::Commit(size_t bytes) {
+  m_writePos += std::min(bytes, m_capacity - m_writePos);
+  if (m_writePos - m_readPos > kMaxFrameSize) {
+    std::cerr << "[ERR] IngressFramer: " << (m_writePos - m_readPos)
+              << " bytes buffered without a frame delimiter, dropping them\n";
+    Clear();
+  }
+}
+
+void IngressFramer::UseDelimitedFrames() {
+  m_headerSize = 0;
+  m_lengthOffset = 0;
+  m_scanPos = m_readPos;
+}
+
+void IngressFramer::UseLengthPrefixedFrames(size_t headerSize, size_t lengthOffset) {
+  m_headerSize = headerSize;
+  m_lengthOffset = lengthOffset;
+  m_scanPos = m_readPos;
+}
+
+bool IngressFramer::IsLengthPrefixed() const { return m_headerSize > 0; }
+
+bool IngressFramer::NextFrame(std::string_view& frame) {
+  if (m_headerSize > 0) {
+    return NextLengthPrefixedFrame(frame);
+  }
+  return NextDelimitedFrame(frame);
+}
+
+bool IngressFramer::NextLengthPrefixedFrame(std::string_view& frame) {
+  const size_t pending = m_writePos - m_readPos;
+  if (pending < m_headerSize) {
+    return false;
+  }
+  const unsigned char* len =
+      reinterpret_cast<const unsigned char*>(m_buffer.get() + m_readPos + m_lengthOffset);
+  const size_t payload = static_cast<size_t>(len[0]) | (static_cast<size_t>(len[1]) << 8) |
+                         (static_cast<size_t>(len[2]) << 16) | (static_cast<size_t>(len[3]) << 24);
+  if (payload > kMaxFrameSize) {
+    std::cerr << "[ERR] IngressFramer: length-prefixed frame of " << payload
+              << " bytes exceeds the frame limit, dropping buffered data\n";
+    Clear();
+    return false;
+  }
+  if (pending < m_headerSize + payload) {
+    return false;
+  }
+
+  frame = std::string_view(m_buffer.get() + m_readPos, m_headerSize + payload);
+  m_readPos += m_headerSize + payload;
+  m_scanPos = m_readPos;
+  if (m_readPos == m_writePos) {
+    Clear();
+  }
+  return true;
+}
+
+bool IngressFramer::NextDelimitedFrame(std::string_view& frame) {
+  const char* base = m_buffer.get();
+  while (m_scanPos < m_writePos) {
+    const void* hit = std::memchr(base + m_scanPos, '\n', m_writePos - m_scanPos);
+    if (hit == nullptr) {
+      m_scanPos = m_writePos;
+      return false;
+    }
+    const size_t nl = static_cast<const char*>(hit) - base;
+    if (nl + 1 >= m_writePos) {
+      // '\n' is the last received byte; wait for the next read to see if '\r' follows.
+      m_scanPos = nl;
+      return false;
+    }
+    if (base[nl + 1] != '\r') {
+      m_scanPos = nl + 1;
+      continue;
+    }
+
+    frame = std::string_view(base + m_readPos, nl - m_readPos);
+    m_readPos = nl + 2;
+    m_scanPos = m_readPos;
+    if (m_readPos == m_writePos) {
+      // Fully drained: rewind so the next read starts at the front without a memmove.
+      Clear();
+    }
+    return true;
+  }
+  return false;
+}
+
+size_t IngressFramer::BufferedSize() const { return m_writePos - m_readPos; }
+
+size_t IngressFramer::Capacity() const { return m_capacity; }
+
+void IngressFramer::Clear() {
+  m_readPos = 0;
+  m_writePos = 0;
+  m_scanPos = 0;
+}
+
+void IngressFramer::Reserve(size_t minSpace) {
+  const size_t pending = m_writePos - m_readPos;
+  if (pending + minSpace <= m_capacity) {
+    // Only the unconsumed tail (at most one partial frame) is moved to the front.
+    if (pending > 0) {
+      std::memmove(m_buffer.get(), m_buffer.get() + m_readPos, pending);
+    }
+  } else {
+    size_t capacity = m_capacity;
+    while (capacity < pending + minSpace) {
+      capacity *= 2;
+    }
+    std::unique_ptr<char[]> grown(new char[capacity]);
+    if (pending > 0) {
+      std::memcpy(grown.get(), m_buffer.get() + m_readPos, pending);
+    }
+    m_buffer = std::move(grown);
+    m_capacity = capacity;
+  }
+  m_scanPos -= m_readPos;
+  m_readPos = 0;
+  m_writePos = pending;
+}
+
+} // namespace ns3
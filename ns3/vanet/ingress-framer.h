@@ -0,0 +1,58 @@
+#ifndef INGRESS_FRAMER_H
+#define INGRESS_FRAMER_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace ns3 {
+
+// Reassembles frames from the CARLA ingress stream (port 5556), either "\n\r"-delimited
+// (JSON) or length-prefixed (binary wire format). Bytes are received straight into the
+// framer's buffer, partial frames survive across reads, and complete frames are handed
+// out as views into that buffer.
+class IngressFramer {
+public:
+  explicit IngressFramer(size_t initialCapacity = 64 * 1024);
+
+  // Returns a writable region of at least minSpace contiguous bytes; recv() into it
+  // and then call Commit() with the number of bytes actually written.
+  // Invalidates every frame view returned so far.
+  char* PrepareWrite(size_t minSpace);
+  size_t WritableSize() const;
+  void Commit(size_t bytes);
+
+  // Switches framing for the bytes that follow the last extracted frame. Length-prefixed
+  // frames start with a headerSize-byte header holding a little-endian u32 payload
+  // length at lengthOffset; the returned frame includes that header.
+  void UseDelimitedFrames();
+  void UseLengthPrefixedFrames(size_t headerSize, size_t lengthOffset);
+  bool IsLengthPrefixed() const;
+
+  // Extracts the next complete frame (without delimiter). The view stays valid
+  // until the next PrepareWrite() or Clear().
+  bool NextFrame(std::string_view& frame);
+
+  size_t BufferedSize() const;
+  size_t Capacity() const;
+  void Clear();
+
+  static constexpr size_t kMaxFrameSize = 256 * 1024 * 1024;
+
+private:
+  void Reserve(size_t minSpace);
+  bool NextDelimitedFrame(std::string_view& frame);
+  bool NextLengthPrefixedFrame(std::string_view& frame);
+
+  std::unique_ptr<char[]> m_buffer;
+  size_t m_capacity;
+  size_t m_readPos;   // start of the first unconsumed byte
+  size_t m_writePos;  // end of received data
+  size_t m_scanPos;   // bytes before this offset are known not to start a delimiter
+  size_t m_headerSize{0};  // 0 selects delimited framing
+  size_t m_lengthOffset{0};
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,326 @@
+#include "link-kpi.h"
+
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace ns3 {
+
+namespace {
+void AppendNumber(std::string& out, double value, int decimals) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+  out += buf;
+}
+
+// {"mean":..,"p50":..,"p90":..,"p99":..,"max":..} in ms
+void AppendLatency(std::string& out, const LatencyHistogram& h) {
+  out += R"({"mean":)";
+  AppendNumber(out, h.GetMean() / 1000.0, 3);
+  out += R"(,"p50":)";
+  AppendNumber(out, h.GetQuantile(0.5) / 1000.0, 3);
+  out += R"(,"p90":)";
+  AppendNumber(out, h.GetQuantile(0.9) / 1000.0, 3);
+  out += R"(,"p99":)";
+  AppendNumber(out, h.GetQuantile(0.99) / 1000.0, 3);
+  out += R"(,"max":)";
+  AppendNumber(out, h.GetMax() / 1000.0, 3);
+  out += '}';
+}
+
+double Ratio(uint64_t num, uint64_t den) {
+  return den ? static_cast<double>(num) / den : 0.0;
+}
+} // namespace
+
+// ==================== LatencyHistogram ====================
+uint32_t LatencyHistogram::Index(uint64_t us) {
+  if (us < kLinear) {
+    return static_cast<uint32_t>(us);
+  }
+  uint32_t msb = kSubBits + 1;
+  while (us >> (msb + 1)) {
+    ++msb;
+  }
+  const uint32_t shift = msb - kSubBits;  // >= 1
+  const uint64_t sub = (us >> shift) - (1u << kSubBits);  // [0, 32)
+  return std::min<uint64_t>(kLinear + (shift - 1) * (1u << kSubBits) + sub, kBuckets - 1);
+}
+
+double LatencyHistogram::Midpoint(uint32_t index) {
+  if (index < kLinear) {
+    return index;
+  }
+  const uint32_t shift = (index - kLinear) / (1u << kSubBits) + 1;
+  const uint64_t sub = (index - kLinear) % (1u << kSubBits) + (1u << kSubBits);
+  return static_cast<double>(sub << shift) + ((uint64_t{1} << shift) - 1) / 2.0;
+}
+
+void LatencyHistogram::Add(uint64_t us) {
+  ++m_buckets[Index(us)];
+  ++m_count;
+  m_sum += us;
+  m_max = std::max(m_max, us);
+}
+
+double LatencyHistogram::GetQuantile(double q) const {
+  if (m_count == 0) {
+    return 0.0;
+  }
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * m_count)));
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < kBuckets; ++i) {
+    seen += m_buckets[i];
+    if (seen >= rank) {
+      return std::min(Midpoint(i), static_cast<double>(m_max));
+    }
+  }
+  return static_cast<double>(m_max);
+}
+
+// ==================== SlidingWindowSum ====================
+SlidingWindowSum::SlidingWindowSum(Time window) : m_window(window), m_slot(window / kSlots) {}
+
+void SlidingWindowSum::Advance(Time now) {
+  const int64_t slot = now.GetTimeStep() / m_slot.GetTimeStep();
+  if (slot - m_current >= static_cast<int64_t>(kSlots)) {
+    m_sums.fill(0);
+    m_total = 0;
+    m_current = slot;
+    return;
+  }
+  while (m_current < slot) {
+    uint64_t& expired = m_sums[++m_current % kSlots];
+    m_total -= expired;
+    expired = 0;
+  }
+}
+
+void SlidingWindowSum::Add(Time now, uint64_t value) {
+  Advance(now);
+  m_sums[m_current % kSlots] += value;
+  m_total += value;
+}
+
+double SlidingWindowSum::GetRate(Time now) {
+  Advance(now);
+  // The current slot is only partly over.
+  const Time covered = std::min(now, now - m_slot * m_current + m_slot * (kSlots - 1));
+  return covered.IsStrictlyPositive() ? m_total / covered.GetSeconds() : 0.0;
+}
+
+// ==================== LinkKpi ====================
+LinkKpi::LinkKpi(double binWidth, double maxDistance, Time window)
+    : m_binWidth(binWidth),
+      m_maxDistance(maxDistance),
+      m_bins(static_cast<size_t>(std::max(1.0, std::ceil(maxDistance / binWidth)))),
+      m_offered(window),
+      m_goodput(window) {}
+
+void LinkKpi::AddVehicle(uint32_t vehicleId, Ipv4Address ip, Ptr<MobilityModel> mobility) {
+  const auto [byIp, added] = m_vehicleByIp.try_emplace(ip.Get(), static_cast<uint32_t>(m_vehicles.size()));
+  const uint32_t index = byIp->second;
+  if (added) {
+    m_vehicles.emplace_back();
+  }
+  Vehicle& vehicle = m_vehicles[index];
+  if (vehicle.id != vehicleId && vehicle.id != kNoVehicle) {
+    m_vehicleById.erase(vehicle.id);
+  }
+  const auto [byId, fresh] = m_vehicleById.try_emplace(vehicleId, index);
+  if (!fresh && byId->second != index) {
+    // The id moved to another vehicle; the one it leaves is not counted any more.
+    m_vehicles[byId->second].id = kNoVehicle;
+    m_vehicles[byId->second].listening = false;
+    byId->second = index;
+  }
+  vehicle.id = vehicleId;
+  vehicle.mobility = mobility;
+}
+
+void LinkKpi::SetListening(uint32_t vehicleId, bool listening) {
+  const uint32_t index = Find(vehicleId);
+  if (index != kNoVehicle) {
+    m_vehicles[index].listening = listening;
+  }
+}
+
+void LinkKpi::SetAudienceFilter(std::function<bool(uint32_t, uint64_t, uint32_t, double)> filter) {
+  m_audience = filter;
+}
+
+uint32_t LinkKpi::Find(uint32_t vehicleId) const {
+  auto it = m_vehicleById.find(vehicleId);
+  return it == m_vehicleById.end() ? kNoVehicle : it->second;
+}
+
+double LinkKpi::GetDistance(uint32_t a, uint32_t b) const {
+  if (a == kNoVehicle || b == kNoVehicle || !m_vehicles[a].mobility || !m_vehicles[b].mobility) {
+    return -1.0;
+  }
+  return m_vehicles[a].mobility->GetDistanceFrom(m_vehicles[b].mobility);
+}
+
+LinkKpi::LinkStats& LinkKpi::GetLink(uint32_t senderId, uint32_t receiverId) {
+  const uint64_t key = LinkKey(senderId, receiverId);
+  LinkStats& link = m_links[key];
+  if (!link.dirty) {
+    link.dirty = true;
+    m_dirtyLinks.push_back(key);
+  }
+  return link;
+}
+
+void LinkKpi::Expect(uint32_t senderId, uint32_t receiverId, uint64_t sendTimeMs, double distance) {
+  const uint32_t bin = static_cast<uint32_t>(distance / m_binWidth);
+  ++m_expected;
+  LinkStats& link = GetLink(senderId, receiverId);
+  ++link.expected;
+  ++m_bins[bin].expected;
+  DropLost(link.pending, sendTimeMs);
+  link.pending.push_back({sendTimeMs, bin});
+}
+
+void LinkKpi::DropLost(std::vector<PendingTransfer>& pending, uint64_t nowMs) {
+  const auto live = std::find_if(pending.begin(), pending.end(), [nowMs](const PendingTransfer& p) {
+    return p.sendTimeMs + kDeliveryHorizonMs >= nowMs;
+  });
+  pending.erase(pending.begin(), live);
+}
+
+int64_t LinkKpi::TakePending(LinkStats& link, uint64_t sendTimeMs, uint64_t nowMs) {
+  std::vector<PendingTransfer>& pending = link.pending;
+  DropLost(pending, nowMs);
+  const auto it = std::find_if(pending.begin(), pending.end(),
+                               [sendTimeMs](const PendingTransfer& p) { return p.sendTimeMs == sendTimeMs; });
+  if (it == pending.end()) {
+    return -1;
+  }
+  const uint32_t bin = it->bin;
+  pending.erase(it);
+  return bin;
+}
+
+void LinkKpi::OnTransmit(uint32_t senderId, uint64_t sendTimeMs, Ipv4Address dest, uint32_t bytes) {
+  ++m_transfers;
+  m_offered.Add(Simulator::Now(), bytes);
+
+  const auto inRange = [this](double distance) { return distance >= 0.0 && distance < m_maxDistance; };
+  const uint32_t sender = Find(senderId);
+  if (dest.IsBroadcast() || dest.IsMulticast()) {
+    // O(vehicles) per transfer; the fleet is small next to what PHY does per packet.
+    for (uint32_t index = 0; index < m_vehicles.size(); ++index) {
+      const Vehicle& receiver = m_vehicles[index];
+      if (index == sender || !receiver.listening) {
+        continue;
+      }
+      const double distance = GetDistance(sender, index);
+      if (!inRange(distance) ||
+          (dest.IsMulticast() && m_audience && !m_audience(senderId, sendTimeMs, receiver.id, distance))) {
+        continue;
+      }
+      Expect(senderId, receiver.id, sendTimeMs, distance);
+    }
+    return;
+  }
+  auto it = m_vehicleByIp.find(dest.Get());
+  if (it == m_vehicleByIp.end() || !m_vehicles[it->second].listening) {
+    return;
+  }
+  const double distance = GetDistance(sender, it->second);
+  if (inRange(distance)) {
+    Expect(senderId, m_vehicles[it->second].id, sendTimeMs, distance);
+  }
+}
+
+void LinkKpi::OnDelivered(uint32_t senderId, uint32_t receiverId, uint64_t sendTimeMs, Time firstLatency,
+                          Time lastLatency, uint32_t bytes, bool complete) {
+  auto found = m_links.find(LinkKey(senderId, receiverId));
+  const int64_t bin = found == m_links.end()
+                          ? -1
+                          : TakePending(found->second, sendTimeMs, Simulator::Now().GetMilliSeconds());
+  if (bin < 0) {
+    ++m_unmatched;
+    return;
+  }
+  if (!complete) {
+    ++m_incomplete;
+    return;
+  }
+  const uint64_t latencyUs = static_cast<uint64_t>(std::max<int64_t>(lastLatency.GetMicroSeconds(), 0));
+  ++m_delivered;
+  LinkStats& link = GetLink(senderId, receiverId);
+  ++link.delivered;
+  link.latencySumUs += latencyUs;
+  m_latency.Add(latencyUs);
+  m_firstLatency.Add(static_cast<uint64_t>(std::max<int64_t>(firstLatency.GetMicroSeconds(), 0)));
+  m_goodput.Add(Simulator::Now(), bytes);
+  BinStats& binStats = m_bins[bin];
+  ++binStats.delivered;
+  binStats.latency.Add(latencyUs);
+}
+
+std::string LinkKpi::GetSummary() {
+  const Time now = Simulator::Now();
+  std::string out;
+  out.reserve(512 + m_bins.size() * 48 + m_dirtyLinks.size() * 40);
+  out += R"({"type":"link_kpi","ns3_time":)";
+  AppendNumber(out, now.GetSeconds(), 3);
+  out += R"(,"transfers":)" + std::to_string(m_transfers);
+  out += R"(,"expected":)" + std::to_string(m_expected);
+  out += R"(,"delivered":)" + std::to_string(m_delivered);
+  out += R"(,"incomplete":)" + std::to_string(m_incomplete);
+  out += R"(,"unmatched":)" + std::to_string(m_unmatched);
+  out += R"(,"pdr":)";
+  AppendNumber(out, Ratio(m_delivered, m_expected), 4);
+  out += R"(,"latency_ms":)";
+  AppendLatency(out, m_latency);
+  out += R"(,"first_byte_latency_ms":)";
+  AppendLatency(out, m_firstLatency);
+  out += R"(,"window_s":)";
+  AppendNumber(out, m_offered.GetWindow().GetSeconds(), 3);
+  out += R"(,"offered_bps":)";
+  AppendNumber(out, m_offered.GetRate(now) * 8.0, 0);
+  out += R"(,"delivered_bps":)";
+  AppendNumber(out, m_goodput.GetRate(now) * 8.0, 0);
+
+  // Per distance bin [i * width, (i + 1) * width)
+  out += R"(,"bin_width_m":)";
+  AppendNumber(out, m_binWidth, 1);
+  const auto appendBins = [&](const char* name, auto value) {
+    out += name;
+    for (size_t i = 0; i < m_bins.size(); ++i) {
+      out += i ? "," : "[";
+      value(m_bins[i]);
+    }
+    out += ']';
+  };
+  appendBins(R"(,"bin_expected":)", [&](const BinStats& b) { out += std::to_string(b.expected); });
+  appendBins(R"(,"bin_prr":)", [&](const BinStats& b) { AppendNumber(out, Ratio(b.delivered, b.expected), 4); });
+  appendBins(R"(,"bin_latency_p50_ms":)",
+             [&](const BinStats& b) { AppendNumber(out, b.latency.GetQuantile(0.5) / 1000.0, 3); });
+  appendBins(R"(,"bin_latency_p99_ms":)",
+             [&](const BinStats& b) { AppendNumber(out, b.latency.GetQuantile(0.99) / 1000.0, 3); });
+
+  // [sender, receiver, expected, delivered, mean latency ms] of the links that changed
+  out += R"(,"links":[)";
+  for (size_t i = 0; i < m_dirtyLinks.size(); ++i) {
+    const uint64_t key = m_dirtyLinks[i];
+    LinkStats& link = m_links[key];
+    link.dirty = false;
+    if (i) {
+      out += ',';
+    }
+    out += '[' + std::to_string(key >> 32) + ',' + std::to_string(key & 0xFFFFFFFF) + ',' +
+           std::to_string(link.expected) + ',' + std::to_string(link.delivered) + ',';
+    AppendNumber(out, link.delivered ? link.latencySumUs / 1000.0 / link.delivered : 0.0, 3);
+    out += ']';
+  }
+  m_dirtyLinks.clear();
+  out += "]}";
+  return out;
+}
+
+} // namespace ns3
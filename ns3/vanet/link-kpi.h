@@ -0,0 +1,183 @@
+#ifndef LINK_KPI_H
+#define LINK_KPI_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/mobility-model.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Latency histogram in constant memory, HDR style: values (us) below 64 have their own
+ * bucket, above that every power of two is split into 32 buckets, so a percentile is
+ * off by at most ~3% of its value. Covers up to 2^42 us.
+ */
+class LatencyHistogram {
+public:
+  void Add(uint64_t us);
+  // Value at quantile q in [0, 1], in us; 0 while empty.
+  double GetQuantile(double q) const;
+  double GetMean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+  uint64_t GetMax() const { return m_max; }
+  uint64_t GetCount() const { return m_count; }
+
+private:
+  static constexpr uint32_t kSubBits = 5;
+  static constexpr uint32_t kLinear = 2u << kSubBits;  // 64
+  static constexpr uint32_t kBuckets = kLinear + 36 * (1u << kSubBits);
+
+  static uint32_t Index(uint64_t us);
+  static double Midpoint(uint32_t index);
+
+  std::array<uint64_t, kBuckets> m_buckets{};
+  uint64_t m_count{0};
+  uint64_t m_sum{0};
+  uint64_t m_max{0};
+};
+
+/*
+ * Sum over a sliding window, kept as a ring of kSlots sub-windows: Add() and GetRate()
+ * cost O(1) amortized and the window moves in steps of window / kSlots.
+ */
+class SlidingWindowSum {
+public:
+  explicit SlidingWindowSum(Time window = Seconds(1));
+  void Add(Time now, uint64_t value);
+  // Per second, over the last window (or since the start, if that is shorter).
+  double GetRate(Time now);
+  Time GetWindow() const { return m_window; }
+
+private:
+  static constexpr uint32_t kSlots = 10;
+
+  void Advance(Time now);
+
+  Time m_window;
+  Time m_slot;
+  int64_t m_current{0};  // index of the slot `now` falls into
+  std::array<uint64_t, kSlots> m_sums{};
+  uint64_t m_total{0};
+};
+
+/*
+ * Link KPIs computed inside ns-3, so that a measurement campaign does not have to
+ * stream every cam_received to CARLA and post-process them in Python.
+ *
+ * Every vehicle registers with its IP and mobility model under the id its CAMs carry.
+ * Registering an IP again under another id renames the vehicle, as when its slot is
+ * bound to a CARLA id: its listening state is kept, and links already counted stay
+ * under the old id. A sender reports each transfer with its destination: a unicast
+ * address expects the vehicle behind it, a broadcast or multicast address every other
+ * listening vehicle (multicast further narrowed by the audience filter), if within
+ * maxDistance at that moment. A receiver reports each transfer it got; it only counts against an expectation of the same
+ * sender, receiver and send timestamp, at most kDeliveryHorizon old, in the distance
+ * bin of the transmission. So both counts come from the same decision: delivered
+ * never exceeds expected, and broadcasts heard far away do not inflate the ratios.
+ * From that:
+ *  - delivery ratio per (sender, receiver) link and per sender-receiver distance bin
+ *    (PRR vs distance),
+ *  - last-byte and first-byte latency histograms overall, last-byte per distance bin,
+ *  - offered and delivered throughput over a sliding window.
+ * Latencies are measured from the millisecond send timestamp of the CAM header.
+ *
+ * GetSummary() renders everything as one compact JSON object; links only appear in
+ * it when they changed since the previous summary. Counters are cumulative.
+ *
+ * Simulator thread only.
+ */
+class LinkKpi {
+public:
+  LinkKpi(double binWidth = 50.0, double maxDistance = 1000.0, Time window = Seconds(1));
+
+  // (Re)registers the vehicle at `ip` as vehicleId; an id registered at another IP
+  // before moves here, and the vehicle there stops being counted.
+  void AddVehicle(uint32_t vehicleId, Ipv4Address ip, Ptr<MobilityModel> mobility);
+  // Parked vehicles neither send nor receive and are not expected to.
+  void SetListening(uint32_t vehicleId, bool listening);
+  // Decides whether a multicast transfer (sender id, send timestamp ms, receiver id,
+  // distance in m) was meant for a receiver; unset means everyone in range.
+  void SetAudienceFilter(std::function<bool(uint32_t, uint64_t, uint32_t, double)> filter);
+
+  void OnTransmit(uint32_t senderId, uint64_t sendTimeMs, Ipv4Address dest, uint32_t bytes);
+  void OnDelivered(uint32_t senderId, uint32_t receiverId, uint64_t sendTimeMs, Time firstLatency,
+                   Time lastLatency, uint32_t bytes, bool complete);
+
+  std::string GetSummary();
+
+private:
+  static constexpr uint32_t kNoVehicle = std::numeric_limits<uint32_t>::max();
+  struct Vehicle {
+    uint32_t id{kNoVehicle};
+    Ptr<MobilityModel> mobility;
+    bool listening{false};
+  };
+  // Expected transfer not delivered yet
+  struct PendingTransfer {
+    uint64_t sendTimeMs;
+    uint32_t bin;
+  };
+  struct LinkStats {
+    uint64_t expected{0};
+    uint64_t delivered{0};
+    uint64_t latencySumUs{0};
+    std::vector<PendingTransfer> pending;  // oldest first
+    bool dirty{false};
+  };
+
+  // Deliveries of transfers sent longer ago than this are not counted.
+  static constexpr uint64_t kDeliveryHorizonMs = 5000;
+  struct BinStats {
+    uint64_t expected{0};
+    uint64_t delivered{0};
+    LatencyHistogram latency;
+  };
+
+  static uint64_t LinkKey(uint32_t senderId, uint32_t receiverId) {
+    return (static_cast<uint64_t>(senderId) << 32) | receiverId;
+  }
+  LinkStats& GetLink(uint32_t senderId, uint32_t receiverId);
+  // Index into m_vehicles of a registered id, or kNoVehicle.
+  uint32_t Find(uint32_t vehicleId) const;
+  // Distance between two vehicles (indices) now, < 0 if either has no mobility.
+  double GetDistance(uint32_t a, uint32_t b) const;
+  void Expect(uint32_t senderId, uint32_t receiverId, uint64_t sendTimeMs, double distance);
+  // Drops the pending transfers past the horizon, oldest first: they were lost.
+  static void DropLost(std::vector<PendingTransfer>& pending, uint64_t nowMs);
+  // Removes the pending transfer sent at sendTimeMs and returns its bin, or -1.
+  static int64_t TakePending(LinkStats& link, uint64_t sendTimeMs, uint64_t nowMs);
+
+  double m_binWidth;
+  double m_maxDistance;
+  std::vector<BinStats> m_bins;
+  std::vector<Vehicle> m_vehicles;  // one per IP, in registration order
+  std::unordered_map<uint32_t, uint32_t> m_vehicleByIp;  // IP -> index
+  std::unordered_map<uint32_t, uint32_t> m_vehicleById;  // vehicle id -> index
+  std::function<bool(uint32_t, uint64_t, uint32_t, double)> m_audience;
+
+  std::unordered_map<uint64_t, LinkStats> m_links;
+  std::vector<uint64_t> m_dirtyLinks;
+
+  uint64_t m_transfers{0};
+  uint64_t m_expected{0};
+  uint64_t m_delivered{0};
+  uint64_t m_incomplete{0};
+  uint64_t m_unmatched{0};  // deliveries without a pending expectation
+  LatencyHistogram m_latency;
+  LatencyHistogram m_firstLatency;
+  SlidingWindowSum m_offered;
+  SlidingWindowSum m_goodput;
+};
+
+} // namespace ns3
+
+#endif
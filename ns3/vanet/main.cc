@@ -3,6 +3,8 @@
 #include "ns3/network-module.h"
 #include "ns3/packet-socket-helper.h"
 #include "ns3/yans-wifi-helper.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
 #include "ns3/internet-module.h"
 #include "ns3/antenna-module.h"
 #include "ns3/applications-module.h"
@@ -19,17 +21,33 @@
 
 #include "cam-application.h"
 #include "carla_vanet.h"
-
-#include <arpa/inet.h>
-#include <netinet/in.h>
-#include <sys/socket.h>
-#include <unistd.h>
-
+#include "carla-bridge-io.h"
+#include "carla-json-decoder.h"
+#include "carla-mobility-model.h"
+#include "carla-shm-transport.h"
+#include "carla-wire-format.h"
+#include "geo-networking.h"
+#include "cam-timer-wheel.h"
+#include "groupcast-audience.h"
+#include "ingress-framer.h"
+#include "link-kpi.h"
+#include "mpsc-queue.h"
+#include "sl-bearer-cache.h"
+#include "triple-buffer.h"
+#include "vehicle-registry.h"
+
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <thread>
 #include <csignal>
+#include <cstring>
 #include <condition_variable>
 
 using namespace ns3;
@@ -40,31 +58,93 @@ NodeContainer vehicles;
 uint32_t nVehicles = 0;
 double simTime = 10.0;
 std::string carlaHost = "auto";
-double camInterval = 0.1;
+std::string transport = "tcp";  // "tcp" (ports 5556/5557) or "shm" (same-host shared memory)
+std::string shmName = "/carla_ns3";
+double camInterval = 0.1;  // s, T_GenCamMin of the autonomous CAMs
+// Autonomous ETSI CAM generation inside the senders, so that CARLA only has to send
+// positions; off by default, CAMs then only follow CARLA's transfer requests.
+bool autoCam = false;
+uint32_t camSize = 200;    // bytes
+double camJitter = 0.01;   // s, added to every check interval
+CamTimerWheel camWheel;    // drives the CAM checks of all vehicles
+// Fixed-point CAM/GeoNetworking headers (26 + 19 bytes) instead of doubles (52 + 27).
+bool compactHeaders = false;
+// Transfers above this many bytes go out as several CAMs, reported as one on reception.
+uint32_t transferFragmentSize = 65000;
+// Link KPIs aggregated in ns-3 and published as link_kpi summaries, so that measurement
+// campaigns can switch the per-transfer cam_received reports off.
+bool linkKpi = false;
+bool camReports = true;
+uint32_t kpiInterval = 1;    // sync ticks per summary, 0: on kpi_request only
+double kpiBinWidth = 50.0;   // m
+double kpiMaxDistance = 1000.0;  // m
+double kpiWindow = 1.0;      // s, throughput window
+std::unique_ptr<LinkKpi> kpi;
+uint32_t kpiTicks = 0;
 Time slBearersActivationTime = MilliSeconds(1);  // Start CAM sender almost immediately
 Time finalSlBearersActivationTime = slBearersActivationTime + MilliSeconds(10);
+Time slBearersReadyTime = finalSlBearersActivationTime;  // bearers of the latest InitializeVehicles
 
-std::vector<Ptr<CamSender>> senders;
-std::vector<Ptr<CamReceiver>> receivers;
-std::vector<Ipv4Address> vehicleIps;
-std::vector<uint32_t> vehicleL2Ids;
-
-std::map<int, int> indexToCarlaId;
-std::map<int, int> carlaIdToIndex;
+VehicleRegistry registry;  // CARLA id <-> node slot, per-vehicle state and handles
 std::atomic indexBindToCarlaId(false);
 
-std::map<int, Vector> latestPositions;
-std::map<int, Vector> latestVelocities;
-std::map<int, std::vector<int>> latestRequests;
-std::unordered_map<int, TransferRequestSubChannel> latestRequestsSubChannel;
-
-std::mutex msgMutex;
-std::mutex dataMutex;
+// NR sidelink stack shared by all UEs: helpers, operation band/channel and the
+// sidelink pre-configuration. Built once; a growing fleet only attaches new UEs to it.
+struct NrSlStack {
+    Ptr<NrPointToPointEpcHelper> epcHelper;  // null with slOnlyIp
+    Ipv4AddressHelper ueAddress;             // slOnlyIp: UE addresses, same plan as the EPC's
+    Ipv4Address ueGateway;
+    Ptr<NrHelper> nrHelper;
+    Ptr<NrSlHelper> nrSlHelper;
+    OperationBandInfo bandSl;
+    BandwidthPartInfoPtrVector allBwps;
+    std::set<uint8_t> bwpIdContainer;
+    LteRrcSap::SidelinkPreconfigNr slPreConfigNr;
+    NetDeviceContainer ueDevices;      // every UE, in slot order
+    Ipv4InterfaceContainer ueIpIface;  // every UE, in slot order
+    int64_t stream{1};
+};
+std::unique_ptr<NrSlStack> nrSlStack;  // NR mode only
+// NR only: unicast TX bearers per (source, target) pair are activated on the first
+// transfer request and released after slBearerIdleTimeout, instead of N*(N-1) at init.
+bool lazySlBearers = true;
+double slBearerIdleTimeout = 5.0;  // s
+SlBearerCache slBearers;
+// NR only: all traffic is PC5 sidelink, so by default no EPC (PGW/SGW/MME nodes and
+// their point-to-point links) is built; UEs get their addresses directly.
+bool slOnlyIp = true;
+// NR only: a groupcast transfer (targets and/or radius instead of one target) is sent
+// once to this sidelink group; every UE decodes it and groupAudience decides which
+// receivers report it to CARLA.
+const Ipv4Address slGroupAddress("225.0.0.1");
+constexpr uint16_t kSlGroupPort = 5001;
+constexpr uint32_t kSlGroupL2Id = 0xFFFF;
+GroupcastAudience groupAudience;
+
+// Inbound commands: pushed by the bridge thread, applied only on the simulator thread.
+MpscQueue<CarlaCommand> commandQueue;
+std::atomic<bool> commandsPending{false};
+// Vehicle states bypass the command queue: the bridge thread publishes each fleet update
+// as a snapshot and the simulator thread always reads the latest complete one.
+TripleBuffer<VehicleStateSnapshot> vehicleState;
+uint64_t vehicleStateSeq = 0;      // bridge thread
+uint64_t appliedVehicleStateSeq = 0;  // simulator thread
+constexpr double kCommandDrainInterval = 0.05;  // s, drain period when time sync is off
 std::atomic firstDataReceived(false);
+// Set once the client sends tick_bundle messages: receptions are then collected in
+// tickReceptions (simulator thread) and returned with the ack as one tick_result.
+std::atomic<bool> tickResultMode{false};
+std::string tickReceptions;
+// Bound of tickReceptions while no ack collects it (e.g. time sync off, or CARLA stalled);
+// further receptions go out as standalone cam_received messages until the next ack.
+constexpr size_t kMaxTickReceptionsBytes = 4 * 1024 * 1024;
+uint64_t spilledTickReceptions = 0;
+std::atomic<carla_wire::Format> ingressWireFormat{carla_wire::Format::JSON};
 
 Ptr<NrSlHelper> NazonoNrSlHelper; //deletion of this var will cause Signals.SIGABRT: 6
 std::atomic<bool> running{true};
-int send_to_carla_fd = -1;
+std::unique_ptr<CarlaBridgeIo> carlaBridge;  // owns the 5556 ingress and 5557 callback sockets
+std::unique_ptr<CarlaShmTransport> carlaShm;  // replaces carlaBridge with --transport=shm
 int totalSubChannel = 0;
 
 long long int total_volume_sent = 0;
@@ -75,6 +155,14 @@ std::mutex syncMutex;
 std::condition_variable syncCv;
 bool enableTimeSyncFlag = true;  // Use regular bool for command line parsing
 std::atomic<bool> enableTimeSync{true};
+bool lockstep = false;  // time sync on the default simulator: advance as fast as possible
+// Lockstep only: sync_request k is acked once target k - syncLookahead has been reached,
+// letting CARLA render its next tick while ns-3 simulates the current one.
+uint32_t syncLookahead = 0;
+// syncTargets, syncTargetsAcked and syncPending are shared with the bridge thread
+// (HandleCarlaDisconnected); they are only changed with syncMutex held.
+std::deque<double> syncTargets;  // lookahead mode: requested targets not reached yet
+size_t syncTargetsAcked = 0;     // leading entries of syncTargets already acked
 std::atomic<bool> syncPending{false};
 std::atomic<bool> syncDeferredUntilVehiclesReady{false};
 std::atomic<bool> hasSeenSyncRequest{false};
@@ -82,66 +170,108 @@ std::atomic<bool> hasCompletedAnySyncAck{false};
 std::atomic<double> pendingSyncTime{0.0};
 std::atomic<double> lastSyncedCarlaTime{-1.0};
 
-bool IsAutoCarlaHost() {
-  return carlaHost.empty() || carlaHost == "auto";
-}
-
 // Forward declaration
 void SendSyncAck(double carlaTime);
+void PushCommand(CarlaCommand &&cmd);
+
+// Detaching a parked vehicle's radio keeps it out of every other node's reception
+// and sensing, and suspending its sidelink scheduler skips its own per-slot LCP and
+// resource selection, so PHY/MAC cost follows the live fleet.
+void SetVehicleRadioAttached(Ptr<Node> node, bool attached) {
+  for (uint32_t i = 0; i < node->GetNDevices(); ++i) {
+    if (Ptr<NrUeNetDevice> nrDev = DynamicCast<NrUeNetDevice>(node->GetDevice(i))) {
+      for (uint32_t bwp = 0; bwp < nrDev->GetCcMapSize(); ++bwp) {
+        Ptr<NrSpectrumPhy> spectrumPhy = nrDev->GetPhy(bwp)->GetSpectrumPhy();
+        Ptr<SpectrumChannel> channel = spectrumPhy->GetSpectrumChannel();
+        if (attached) {
+          channel->AddRx(spectrumPhy);
+        } else {
+          channel->RemoveRx(spectrumPhy);
+        }
+        Ptr<NrSlUeMac> mac = nrDev->GetMac(bwp)->GetObject<NrSlUeMac>();
+        if (!mac) {
+          continue;
+        }
+        if (Ptr<NrSlUeMacSchedulerFixedMcs> scheduler =
+                DynamicCast<NrSlUeMacSchedulerFixedMcs>(mac->GetScheduler())) {
+          scheduler->SetSuspended(!attached);
+        }
+        Ptr<NrSlUeMacSchedulerManual> manual = DynamicCast<NrSlUeMacSchedulerManual>(mac->GetScheduler());
+        if (manual && !attached) {
+          manual->ClearCompletedCommands();  // the departed vehicle's pending commands
+        }
+      }
+    } else if (Ptr<WifiNetDevice> wifiDev = DynamicCast<WifiNetDevice>(node->GetDevice(i))) {
+      if (attached) {
+        wifiDev->GetPhy()->ResumeFromSleep();
+      } else {
+        wifiDev->GetPhy()->SetSleepMode();
+      }
+    }
+  }
+}
 
-void ProcessData_VehiclePosition(const json& vehicleArray) {
-  if (senders.size() < vehicleArray.size() || receivers.size() < vehicleArray.size()) {
-    std::cout << "[INFO] Vehicle state arrived before vehicles_num; initializing "
-              << vehicleArray.size() << " vehicles from vehicles_position payload\n";
-    InitializeVehicles(static_cast<uint32_t>(vehicleArray.size()));
+// Takes a pooled slot back into service for the CARLA id just bound to it.
+void UnparkVehicle(uint32_t slot) {
+  SetVehicleRadioAttached(registry.GetNode(slot), true);
+  registry.GetSender(slot)->Resume();
+  registry.GetReceiver(slot)->Resume();
+  registry.SetParked(slot, false);
+}
+
+// Takes the slot of a despawned vehicle out of service until it is handed out again.
+void ParkVehicle(uint32_t slot) {
+  registry.GetSender(slot)->Suspend();
+  registry.GetReceiver(slot)->Suspend();
+  SetVehicleRadioAttached(registry.GetNode(slot), false);
+  registry.SetParked(slot, true);
+}
+
+void ProcessData_VehiclePosition(const std::vector<VehicleSample> &vehicleArray) {
+  // Known ids keep their slot; new ones take a pooled slot, preferably their index.
+  uint32_t unbound = 0;
+  for (const auto &vehicle : vehicleArray) {
+    if (registry.Find(vehicle.carlaId) == VehicleRegistry::kNoSlot) {
+      ++unbound;
+    }
+  }
+  if (unbound > registry.GetNFree()) {
+    const uint32_t n = registry.GetN() + (unbound - registry.GetNFree());
+    std::cout << "[INFO] " << unbound << " new vehicle(s) but " << registry.GetNFree()
+              << " free slot(s); growing to " << n << " vehicles\n";
+    InitializeVehicles(n);
   }
 
   for (const auto &vehicle : vehicleArray) {
-    int id = vehicle.value("carla_id", -1);
-    int index = vehicle.value("id", -1);
+    int id = vehicle.carlaId;
+    int index = vehicle.index;
     if (id < 0 || index < 0) {
       std::cerr << "[WARN] invalid vehicle payload during ProcessData_VehiclePosition"
                 << " id=" << id << " index=" << index << "\n";
       continue;
     }
-    if(!indexBindToCarlaId) {
-      if (static_cast<size_t>(index) >= senders.size() || static_cast<size_t>(index) >= receivers.size()) {
-        std::cerr << "[WARN] vehicle index " << index << " out of range during binding"
-                  << " senders=" << senders.size()
-                  << " receivers=" << receivers.size() << "\n";
-        continue;
-      }
-      indexToCarlaId[index] = id;
-      carlaIdToIndex[id] = index;
-      senders[index]->SetVehicleId(id);
-      receivers[index]->SetVehicleId(id);
+    if (registry.Find(id) != VehicleRegistry::kNoSlot) {
+      continue;
     }
-    if(!carlaIdToIndex.count(id)) {
-      std::cerr << "[WARN] " << id << " skipped during ProcessData_VehiclePosition\n";
+    const uint32_t slot = registry.BindFree(id, static_cast<uint32_t>(index));
+    if (slot == VehicleRegistry::kNoSlot) {
+      std::cerr << "[WARN] cannot bind id " << id << " (vehicles=" << registry.GetN()
+                << ", free=" << registry.GetNFree() << ")\n";
       continue;
     }
-    const Vector pos(vehicle["position"]["x"],
-                      vehicle["position"]["y"],
-                      vehicle["position"]["z"]);
-    const Vector vel(vehicle["velocity"]["x"], vehicle["velocity"]["y"], vehicle["velocity"]["z"]);
-
-    latestPositions[id] = pos;
-    latestVelocities[id] = vel;
-
-    // if(!indexBindToCarlaId) {
-    //   const double heading = vehicle.value("heading", 0.0);
-    //   const double speed   = vehicle.value("speed", 0.0);
-
-    //   std::cout << "[INFO] Vehicle " << id << " index(" << carlaIdToIndex[id] << ") position"
-    //             << " @ (" << pos.x << "," << pos.y << ")"
-    //             << " heading: " << heading << "°"
-    //             << " speed: " << speed << " m/s\n";
-    // }
+    if (registry.IsParked(slot)) {
+      UnparkVehicle(slot);
+      std::cout << "[INFO] Vehicle " << id << " reuses slot " << slot << " (ip "
+                << registry.GetIp(slot) << ")\n";
+    }
   }
   indexBindToCarlaId = true;
   if (syncDeferredUntilVehiclesReady) {
     syncDeferredUntilVehiclesReady = false;
-    syncPending = true;
+    {
+      std::lock_guard<std::mutex> lock(syncMutex);
+      syncPending = true;
+    }
     std::cout << "[INFO] Vehicle initialization complete; releasing deferred sync request for CARLA t="
               << pendingSyncTime.load() << "s\n";
     syncCv.notify_one();
@@ -149,29 +279,64 @@ void ProcessData_VehiclePosition(const json& vehicleArray) {
   std::cout << "[INFO] Received Vehicle Position Msg at " << std::to_string(Simulator::Now().GetMilliSeconds()) << std::endl;
 }
 
-void ProcessData_TransferRequests(const json &requests) {
+// One transmission on the sidelink group for a targets/radius transfer request.
+static void SendGroupcast(const TransferRequest &req, bool bearersReady) {
+  const uint32_t source_index = registry.Find(req.source);
+  if (source_index == VehicleRegistry::kNoSlot || !indexBindToCarlaId) {
+    std::cerr << "[WARN] groupcast from " << req.source << " skipped during ProcessData_TransferRequests\n";
+    return;
+  }
+  CamSenderNR *sender_nr = GetPointer(DynamicCast<CamSenderNR>(registry.GetSender(source_index)));
+  if (!sender_nr) {
+    std::cerr << "[WARN] groupcast from " << req.source << " needs NR V2X, skipping\n";
+    return;
+  }
+  if (!sender_nr->IsRunning()) {
+    std::cerr << "[WARN] sender id: " << req.source << " is not running, skipping\n";
+    return;
+  }
+  const bool anyTargetKnown = std::any_of(req.targets.begin(), req.targets.end(), [](int target) {
+    return registry.Find(target) != VehicleRegistry::kNoSlot;
+  });
+  if (!req.targets.empty() && !anyTargetKnown && req.radius <= 0.0) {
+    std::cerr << "[WARN] groupcast from " << req.source << " has no known target, skipping\n";
+    return;
+  }
+  const uint8_t scNum = req.hasSubChannel ? req.scNum : 0;
+  if (bearersReady) {
+    // The audience has to be known before the CAM leaves.
+    groupAudience.Add(req, Simulator::Now().GetMilliSeconds());
+    sender_nr->SendGroupCam((uint32_t)req.size, req.scStart, scNum, req.txPower, registry.GetL2Id(source_index),
+                            req.pktId);
+  } else {
+    const Time sendTime = sender_nr->ScheduleGroupCam((uint32_t)req.size, req.scStart, scNum, req.txPower,
+                                                      registry.GetL2Id(source_index), req.pktId);
+    groupAudience.Add(req, sendTime.GetMilliSeconds());
+  }
+  total_volume_sent += (long long int)req.size;
+  std::cout << "[INFO] Groupcast request: " << req.source << " -> " << req.targets.size()
+            << " targets, radius " << req.radius << " m, pkt_id: " << req.pktId
+            << ", size = " << req.size << " bytes\n";
+}
+
+void ProcessData_TransferRequests(const std::vector<TransferRequest> &requests) {
+  const bool bearersReady = Simulator::Now() > slBearersReadyTime;
   for (const auto &req : requests) {
-    if (!req.contains("source") || !req.contains("target") || !req.contains("size")) {
-      std::cerr << "[WARN] transfer request missing fields, skipping\n";
+    if (req.groupcast) {
+      pkt_id_sent.push_back(req.pktId);
+      SendGroupcast(req, bearersReady);
       continue;
     }
-    int source = req["source"].get<int>();
-    int target = req["target"].get<int>();
-    int size = req["size"].get<int>();
-    int pkt_id = req["pkt_id"].get<int>();
+    int source = req.source;
+    int target = req.target;
+    int size = req.size;
+    int pkt_id = req.pktId;
     pkt_id_sent.push_back(pkt_id);
 
-    bool contains_rb = req.contains("sc_start") && req.contains("sc_num");
-    if(contains_rb) {
-      uint8_t sc_start = req["sc_start"].get<uint8_t>();
-      uint8_t sc_num = req["sc_num"].get<uint8_t>();
-      double tx_power = req.contains("tx_power") ? req["tx_power"].get<double>() : 0.1; // 默认 0.1W=20dBm
-      latestRequestsSubChannel[source] = {(uint32_t)size, target, sc_start, sc_num, tx_power};
-    } else {
-      latestRequests[source] = {size, target};
-    }
-
-    if(!carlaIdToIndex.count(source) || !carlaIdToIndex.count(target)) {
+    bool contains_rb = req.hasSubChannel;
+    const uint32_t source_index = registry.Find(source);
+    const uint32_t target_index = registry.Find(target);
+    if(source_index == VehicleRegistry::kNoSlot || target_index == VehicleRegistry::kNoSlot) {
       std::cerr << "[WARN] (" << source << ", " << target << ") skipped during ProcessData_TransferRequests\n";
       continue;
     }
@@ -184,23 +349,32 @@ void ProcessData_TransferRequests(const json &requests) {
       continue;
     }
 
-    int source_index = carlaIdToIndex[source];
-    int target_index = carlaIdToIndex[target];
-    if(source_index >= (int)senders.size() || target_index >= (int)senders.size()) {
-      std::cerr << "[ERR] index out range during ProcessData_TransferRequests, source_index = " 
-        << source_index << " id = " << source << ", or target_index = " << target_index << " id = " << target << "\n";
-      continue;
-    }
-    if(senders[source_index]->IsRunning()) {
+    const Ptr<CamSender> &sender = registry.GetSender(source_index);
+    const Ipv4Address targetIp = registry.GetIp(target_index);
+    if(sender->IsRunning()) {
+      if (lazySlBearers && nrSlStack &&
+          slBearers.Ensure(source_index, target_index, targetIp, registry.GetL2Id(target_index))) {
+        std::cout << "[INFO] Activated sidelink bearer " << source << " -> " << target << " ("
+                  << slBearers.GetN() << " active)\n";
+      }
       if(contains_rb) {
-        TransferRequestSubChannel sc_req = latestRequestsSubChannel[source];
+        const TransferRequestSubChannel sc_req{(uint32_t)size, target, req.scStart, req.scNum, req.txPower};
         std::cout << "[INFO] sender id: " << source << " sending " << sc_req.size << " bytes to id: " << target << " subChannel_start: " << (uint32_t)sc_req.start << " num: " << (uint32_t)sc_req.num << " tx_power: " << sc_req.tx_power << " W\n";
-        CamSenderNR *sender_nr = GetPointer(DynamicCast<CamSenderNR>(senders[source_index]));
-        sender_nr->ScheduleCam((uint32_t)sc_req.size, vehicleIps[target_index], sc_req.start, sc_req.num, sc_req.tx_power, vehicleL2Ids[source_index] , vehicleL2Ids[target_index]);
+        CamSenderNR *sender_nr = GetPointer(DynamicCast<CamSenderNR>(sender));
+        if (bearersReady) {
+          // Already on the simulator thread: send now instead of one event per request.
+          sender_nr->SendCam((uint32_t)sc_req.size, targetIp, sc_req.start, sc_req.num, sc_req.tx_power, registry.GetL2Id(source_index), registry.GetL2Id(target_index), pkt_id);
+        } else {
+          sender_nr->ScheduleCam((uint32_t)sc_req.size, targetIp, sc_req.start, sc_req.num, sc_req.tx_power, registry.GetL2Id(source_index), registry.GetL2Id(target_index), pkt_id);
+        }
       } else {
         std::cout << "[INFO] sender id: " << source << " sending " << size << " bytes\n";
         // 对于没有指定子信道的情况，仍然使用原有接口
-        senders[source_index]->ScheduleCam((uint32_t)size, vehicleIps[target_index]);
+        if (bearersReady) {
+          sender->SendCam((uint32_t)size, targetIp, pkt_id);
+        } else {
+          sender->ScheduleCam((uint32_t)size, targetIp, pkt_id);
+        }
       }
       total_volume_sent += (long long int)size;
     } else {
@@ -210,6 +384,18 @@ void ProcessData_TransferRequests(const json &requests) {
   std::cout << "[INFO] Received Transfer Request Msg at " << std::to_string(Simulator::Now().GetMilliSeconds()) << std::endl;
 }
 
+void ProcessData_VehiclesDespawn(const std::vector<int> &carlaIds) {
+  for (int id : carlaIds) {
+    const uint32_t slot = registry.Release(id);
+    if (slot == VehicleRegistry::kNoSlot) {
+      std::cerr << "[WARN] despawn of unknown vehicle " << id << "\n";
+      continue;
+    }
+    ParkVehicle(slot);
+    std::cout << "[INFO] Vehicle " << id << " despawned, slot " << slot << " parked\n";
+  }
+}
+
 void ProcessData_VehiclesNum(const int &num) {
   uint32_t unum = (uint32_t)num;
   if(nVehicles < unum) {
@@ -220,16 +406,16 @@ void ProcessData_VehiclesNum(const int &num) {
   // std::cout << "[INFO] ProcessData_VehiclesNum: " << nVehicles << "\n";
 }
 
-void ProcessData_SyncRequest(const json &syncData) {
+void ProcessData_SyncRequest(const SyncRequest &syncData) {
   if (!enableTimeSync) {
-    double carlaTime = syncData.value("carla_time", 0.0);
+    double carlaTime = syncData.carlaTime;
     std::cout << "[INFO] Time sync disabled, sending immediate ack for t=" << carlaTime << "s\n";
     SendSyncAck(carlaTime);
     return;
   }
 
-  double carlaTime = syncData.value("carla_time", 0.0);
-  double requestTime = syncData.value("request_time", 0.0);
+  double carlaTime = syncData.carlaTime;
+  double requestTime = syncData.requestTime;
   hasSeenSyncRequest = true;
 
   std::cout << "[INFO] Received sync_request: CARLA time = " << carlaTime << "s"
@@ -242,236 +428,543 @@ void ProcessData_SyncRequest(const json &syncData) {
 
   pendingSyncTime = carlaTime;
   lastSyncedCarlaTime = carlaTime;
-  if (syncPending) {
-    std::cerr << "[WARN] Previous sync request is still pending, overwriting target time with "
-              << carlaTime << "s\n";
+  {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    if (syncLookahead > 0) {
+      syncTargets.push_back(carlaTime);
+    } else if (syncPending) {
+      std::cerr << "[WARN] Previous sync request is still pending, overwriting target time with "
+                << carlaTime << "s\n";
+    }
+    if (nVehicles == 0) {
+      syncDeferredUntilVehiclesReady = true;
+      if (syncLookahead == 0) {
+        syncPending = false;
+      }
+      std::cout << "[INFO] Deferring sync_request until vehicles are initialized from Carla data\n";
+      return;
+    }
+    syncPending = true;
   }
-  if (nVehicles == 0) {
-    syncDeferredUntilVehiclesReady = true;
-    syncPending = false;
-    std::cout << "[INFO] Deferring sync_request until vehicles are initialized from Carla data\n";
+  syncCv.notify_one();
+}
+
+// Simulator thread: a kpi_request asks for a link_kpi summary right away.
+void ProcessData_KpiRequest() {
+  if (!kpi) {
+    std::cerr << "[WARN] kpi_request ignored, run with --linkKpi=true\n";
     return;
   }
-  syncPending = true;
-  syncCv.notify_one();
+  SendMsgToCarla(kpi->GetSummary(), true);
+  FlushMsgsToCarla();
+}
+
+void ProcessData_WireFormat(carla_wire::Format format) {
+  if (ingressWireFormat == format) {
+    return;
+  }
+  ingressWireFormat = format;
+  const char *name = (format == carla_wire::Format::BINARY) ? "binary" : "json";
+  std::cout << "[INFO] Ingress wire format switched to " << name << "\n";
+  SendMsgToCarla(std::string(R"({"type":"wire_format_ack","wire_format":")") + name +
+                     R"(","version":)" + std::to_string(carla_wire::kVersion) + "}",
+                 true);
+  FlushMsgsToCarla();
 }
 
-void ProcessJsonData(const std::string &data) {
+void ParseJson_Vehicles(const json &array, std::vector<VehicleSample> &out) {
+  out.clear();
+  for (const auto &vehicle : array) {
+    VehicleSample &v = out.emplace_back();
+    v.carlaId = vehicle.value("carla_id", -1);
+    v.index = vehicle.value("id", -1);
+    if (!vehicle.contains("position") || !vehicle.contains("velocity")) {
+      std::cerr << "[WARN] vehicle " << v.carlaId << " missing position/velocity, skipping\n";
+      out.pop_back();
+      continue;
+    }
+    const json &position = vehicle["position"];
+    const json &velocity = vehicle["velocity"];
+    v.position = Vector(position.value("x", 0.0), position.value("y", 0.0), position.value("z", 0.0));
+    v.velocity = Vector(velocity.value("x", 0.0), velocity.value("y", 0.0), velocity.value("z", 0.0));
+    if (vehicle.contains("acceleration")) {
+      const json &acceleration = vehicle["acceleration"];
+      v.acceleration = Vector(acceleration.value("x", 0.0), acceleration.value("y", 0.0),
+                              acceleration.value("z", 0.0));
+    }
+    v.yawRate = vehicle.value("yaw_rate", 0.0);
+  }
+}
+
+void ParseJson_TransferRequests(const json &array, std::vector<TransferRequest> &out) {
+  out.clear();
+  for (const auto &req : array) {
+    const bool groupcast = req.contains("targets") || req.contains("radius");
+    if (!req.contains("source") || !(req.contains("target") || groupcast) || !req.contains("size")) {
+      std::cerr << "[WARN] transfer request missing fields, skipping\n";
+      continue;
+    }
+    TransferRequest &r = out.emplace_back();
+    r.source = req["source"].get<int>();
+    r.target = req.value("target", -1);
+    r.size = req["size"].get<int>();
+    r.groupcast = groupcast;
+    if (groupcast) {
+      r.targets = req.value("targets", std::vector<int>{});
+      r.radius = req.value("radius", 0.0);
+    }
+    r.pktId = req.value("pkt_id", -1);
+    r.hasSubChannel = req.contains("sc_start") && req.contains("sc_num");
+    if (r.hasSubChannel) {
+      r.scStart = req["sc_start"].get<uint8_t>();
+      r.scNum = req["sc_num"].get<uint8_t>();
+      r.txPower = req.value("tx_power", 0.1); // 默认 0.1W=20dBm
+    }
+  }
+}
+
+void ProcessJsonData(std::string_view data) {
+  static CarlaJsonDecoder decoder;
+
+  CarlaCommand cmd;
+  CarlaJsonDecoder::Result decoded;
+  const CarlaJsonDecoder::Status status =
+      decoder.Decode(data, decoded, vehicleState.Back().vehicles, cmd.requests);
+  if (status == CarlaJsonDecoder::Status::OK) {
+    switch (decoded.type) {
+    case CarlaJsonDecoder::Type::VEHICLES_POSITION:
+      if (decoded.droppedRecords > 0) {
+        std::cerr << "[WARN] Skipped " << decoded.droppedRecords
+                  << " vehicle(s) missing position/velocity\n";
+      }
+      cmd.kind = CarlaCommand::Kind::VEHICLES_POSITION;
+      cmd.vehiclesTime = decoded.carlaTime;
+      PushCommand(std::move(cmd));
+      break;
+    case CarlaJsonDecoder::Type::TRANSFER_REQUESTS:
+      if (decoded.droppedRecords > 0) {
+        std::cerr << "[WARN] Skipped " << decoded.droppedRecords
+                  << " transfer request(s) missing source/target/size\n";
+      }
+      cmd.kind = CarlaCommand::Kind::TRANSFER_REQUESTS;
+      PushCommand(std::move(cmd));
+      break;
+    case CarlaJsonDecoder::Type::VEHICLES_NUM:
+      cmd.kind = CarlaCommand::Kind::VEHICLES_NUM;
+      cmd.vehiclesNum = decoded.vehiclesNum;
+      PushCommand(std::move(cmd));
+      break;
+    case CarlaJsonDecoder::Type::SYNC_REQUEST:
+      cmd.kind = CarlaCommand::Kind::SYNC_REQUEST;
+      cmd.sync = decoded.sync;
+      PushCommand(std::move(cmd));
+      break;
+    case CarlaJsonDecoder::Type::VEHICLES_DESPAWN:
+      cmd.kind = CarlaCommand::Kind::VEHICLES_DESPAWN;
+      cmd.despawned = std::move(decoded.despawned);
+      PushCommand(std::move(cmd));
+      break;
+    case CarlaJsonDecoder::Type::TICK_BUNDLE:
+      if (decoded.droppedRecords > 0) {
+        std::cerr << "[WARN] Skipped " << decoded.droppedRecords
+                  << " incomplete vehicle/transfer record(s) in tick_bundle\n";
+      }
+      cmd.kind = CarlaCommand::Kind::TICK_BUNDLE;
+      cmd.hasVehiclesNum = decoded.hasVehiclesNum;
+      cmd.hasVehicles = decoded.hasVehicles;
+      cmd.hasSync = decoded.hasSync;
+      cmd.vehiclesNum = decoded.vehiclesNum;
+      cmd.sync = decoded.sync;
+      cmd.despawned = std::move(decoded.despawned);
+      PushCommand(std::move(cmd));
+      break;
+    case CarlaJsonDecoder::Type::NONE:
+      break;
+    }
+    return;
+  }
+  // Anything the fast decoder does not handle (handshakes, escapes, malformed input)
+  // goes through the generic parser, which also produces the diagnostics.
+
   try {
-    json msg = json::parse(data);
-    std::lock_guard<std::mutex> lock(dataMutex);
+    json msg = json::parse(data.begin(), data.end());
 
-    // Debug: print all received message types and key fields
     if (msg.contains("type")) {
       std::string type = msg["type"].get<std::string>();
-      std::cout << "[DEBUG] Received message type: " << type << std::endl;
+      NS_LOG_DEBUG("Received message type: " << type);
 
       if (type == "transfer_requests") {
-        std::cout << "[DEBUG] Processing transfer_requests with "
-                  << (msg.contains("transfer_requests") ? msg["transfer_requests"].size() : 0) << " requests\n";
+        NS_LOG_DEBUG("Processing transfer_requests with "
+                     << (msg.contains("transfer_requests") ? msg["transfer_requests"].size() : 0) << " requests");
         if (!msg.contains("transfer_requests") || !msg["transfer_requests"].is_array()) {
           std::cerr << "[ERR] transfer_requests message missing 'transfer_requests' array\n";
-          std::cerr << "[DEBUG] Raw msg keys: ";
-          for (auto& el : msg.items()) std::cerr << el.key() << " ";
-          std::cerr << "\n";
+          NS_LOG_DEBUG("Raw message: " << data.substr(0, 500));
           return;
         }
-        ProcessData_TransferRequests(msg["transfer_requests"]);
+        cmd.kind = CarlaCommand::Kind::TRANSFER_REQUESTS;
+        ParseJson_TransferRequests(msg["transfer_requests"], cmd.requests);
+        PushCommand(std::move(cmd));
       }
 
       else if (type == "vehicles_position") {
-        std::cout << "[DEBUG] Processing vehicles_position with "
-                  << (msg.contains("vehicles_position") ? msg["vehicles_position"].size() : 0) << " vehicles\n";
+        NS_LOG_DEBUG("Processing vehicles_position with "
+                     << (msg.contains("vehicles_position") ? msg["vehicles_position"].size() : 0) << " vehicles");
         if (!msg.contains("vehicles_position") || !msg["vehicles_position"].is_array()) {
           std::cerr << "[ERR] vehicles_position message missing 'vehicles_position' array\n";
           return;
         }
-        ProcessData_VehiclePosition(msg["vehicles_position"]);
+        cmd.kind = CarlaCommand::Kind::VEHICLES_POSITION;
+        cmd.vehiclesTime = msg.value("carla_time", -1.0);
+        ParseJson_Vehicles(msg["vehicles_position"], vehicleState.Back().vehicles);
+        PushCommand(std::move(cmd));
       }
 
       else if (type == "vehicles_num") {
-        std::cout << "[DEBUG] Processing vehicles_num: " << msg.value("vehicles_num", -1) << "\n";
+        NS_LOG_DEBUG("Processing vehicles_num: " << msg.value("vehicles_num", -1));
         if (!msg.contains("vehicles_num")) {
           std::cerr << "[ERR] vehicles_num message missing 'vehicles_num'\n";
           return;
         }
-        ProcessData_VehiclesNum(msg["vehicles_num"].get<int>());
+        cmd.kind = CarlaCommand::Kind::VEHICLES_NUM;
+        cmd.vehiclesNum = msg["vehicles_num"].get<int>();
+        PushCommand(std::move(cmd));
+      }
+
+      else if (type == "vehicles_despawn") {
+        if (!msg.contains("vehicles_despawn") || !msg["vehicles_despawn"].is_array()) {
+          std::cerr << "[ERR] vehicles_despawn message missing 'vehicles_despawn' array\n";
+          return;
+        }
+        cmd.kind = CarlaCommand::Kind::VEHICLES_DESPAWN;
+        cmd.despawned = msg["vehicles_despawn"].get<std::vector<int>>();
+        PushCommand(std::move(cmd));
       }
 
       else if (type == "sync_request") {
-        std::cout << "[DEBUG] Processing sync_request with carla_time: "
-                  << msg["sync_request"].value("carla_time", -1.0) << "\n";
         if (!msg.contains("sync_request")) {
           std::cerr << "[ERR] sync_request message missing 'sync_request' data\n";
           return;
         }
-        ProcessData_SyncRequest(msg["sync_request"]);
+        NS_LOG_DEBUG("Processing sync_request with carla_time: "
+                     << msg["sync_request"].value("carla_time", -1.0));
+        cmd.kind = CarlaCommand::Kind::SYNC_REQUEST;
+        cmd.sync.carlaTime = msg["sync_request"].value("carla_time", 0.0);
+        cmd.sync.requestTime = msg["sync_request"].value("request_time", 0.0);
+        PushCommand(std::move(cmd));
+      }
+
+      else if (type == "tick_bundle") {
+        if (!msg.contains("tick_bundle") || !msg["tick_bundle"].is_object()) {
+          std::cerr << "[ERR] tick_bundle message missing 'tick_bundle' object\n";
+          return;
+        }
+        const json &bundle = msg["tick_bundle"];
+        cmd.kind = CarlaCommand::Kind::TICK_BUNDLE;
+        if (bundle.contains("vehicles_despawn") && bundle["vehicles_despawn"].is_array()) {
+          cmd.despawned = bundle["vehicles_despawn"].get<std::vector<int>>();
+        }
+        if (bundle.contains("vehicles_num")) {
+          cmd.hasVehiclesNum = true;
+          cmd.vehiclesNum = bundle["vehicles_num"].get<int>();
+        }
+        if (bundle.contains("vehicles_position") && bundle["vehicles_position"].is_array()) {
+          cmd.hasVehicles = true;
+          ParseJson_Vehicles(bundle["vehicles_position"], vehicleState.Back().vehicles);
+        }
+        if (bundle.contains("transfer_requests") && bundle["transfer_requests"].is_array()) {
+          ParseJson_TransferRequests(bundle["transfer_requests"], cmd.requests);
+        }
+        if (bundle.contains("sync_request")) {
+          cmd.hasSync = true;
+          cmd.sync.carlaTime = bundle["sync_request"].value("carla_time", 0.0);
+          cmd.sync.requestTime = bundle["sync_request"].value("request_time", 0.0);
+        }
+        PushCommand(std::move(cmd));
+      }
+
+      else if (type == "kpi_request") {
+        cmd.kind = CarlaCommand::Kind::KPI_REQUEST;
+        PushCommand(std::move(cmd));
+      }
+
+      else if (type == "wire_format") {
+        const std::string format = msg.value("wire_format", std::string("json"));
+        if (format == "binary") {
+          ProcessData_WireFormat(carla_wire::Format::BINARY);
+        } else if (format == "json") {
+          ProcessData_WireFormat(carla_wire::Format::JSON);
+        } else {
+          std::cerr << "[ERR] Unknown wire_format: " << format << "\n";
+        }
       }
 
       else{
         std::cerr << "[ERR] Wrong type: " << type << "\n";
-        std::cerr << "[DEBUG] Full raw message: " << data.substr(0, 500) << "\n";
+        NS_LOG_DEBUG("Raw message: " << data.substr(0, 500));
       }
     }
 
     else {
       std::cerr << "[ERR] Message does not contain 'type'\n";
-      std::cerr << "[DEBUG] Raw message without type: " << data.substr(0, 500) << "\n";
+      NS_LOG_DEBUG("Raw message: " << data.substr(0, 500));
     }
   }
   catch (json::exception &e) {
     std::cerr << "[ERR] JSON parse error: " << e.what() << "; input: " << data.substr(0, 200) << "\n";
+  }}
+
+void ProcessBinaryData(std::string_view data) {
+  carla_wire::FrameHeader header;
+  const char *error = nullptr;
+  if (!carla_wire::DecodeHeader(data, header, error)) {
+    std::cerr << "[ERR] Binary frame rejected: " << error << " (" << data.size() << " bytes)\n";
+    return;
   }
 
-  if (!firstDataReceived) {
-    firstDataReceived = true;
-    std::cout << "[INFO] First data received from Carla!\n";
+  CarlaCommand cmd;
+  switch (header.type) {
+    case carla_wire::MessageType::VEHICLES_POSITION:
+      cmd.kind = CarlaCommand::Kind::VEHICLES_POSITION;
+      vehicleState.Back().vehicles.clear();
+      if (!carla_wire::DecodeVehicles(header, data, vehicleState.Back().vehicles, cmd.vehiclesTime)) {
+        std::cerr << "[ERR] Malformed binary vehicles_position frame\n";
+        return;
+      }
+      PushCommand(std::move(cmd));
+      break;
+    case carla_wire::MessageType::TRANSFER_REQUESTS:
+      cmd.kind = CarlaCommand::Kind::TRANSFER_REQUESTS;
+      if (!carla_wire::DecodeTransferRequests(header, data, cmd.requests)) {
+        std::cerr << "[ERR] Malformed binary transfer_requests frame\n";
+        return;
+      }
+      PushCommand(std::move(cmd));
+      break;
+    case carla_wire::MessageType::VEHICLES_NUM:
+      cmd.kind = CarlaCommand::Kind::VEHICLES_NUM;
+      cmd.vehiclesNum = static_cast<int>(header.count);
+      PushCommand(std::move(cmd));
+      break;
+    case carla_wire::MessageType::SYNC_REQUEST:
+      cmd.kind = CarlaCommand::Kind::SYNC_REQUEST;
+      if (!carla_wire::DecodeSyncRequest(header, data, cmd.sync)) {
+        std::cerr << "[ERR] Malformed binary sync_request frame\n";
+        return;
+      }
+      PushCommand(std::move(cmd));
+      break;
+    case carla_wire::MessageType::VEHICLES_DESPAWN:
+      cmd.kind = CarlaCommand::Kind::VEHICLES_DESPAWN;
+      if (!carla_wire::DecodeDespawn(header, data, cmd.despawned)) {
+        std::cerr << "[ERR] Malformed binary vehicles_despawn frame\n";
+        return;
+      }
+      PushCommand(std::move(cmd));
+      break;
+    case carla_wire::MessageType::WIRE_FORMAT:
+      ProcessData_WireFormat(carla_wire::Format::JSON);
+      break;
+    case carla_wire::MessageType::KPI_REQUEST:
+      cmd.kind = CarlaCommand::Kind::KPI_REQUEST;
+      PushCommand(std::move(cmd));
+      break;
+    default:
+      std::cerr << "[ERR] Unknown binary message type: " << static_cast<uint32_t>(header.type) << "\n";
+      return;
   }
 }
 
-void ProcessReceivedData(std::string &receive_buffer) {
-  size_t pos;
-  while ((pos = receive_buffer.find("\n\r")) != std::string::npos) {
-    std::string complete_message = receive_buffer.substr(0, pos);
-    receive_buffer.erase(0, pos + 2);  // Skip past "\n\r" which is 2 chars
-    if (!complete_message.empty()) {
-      // Debug: print raw message before processing
-      std::cout << "[DEBUG] Raw incoming: " << complete_message.substr(0, std::min((size_t)300, complete_message.size())) << "\n";
-      try {
-          ProcessJsonData(complete_message);
-      } catch (const std::exception& e) {
-          std::cerr << "[ERR] Failed to process message: " << e.what() << std::endl;
-          std::cerr << "Raw message: " << complete_message << std::endl;
+void ProcessReceivedData(IngressFramer &framer) {
+  std::string_view complete_message;
+  while (framer.NextFrame(complete_message)) {
+    if (complete_message.empty()) {
+      continue;
+    }
+    try {
+      if (framer.IsLengthPrefixed()) {
+        ProcessBinaryData(complete_message);
+      } else {
+        ProcessJsonData(complete_message);
+      }
+    } catch (const std::exception& e) {
+        std::cerr << "[ERR] Failed to process message: " << e.what() << std::endl;
+        std::cerr << "Raw message: " << complete_message.substr(0, 500) << std::endl;
+    }
+    // A wire_format handshake applies to the bytes right after it.
+    const bool wantBinary = (ingressWireFormat == carla_wire::Format::BINARY);
+    if (wantBinary != framer.IsLengthPrefixed()) {
+      if (wantBinary) {
+        framer.UseLengthPrefixedFrames(carla_wire::kHeaderSize, carla_wire::kLengthOffset);
+      } else {
+        framer.UseDelimitedFrames();
       }
     }
   }
 }
 
-void SocketReceiverServerThread() {
-  sockaddr_in address{};
-  int addrlen = sizeof(address);
-  char buffer[8192];
-  std::string receive_buffer_string;
-
-  int server_fd = socket(AF_INET, SOCK_STREAM, 0);
-  if (server_fd < 0) {
-    perror("socket failed");
-    return;
+// Shared-memory transport thread: a ring record is a whole message, binary frames are
+// told apart from JSON by their magic.
+void ProcessShmCommand(std::string_view record) {
+  uint32_t magic = 0;
+  if (record.size() >= sizeof(magic)) {
+    std::memcpy(&magic, record.data(), sizeof(magic));
   }
+  try {
+    if (magic == carla_wire::kMagic) {
+      ProcessBinaryData(record);
+    } else {
+      ProcessJsonData(record);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERR] Failed to process message: " << e.what() << std::endl;
+  }
+}
 
-  int opt = 1;
-  setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-  address.sin_family = AF_INET;
-  address.sin_addr.s_addr = INADDR_ANY;
-  address.sin_port = htons(5556);
+// Shared-memory transport thread: CARLA published a new vehicle table. The table is
+// swapped into the snapshot back buffer; the transport refills the one it gets back.
+void ProcessShmVehicles(std::vector<VehicleSample> &vehicles, double carlaTime) {
+  CarlaCommand cmd;
+  cmd.kind = CarlaCommand::Kind::VEHICLES_POSITION;
+  cmd.vehiclesTime = carlaTime;
+  vehicleState.Back().vehicles.swap(vehicles);
+  PushCommand(std::move(cmd));
+}
 
-  if (bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
-    perror("bind failed");
-    close(server_fd);
-    return;
+// Bridge thread: hand one decoded message over to the simulator thread. Vehicle states
+// were decoded into vehicleState.Back() already and are published here in place, so
+// the three snapshot buffers keep their capacity and a steady fleet allocates nothing.
+void PushCommand(CarlaCommand &&cmd) {
+  if (cmd.kind == CarlaCommand::Kind::VEHICLES_POSITION ||
+      (cmd.kind == CarlaCommand::Kind::TICK_BUNDLE && cmd.hasVehicles)) {
+    // The queued command only marks where the update happened relative to the others.
+    if (cmd.kind == CarlaCommand::Kind::TICK_BUNDLE && cmd.hasSync) {
+      cmd.vehiclesTime = cmd.sync.carlaTime;  // a bundle's states belong to its tick
+    }
+    VehicleStateSnapshot &snapshot = vehicleState.Back();
+    snapshot.seq = ++vehicleStateSeq;
+    snapshot.carlaTime = cmd.vehiclesTime;
+    vehicleState.Publish();
+  }
+  commandQueue.Push(std::move(cmd));
+  {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    commandsPending = true;
   }
+  syncCv.notify_one();
+  if (!firstDataReceived) {
+    firstDataReceived = true;
+    std::cout << "[INFO] First data received from Carla!\n";
+  }
+}
 
-  if (listen(server_fd, 1) < 0) {
-    perror("listen failed");
-    close(server_fd);
-    return;
+// Simulator thread: a vehicle update was published. Binding and initialization happen
+// now; the nodes move at the sample's own time, or right away if it has none.
+void ProcessVehicleStateUpdate(double carlaTime) {
+  vehicleState.Update();
+  ProcessData_VehiclePosition(vehicleState.Front().vehicles);
+  // CARLA time only lines up with the simulation clock in time sync mode.
+  const Time now = Simulator::Now();
+  if (enableTimeSync && carlaTime >= 0 && Seconds(carlaTime) > now) {
+    Simulator::Schedule(Seconds(carlaTime) - now, &UpdateVehiclePositions);
+  } else {
+    UpdateVehiclePositions();
   }
+}
 
-  std::cout << "[INFO] Waiting for Carla on port 5556...\n";
-  while (running) {
-    const int client_fd =
-        accept(server_fd, reinterpret_cast<sockaddr*>(&address), reinterpret_cast<socklen_t*>(&addrlen));
-    if (client_fd < 0) {
-      if (!running) {
+// Simulator thread: apply every queued command in arrival order.
+void DrainCommands() {
+  commandsPending = false;
+  CarlaCommand cmd;
+  while (commandQueue.Pop(cmd)) {
+    switch (cmd.kind) {
+      case CarlaCommand::Kind::VEHICLES_NUM:
+        ProcessData_VehiclesNum(cmd.vehiclesNum);
         break;
-      }
-      perror("accept failed");
-      std::this_thread::sleep_for(std::chrono::milliseconds(200));
-      continue;
-    }
-
-    char peerIp[INET_ADDRSTRLEN] = {0};
-    const char* peerIpText = inet_ntop(AF_INET, &address.sin_addr, peerIp, sizeof(peerIp));
-    if (peerIpText != nullptr) {
-      std::cout << "[INFO] Carla connected on port 5556 from " << peerIpText << ".\n";
-      if (IsAutoCarlaHost()) {
-        carlaHost = peerIpText;
-        std::cout << "[INFO] Auto-detected Carla callback host as " << carlaHost << ".\n";
-      }
-    } else {
-      std::cout << "[INFO] Carla connected on port 5556.\n";
-    }
-
-    while (running) {
-      // Use select() with a timeout to avoid permanent blocking in recv().
-      fd_set read_fds;
-      FD_ZERO(&read_fds);
-      FD_SET(client_fd, &read_fds);
-      struct timeval tv;
-      tv.tv_sec = 2;
-      tv.tv_usec = 0;
-
-      int select_result = select(client_fd + 1, &read_fds, nullptr, nullptr, &tv);
-      if (select_result < 0) {
-        std::cerr << "[ERR] select failed in SocketReceiverServerThread\n";
+      case CarlaCommand::Kind::VEHICLES_POSITION:
+        ProcessVehicleStateUpdate(cmd.vehiclesTime);
         break;
-      }
-      if (select_result == 0) {
-        continue;
-      }
-
-      memset(buffer, 0, sizeof(buffer));
-      const ssize_t bytes = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-
-      if (bytes <= 0) {
-        std::cout << "[INFO] Carla disconnected or error on port 5556; waiting for reconnection.\n";
-        syncPending = false;
-        syncCv.notify_one();
+      case CarlaCommand::Kind::TRANSFER_REQUESTS:
+        ProcessData_TransferRequests(cmd.requests);
+        break;
+      case CarlaCommand::Kind::SYNC_REQUEST:
+        ProcessData_SyncRequest(cmd.sync);
+        break;
+      case CarlaCommand::Kind::VEHICLES_DESPAWN:
+        ProcessData_VehiclesDespawn(cmd.despawned);
+        break;
+      case CarlaCommand::Kind::KPI_REQUEST:
+        ProcessData_KpiRequest();
+        break;
+      case CarlaCommand::Kind::TICK_BUNDLE:
+        // A bundling client gets one tick_result per tick instead of sync_ack +
+        // individual cam_received messages.
+        tickResultMode = true;
+        // Despawns first, so the bundle's new vehicles can take the freed slots.
+        if (!cmd.despawned.empty()) {
+          ProcessData_VehiclesDespawn(cmd.despawned);
+        }
+        if (cmd.hasVehiclesNum) {
+          ProcessData_VehiclesNum(cmd.vehiclesNum);
+        }
+        if (cmd.hasVehicles) {
+          ProcessVehicleStateUpdate(cmd.vehiclesTime);
+        }
+        if (!cmd.requests.empty()) {
+          ProcessData_TransferRequests(cmd.requests);
+        }
+        if (cmd.hasSync) {
+          ProcessData_SyncRequest(cmd.sync);
+        }
         break;
-      }
-
-      buffer[bytes] = '\0';
-      receive_buffer_string = std::string(buffer);
-      ProcessReceivedData(receive_buffer_string);
     }
+  }
+}
 
-    close(client_fd);
-    std::cout << "[INFO] Receiver connection on port 5556 closed.\n";
+void DrainCommandsPeriodic() {
+  DrainCommands();
+  if (running) {
+    Simulator::Schedule(Seconds(kCommandDrainInterval), &DrainCommandsPeriodic);
   }
+}
 
-  close(server_fd);
+void HandleCarlaDisconnected() {
+  tickResultMode = false;
+  {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    syncPending = false;
+    syncTargets.clear();
+    syncTargetsAcked = 0;
+  }
+  syncCv.notify_one();
+  ingressWireFormat = carla_wire::Format::JSON;
 }
 
+// Applies the latest vehicle state snapshot once its sample time has been reached.
+// Scheduled per update by ProcessVehicleStateUpdate; CarlaMobilityModel extrapolates
+// in between, so nothing polls.
 void UpdateVehiclePositions() {
   try{
-    std::lock_guard lock(dataMutex);
-    for (const auto &[id, pos] : latestPositions) {
-      if(!carlaIdToIndex.count(id)) {
-        std::cerr << "[WARN] " << id << " skipped during UpdateVehiclePositions\n";
-        continue;
-      }
-      uint32_t index = (uint32_t)carlaIdToIndex[id];
-      if (index >= vehicles.GetN()) { 
-        std::cerr << "[ERR] (" << id << "-> "<< index << ") skipped during UpdateVehiclePositions\n";
-        continue;
-      }
-      Ptr<ConstantVelocityMobilityModel> mobility =
-          vehicles.Get(index)->GetObject<ConstantVelocityMobilityModel>();
-      if (mobility) {
-        mobility->SetPosition(pos);
-        mobility->SetVelocity(latestVelocities[id]);
+    vehicleState.Update();
+    const VehicleStateSnapshot &snapshot = vehicleState.Front();
+    if (snapshot.seq == appliedVehicleStateSeq) {
+      return;
+    }
+    const Time now = Simulator::Now();
+    Time sampleTime = now;
+    if (enableTimeSync && snapshot.carlaTime >= 0) {
+      if (Seconds(snapshot.carlaTime) > now) {
+        return;  // a newer sample overtook ours; its own event applies it
       }
+      sampleTime = Seconds(snapshot.carlaTime);
     }
-    // Always schedule UpdateVehiclePositions, but the interval depends on sync mode
-    if (running) {
-      if (enableTimeSync) {
-        // In sync mode, update every 0.05s (CARLA tick interval)
-        Simulator::Schedule(Seconds(0.05), &UpdateVehiclePositions);
-      } else {
-        // In non-sync mode, also update every 0.05s
-        Simulator::Schedule(Seconds(0.05), &UpdateVehiclePositions);
+    appliedVehicleStateSeq = snapshot.seq;
+    for (const VehicleSample &vehicle : snapshot.vehicles) {
+      const uint32_t slot = registry.Find(vehicle.carlaId);
+      if (slot == VehicleRegistry::kNoSlot) {
+        std::cerr << "[WARN] " << vehicle.carlaId << " skipped during UpdateVehiclePositions\n";
+        continue;
       }
+      registry.SetState(slot, vehicle, sampleTime);
     }
   } 
   catch(std::exception &e) { std::cerr << "[ERR] UpdateVehiclePositions error: " << e.what() << "\n"; }
@@ -480,80 +973,111 @@ void UpdateVehiclePositions() {
 }
 
 void SendSimulationEndSignal() {
+  if (kpi) {
+    std::string summary = kpi->GetSummary();
+    std::cout << "[INFO] Final link KPIs: " << summary << "\n";
+    SendMsgToCarla(std::move(summary), false);
+  }
   std::string msg = R"({"type": "simulation_end"})";
   SendMsgToCarla(msg, false);
+  FlushMsgsToCarla();
+}
+
+// cam_received reports from the receivers; simulator thread.
+void ReportReception(const std::string &msg) {
+  if (tickResultMode) {
+    if (tickReceptions.size() + msg.size() < kMaxTickReceptionsBytes) {
+      if (!tickReceptions.empty()) {
+        tickReceptions += ',';
+      }
+      tickReceptions += msg;
+      return;
+    }
+    if (spilledTickReceptions++ == 0) {
+      std::cerr << "[WARN] " << tickReceptions.size() << " bytes of receptions wait for a tick_result; "
+                << "sending further ones as standalone cam_received\n";
+    }
+  }
+  SendMsgToCarla(msg, true);
 }
 
 void SendSyncAck(double carlaTime) {
   double ns3Time = Simulator::Now().GetSeconds();
+  const bool kpiDue = kpi && kpiInterval > 0 && ++kpiTicks % kpiInterval == 0;
+
+  if (tickResultMode) {
+    // Ack plus every reception since the previous ack, in one message.
+    std::string result = R"({"type":"tick_result","carla_time":)" + json(carlaTime).dump() +
+                         R"(,"ns3_time":)" + json(ns3Time).dump() + R"(,"receptions":[)";
+    result += tickReceptions;
+    result += ']';
+    if (kpiDue) {
+      result += R"(,"kpi":)" + kpi->GetSummary();
+    }
+    result += '}';
+    tickReceptions.clear();
+    spilledTickReceptions = 0;
+    SendMsgToCarla(std::move(result), true);
+  } else {
+    if (kpiDue) {
+      SendMsgToCarla(kpi->GetSummary(), true);
+    }
+    json ack;
+    ack["type"] = "sync_ack";
+    ack["carla_time"] = carlaTime;
+    ack["ns3_time"] = ns3Time;
+    SendMsgToCarla(ack.dump(), true);
+  }
+  FlushMsgsToCarla();
 
-  json ack;
-  ack["type"] = "sync_ack";
-  ack["carla_time"] = carlaTime;
-  ack["ns3_time"] = ns3Time;
-
-  std::string msg = ack.dump();
-  SendMsgToCarla(msg, true);
-
-  std::cout << "[INFO] Sent sync_ack: CARLA t=" << carlaTime << "s, NS3 t=" << ns3Time << "s\n";
+  std::cout << "[INFO] Sent " << (tickResultMode ? "tick_result" : "sync_ack") << ": CARLA t="
+            << carlaTime << "s, NS3 t=" << ns3Time << "s\n";
 
   hasCompletedAnySyncAck = true;
-  syncPending = false;
+  {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    syncPending = false;
+  }
   syncCv.notify_one();
 }
 
-void SendMsgToCarla(const std::string &msg, bool try_reconnect = true) {
-  std::lock_guard<std::mutex> lock(msgMutex);
-  std::string msg_with_delimiter = msg + "\r\n";
-  std::cout << "[INFO] SendMsgToCarla: " << msg << ", send_to_carla_fd: " << send_to_carla_fd << "\n";
-  if(send_to_carla_fd < 0 && try_reconnect) { //if not connected, try to connect for once
-    SocketSenderServerConnect();
-    if(send_to_carla_fd < 0) {
-      std::cerr << "[ERR] send_to_carla_fd is not connected\n";
-      return;
+// Called for every cam_received report: only pushes into the bridge's lock-free
+// outbound queue; the bridge thread coalesces the writes.
+void SendMsgToCarla(std::string msg, bool try_reconnect = true) {
+  if (carlaShm) {
+    if (!carlaShm->Enqueue(std::move(msg), try_reconnect)) {
+      std::cerr << "[ERR] Message for Carla dropped (not attached)\n";
     }
+    return;
   }
-  if (send(send_to_carla_fd, msg_with_delimiter.c_str(), msg_with_delimiter.size(), 0) < 0 && try_reconnect) {
-    std::cerr << "[ERR] send failed, send_to_carla_fd = " << send_to_carla_fd << "\n";
-    perror("[ERR] send failed");
-    SocketSenderServerConnect();
-  }
-}
-
-void SocketSenderServerConnect() {
-  if (send_to_carla_fd >= 0) {
-      close(send_to_carla_fd);
-      send_to_carla_fd = -1;
-      std::cout << "[INFO] Previous connection to Carla closed.\n";
-  }
-
-  std::cout << "[INFO] Connecting to Carla on port 5557...\n";
-  send_to_carla_fd = socket(AF_INET, SOCK_STREAM, 0);
-  if (send_to_carla_fd < 0) {
-    perror("[ERR] socket failed");
+  if (!carlaBridge) {
+    std::cerr << "[ERR] Carla bridge is not running\n";
     return;
   }
+  if (!carlaBridge->Enqueue(std::move(msg), try_reconnect)) {
+    std::cerr << "[ERR] Message for Carla dropped (" << (try_reconnect ? "queue full" : "not connected") << ")\n";
+  }
+}
 
-  sockaddr_in address{};
-  address.sin_family = AF_INET;
-  address.sin_addr.s_addr = inet_addr(carlaHost.c_str());
-  address.sin_port = htons(5557);
-
-  if (connect(send_to_carla_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
-    perror("[ERR] connect failed");
-    close(send_to_carla_fd);
-    send_to_carla_fd = -1;
-    return;
+// Writes out everything queued for Carla, e.g. the reports of a finished sync tick.
+void FlushMsgsToCarla() {
+  if (carlaShm) {
+    carlaShm->Flush();
+  } else if (carlaBridge) {
+    carlaBridge->Flush();
   }
-  std::cout << "[INFO] Connected to Carla on port 5557.\n";
 }
 
 void SocketSenderServerDisconnect() {
-  if (send_to_carla_fd != -1) {
-    close(send_to_carla_fd);
-    send_to_carla_fd = -1;
+  if (carlaBridge) {
+    carlaBridge->Stop();
     std::cout << "[INFO] Disconnected from Carla on port 5557.\n";
   }
+  if (carlaShm) {
+    carlaShm->Stop();
+    std::cout << "[INFO] Shared-memory transport " << shmName << " closed ("
+              << carlaShm->GetDroppedMessages() << " messages dropped).\n";
+  }
   std::cout << "[INFO] pkt_id sent to Carla: \n";
   for(auto& id : pkt_id_sent) {
     std::cout << id << ", ";
@@ -561,12 +1085,122 @@ void SocketSenderServerDisconnect() {
   std::cout << "[INFO] Total volume sent to Carla: " << total_volume_sent << " bytes\n";
 }
 
+// Blocks the simulator thread until a sync_request is pending, applying queued
+// commands (positions, transfer requests, the sync_request itself) meanwhile.
+// The simulator is either stopped or inside a SyncGate event, so this is safe.
+// Returns false on shutdown.
+bool WaitForSyncRequest() {
+  std::unique_lock<std::mutex> lock(syncMutex);
+  auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(10);
+  while (!syncPending && running) {
+    if (commandsPending) {
+      lock.unlock();
+      DrainCommands();
+      lock.lock();
+      continue;
+    }
+    if (syncCv.wait_until(lock, deadline) == std::cv_status::timeout) {
+      if (hasCompletedAnySyncAck) {
+        std::cerr << "[WARN] Waiting for sync timeout at NS3 time "
+                  << Simulator::Now().GetSeconds() << "s\n";
+      }
+      deadline = std::chrono::system_clock::now() + std::chrono::seconds(10);
+    }
+  }
+  return running;
+}
+
+// Lookahead mode: ack every queued target that is at most syncLookahead targets
+// ahead of the one being simulated.
+// Acks are sent without syncMutex held.
+void AckSyncTargetsWithinLookahead() {
+  while (true) {
+    double target;
+    {
+      std::lock_guard<std::mutex> lock(syncMutex);
+      const size_t ackable = std::min<size_t>(syncTargets.size(), syncLookahead);
+      if (syncTargetsAcked >= ackable) {
+        syncPending = !syncTargets.empty();
+        return;
+      }
+      target = syncTargets[syncTargetsAcked++];
+    }
+    SendSyncAck(target);
+  }
+}
+
+// The simulation reached the target of a sync_request.
+void CompleteSyncTarget(double carlaTime) {
+  if (syncLookahead == 0) {
+    SendSyncAck(carlaTime);
+    return;
+  }
+  bool ackedAhead = false;
+  {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    if (!syncTargets.empty()) {  // a disconnect may have dropped the queue meanwhile
+      syncTargets.pop_front();
+    }
+    if (syncTargetsAcked > 0) {
+      --syncTargetsAcked;  // acked ahead of time; its reports go out with the next ack
+      ackedAhead = true;
+    }
+  }
+  if (!ackedAhead) {
+    SendSyncAck(carlaTime);
+  }
+  AckSyncTargetsWithinLookahead();
+}
+
+// Lockstep: waits for the next sync_request and schedules a SyncGate at its target.
+// Targets that already passed are acked right away. Returns false once the session
+// is over (shutdown or simTime reached).
+bool ScheduleSyncGate() {
+  while (running && Simulator::Now() < Seconds(simTime)) {
+    // With lookahead a target may already be queued, so apply whatever CARLA sent
+    // while the last interval was simulated before deciding.
+    DrainCommands();
+    if (!WaitForSyncRequest()) {
+      return false;
+    }
+    double requestedCarlaTime = pendingSyncTime.load();
+    if (syncLookahead > 0) {
+      AckSyncTargetsWithinLookahead();
+      std::lock_guard<std::mutex> lock(syncMutex);
+      if (syncTargets.empty()) {
+        continue;  // dropped by a disconnect
+      }
+      requestedCarlaTime = syncTargets.front();
+    }
+    const Time currentTime = Simulator::Now();
+    const Time cappedTarget = std::min(Seconds(requestedCarlaTime), Seconds(simTime));
+    if (cappedTarget <= currentTime) {
+      std::cout << "[INFO] Target time already passed, sending immediate sync_ack"
+                << " (NS3 time: " << currentTime.GetSeconds() << "s, CARLA target: "
+                << requestedCarlaTime << "s)\n";
+      CompleteSyncTarget(requestedCarlaTime);
+      continue;
+    }
+    Simulator::Schedule(cappedTarget - currentTime, &SyncGate, requestedCarlaTime);
+    return true;
+  }
+  return false;
+}
+
+// Lockstep gate event: the sync target was reached inside Run(), so ack it and
+// block right here until CARLA asks for the next one.
+void SyncGate(double carlaTime) {
+  CompleteSyncTarget(carlaTime);
+  if (!ScheduleSyncGate()) {
+    Simulator::Stop();
+  }
+}
+
 void HandleSigInt(int signum) {
     std::cout << "\n[INFO] Received SIGINT (Ctrl+C), exiting gracefully...\n";
     syncCv.notify_one();  // Wake up main thread if waiting
     Simulator::Stop();
     running = false;
-    SocketSenderServerDisconnect();
 }
 
 int main(int argc, char *argv[]) {
@@ -581,49 +1215,126 @@ int main(int argc, char *argv[]) {
   CommandLine cmd;
   cmd.AddValue("simTime", "Simulation time (s)", simTime);
   cmd.AddValue("camInterval", "CAM interval (s)", camInterval);
+  cmd.AddValue("autoCam", "Generate CAMs autonomously by the ETSI triggers instead of only on "
+               "transfer requests (default: false)", autoCam);
+  cmd.AddValue("camSize", "autoCam: CAM payload size (bytes) (default: 200)", camSize);
+  cmd.AddValue("camJitter", "autoCam: maximum random delay added to each check interval (s) "
+               "(default: 0.01)", camJitter);
   cmd.AddValue("enableTimeSync", "Enable time synchronization with CARLA (default: true)", enableTimeSyncFlag);
   cmd.AddValue("carlaHost", "CARLA callback host IP (default: auto-detect from the 5556 peer)", carlaHost);
+  cmd.AddValue("lockstep", "With enableTimeSync, advance to each CARLA target as fast as possible "
+               "instead of in real time (default: false)", lockstep);
+  cmd.AddValue("syncLookahead", "With lockstep, ack a sync_request up to this many ticks before its "
+               "target is simulated; cam_received reports then arrive that many ticks late (default: 0)",
+               syncLookahead);
+  cmd.AddValue("transport", "Link to the CARLA bridge: tcp (ports 5556/5557) or shm (shared memory, "
+               "same host only) (default: tcp)", transport);
+  cmd.AddValue("shmName", "Name of the shared-memory segment with transport=shm (default: /carla_ns3)",
+               shmName);
+  cmd.AddValue("lazySlBearers", "NR: activate the sidelink bearer of a (source, target) pair on its "
+               "first transfer request instead of all pairs at init (default: true)", lazySlBearers);
+  cmd.AddValue("slBearerIdleTimeout", "NR with lazySlBearers: release a pair's bearer after this "
+               "long without traffic (s) (default: 5)", slBearerIdleTimeout);
+  cmd.AddValue("slOnlyIp", "NR: assign UE addresses without creating the EPC core network, "
+               "which sidelink traffic never crosses (default: true)", slOnlyIp);
+  cmd.AddValue("compactHeaders", "Encode CAM and GeoNetworking headers in ETSI-like fixed point "
+               "(0.1 m, 0.01 m/s, 0.1 deg, 16-bit delta time) instead of doubles (default: false)",
+               compactHeaders);
+  cmd.AddValue("transferFragmentSize", "Split transfers larger than this (bytes) into several CAMs; "
+               "the receiver reports one cam_received per transfer (default: 65000)",
+               transferFragmentSize);
+  cmd.AddValue("linkKpi", "Aggregate delivery ratio, latency and throughput per link and distance "
+               "bin in ns-3 and publish them as link_kpi summaries (default: false)", linkKpi);
+  cmd.AddValue("camReports", "Send a cam_received to CARLA for every received transfer; turn off "
+               "with linkKpi to keep only the summaries (default: true)", camReports);
+  cmd.AddValue("kpiInterval", "linkKpi: sync ticks per summary, 0 for kpi_request only (default: 1)",
+               kpiInterval);
+  cmd.AddValue("kpiBinWidth", "linkKpi: width of the distance bins (m) (default: 50)", kpiBinWidth);
+  cmd.AddValue("kpiMaxDistance", "linkKpi: sender-receiver pairs further apart are not counted (m) "
+               "(default: 1000)", kpiMaxDistance);
+  cmd.AddValue("kpiWindow", "linkKpi: sliding window of the throughput figures (s) (default: 1)",
+               kpiWindow);
   cmd.Parse(argc, argv);
   enableTimeSync = enableTimeSyncFlag;
+  CamHeader::SetCompactEncoding(compactHeaders);
+  GeoNetHeader::SetCompactEncoding(compactHeaders);
+  if (linkKpi && (kpiBinWidth <= 0 || kpiMaxDistance <= 0 || kpiWindow <= 0)) {
+    std::cerr << "[WARN] kpiBinWidth, kpiMaxDistance and kpiWindow must be positive; using defaults\n";
+    kpiBinWidth = 50.0;
+    kpiMaxDistance = 1000.0;
+    kpiWindow = 1.0;
+  }
+  if (!camReports && !linkKpi) {
+    std::cerr << "[WARN] camReports=false without linkKpi: receptions are not reported at all\n";
+  }
+  if (linkKpi) {
+    kpi = std::make_unique<LinkKpi>(kpiBinWidth, kpiMaxDistance, Seconds(kpiWindow));
+    kpi->SetAudienceFilter([](uint32_t sender, uint64_t sendTimeMs, uint32_t receiver, double distance) {
+      return groupAudience.Accepts(sender, sendTimeMs, receiver, distance);
+    });
+  }
+
+  if (lockstep && !enableTimeSync) {
+    std::cerr << "[WARN] lockstep needs enableTimeSync; running in real time\n";
+    lockstep = false;
+  }
+  if (syncLookahead > 0 && !lockstep) {
+    std::cerr << "[WARN] syncLookahead needs lockstep; disabled\n";
+    syncLookahead = 0;
+  }
+  if (!lockstep) {
+    Simulator::SetImplementation(CreateObject<RealtimeSimulatorImpl>());
+  }
+  if (transport == "shm") {
+    carlaShm = std::make_unique<CarlaShmTransport>();
+    carlaShm->SetCommandHandler(&ProcessShmCommand);
+    carlaShm->SetVehicleTableHandler(&ProcessShmVehicles);
+    if (!carlaShm->Create(shmName) || !carlaShm->Start()) {
+      std::cerr << "[ERR] Failed to start the shared-memory transport\n";
+      return 1;
+    }
+  } else {
+    if (transport != "tcp") {
+      std::cerr << "[WARN] Unknown transport '" << transport << "', using tcp\n";
+    }
+    carlaBridge = std::make_unique<CarlaBridgeIo>(5556, 5557, carlaHost);
+    carlaBridge->SetFrameHandler(&ProcessReceivedData);
+    carlaBridge->SetDisconnectHandler(&HandleCarlaDisconnected);
+    if (!carlaBridge->Start()) {
+      std::cerr << "[ERR] Failed to start the Carla bridge\n";
+      return 1;
+    }
+  }
 
-  Simulator::SetImplementation(CreateObject<RealtimeSimulatorImpl>());
-  std::thread serverReceiverThread(SocketReceiverServerThread);
-  
   std::cout << "[INFO] Waiting for first Carla data...\n";
-  while (!firstDataReceived) {
+  while (!firstDataReceived && running) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
-  SocketSenderServerConnect();
 
   std::cout << "[INFO] Starting simulation!\n";
-  std::cout << "[INFO] Time sync " << (enableTimeSync ? "ENABLED" : "DISABLED") << "\n";
+  std::cout << "[INFO] Time sync " << (enableTimeSync ? "ENABLED" : "DISABLED")
+            << (lockstep ? " (lockstep, not paced to wall clock)" : "") << "\n";
 
   if (enableTimeSync) {
     // Event-driven synchronized simulation
     // CARLA controls when NS3 advances by sending sync_requests
     std::cout << "[INFO] Starting synchronized simulation mode\n";
-    Simulator::Schedule(Seconds(0.1), &UpdateVehiclePositions);
-
-    while (running && Simulator::Now().GetSeconds() < simTime) {
-      std::unique_lock<std::mutex> lock(syncMutex);
-      auto now = std::chrono::system_clock::now();
-      auto deadline = now + std::chrono::seconds(10);
-      while (!syncPending && running) {
-        if (syncCv.wait_until(lock, deadline) == std::cv_status::timeout) {
-          if (hasCompletedAnySyncAck) {
-            std::cerr << "[WARN] Waiting for sync timeout at NS3 time "
-                      << Simulator::Now().GetSeconds() << "s\n";
-          }
-          deadline = std::chrono::system_clock::now() + std::chrono::seconds(10);
-        }
+
+    if (lockstep) {
+      // Run() is entered once; SyncGate events block inside it between ticks.
+      if (ScheduleSyncGate()) {
+        Simulator::Run();
       }
-      if (!running) {
+    }
+
+    // Real time: RealtimeSimulatorImpl re-anchors its wall clock on every Run(), so
+    // each tick keeps its own Stop()/Run() to stay paced.
+    while (!lockstep && running && Simulator::Now().GetSeconds() < simTime) {
+      if (!WaitForSyncRequest()) {
         break;
       }
 
       const double requestedCarlaTime = pendingSyncTime.load();
-      lock.unlock();
-
       const Time currentTime = Simulator::Now();
       const Time requestedTarget = Seconds(requestedCarlaTime);
       const Time cappedTarget = std::min(requestedTarget, Seconds(simTime));
@@ -651,19 +1362,31 @@ int main(int argc, char *argv[]) {
     std::cout << "[INFO] Sync simulation ended at NS3 time: " << Simulator::Now().GetSeconds() << "s\n";
   } else {
     // Original behavior: schedule events and run freely
-    Simulator::Schedule(Seconds(0.1), &UpdateVehiclePositions);
+    DrainCommands();
+    Simulator::Schedule(Seconds(kCommandDrainInterval), &DrainCommandsPeriodic);
     Simulator::Stop(Seconds(simTime));
     Simulator::Run();
   }
 
   running = false;
-  serverReceiverThread.join();
   SendSimulationEndSignal();
   SocketSenderServerDisconnect();
   Simulator::Destroy();
   return 0;
 }
 
+// Resident memory of this process (MB) from /proc, for the initialization logs; 0 if unknown.
+double ResidentMemoryMb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      return std::stod(line.substr(6)) / 1024.0;
+    }
+  }
+  return 0.0;
+}
+
 
 void InitializeVehicles_DSRC(uint32_t n_vehicles = 3){
   if(nVehicles >= n_vehicles) return;
@@ -672,9 +1395,7 @@ void InitializeVehicles_DSRC(uint32_t n_vehicles = 3){
   nVehicles = n_vehicles;
   vehicles = NodeContainer();
   vehicles.Create(n_vehicles);
-  senders.clear();
-  receivers.clear();
-  vehicleIps.clear();
+  registry.Resize(n_vehicles);
 
   std::cout << "[INFO] Installing Wifi\n";
   WifiHelper wifi;
@@ -718,47 +1439,44 @@ void InitializeVehicles_DSRC(uint32_t n_vehicles = 3){
   }
 
   mobility.SetPositionAllocator(positionAlloc);
-  mobility.SetMobilityModel("ns3::ConstantVelocityMobilityModel");
+  mobility.SetMobilityModel("ns3::CarlaMobilityModel");
   mobility.Install(vehicles);
 
-  for (uint32_t i = 0; i < vehicles.GetN(); i++) {
-    Ptr<ConstantVelocityMobilityModel> mob =
-        vehicles.Get(i)->GetObject<ConstantVelocityMobilityModel>();
-    mob->SetVelocity(Vector(0, 0, 0));
-  }
-
   std::cout << "[INFO] Installing Cam applications\n";
   for (uint32_t i = 0; i < vehicles.GetN(); i++) {
     Ptr<Ipv4> ipv4 = vehicles.Get(i)->GetObject<Ipv4>();
     Ipv4Address addr = ipv4->GetAddress(1, 0).GetLocal();
-    vehicleIps.push_back(addr);
 
     Ptr<CamSenderDSRC> sender = CreateObject<CamSenderDSRC>();
     sender->SetVehicleId(i + 1);
     sender->SetIp(addr);
     sender->SetInterval(Seconds(camInterval));
+    sender->SetMaxFragmentSize(transferFragmentSize);
+    sender->SetKpi(kpi.get());
     sender->SetBroadcastRadius(1000);
+    sender->SetBroadcastAddress(Ipv4Address::GetBroadcast(), 5000);
     vehicles.Get(i)->AddApplication(sender);
-    sender->SetStartTime(appStartTime);
-    sender->SetStopTime(Seconds(simTime));
-    if (appStartTime <= Simulator::Now()) {
-      sender->StartApplication();
+    // Start and stop times count from the application's Initialize(), which runs now
+    // (or at Run() for the initial fleet).
+    sender->SetStartTime(Seconds(0));
+    sender->SetStopTime(Seconds(simTime) - appStartTime);
+    if (autoCam) {
+      sender->EnableAutoCam(&camWheel, camSize, Seconds(camJitter), appStartTime);
     }
-    senders.push_back(sender);
 
     Ptr<CamReceiverDSRC> receiver = CreateObject<CamReceiverDSRC>();
     receiver->SetVehicleId(i + 1);
     receiver->SetIp(addr);
     vehicles.Get(i)->AddApplication(receiver);
-    receiver->SetStartTime(appStartTime);
-    receiver->SetStopTime(Seconds(simTime));
-    receiver->SetReplyFunction([](const std::string& msg) {
-      return SendMsgToCarla(msg);
-    });
-    if (appStartTime <= Simulator::Now()) {
-      receiver->StartApplication();
+    receiver->SetStartTime(Seconds(0));
+    receiver->SetStopTime(Seconds(simTime) - appStartTime);
+    if (camReports) {
+      receiver->SetReplyFunction(&ReportReception);
+    }
+    if (kpi) {
+      receiver->SetKpi(kpi.get());
     }
-    receivers.push_back(receiver);
+    registry.SetVehicle(i, vehicles.Get(i), addr, sender, receiver);
   }
 
   for (uint32_t i = 0; i < vehicles.GetN(); ++i)
@@ -785,47 +1503,35 @@ void PrintRoutingTable (Ptr<Node> node)
     }
 }
 
-void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
-{
-    if(nVehicles >= n_vehicles) return;
-
-    const Time now = Simulator::Now();
-    const Time appStartTime = now;
-    const Time bearerActivationTime = std::max(finalSlBearersActivationTime, now);
-
-    nVehicles = n_vehicles;
-    vehicles = NodeContainer();
-    vehicles.Create(n_vehicles);
-    senders.clear();
-    receivers.clear();
-    vehicleIps.clear();
-    vehicleL2Ids = std::vector<uint32_t>(n_vehicles, 0);
-
-    /*
-     * Assign mobility to the UEs.
-     *  1. Set mobility model type.
-     *  2. Assign position to the UEss
-     *  3. Install mobility model
-     */
-    std::cout << "[INFO] Installing MobilityModel\n";
-    MobilityHelper mobility;
-    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator>();
-    for (uint32_t i = 0; i < vehicles.GetN(); i++) {
-        positionAlloc->Add(Vector(0, 0, 0)); // 初始位置
-    }
-    mobility.SetPositionAllocator(positionAlloc);
-    mobility.SetMobilityModel("ns3::ConstantVelocityMobilityModel");
-    mobility.Install(vehicles);
+// All sidelink bearers of one UE, activated together.
+struct NrSlBearerBatch {
+    Ptr<NrUeNetDevice> ue;
+    std::vector<Ptr<LteSlTft>> tfts;
+};
 
-    for (uint32_t i = 0; i < vehicles.GetN(); i++) {
-        vehicles.Get(i)->GetObject<ConstantVelocityMobilityModel>()->SetVelocity(Vector(0, 0, 0));
+// Activates a whole batch in one event instead of one NrSlHelper event per bearer,
+// going straight to each UE's NAS as NrSlHelper does.
+void ActivateNrSlBearers(const std::vector<NrSlBearerBatch>& batches)
+{
+    const auto start = std::chrono::steady_clock::now();
+    size_t activated = 0;
+    for (const NrSlBearerBatch& batch : batches)
+    {
+        Ptr<EpcUeNas> nas = batch.ue->GetNas();
+        for (const Ptr<LteSlTft>& tft : batch.tfts)
+        {
+            nas->ActivateNrSlBearer(tft);
+        }
+        activated += batch.tfts.size();
     }
-    
-    // 提前安装网络栈，确保TrafficControlLayer在NR设备安装前正确初始化
-    std::cout << "[INFO] Installing Internet Stack\n";
-    InternetStackHelper internet;
-    internet.Install(vehicles);
+    const double elapsedMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[INFO] Activated " << activated << " sidelink bearer(s) on " << batches.size()
+              << " UE(s) in " << elapsedMs << " ms\n";
+}
 
+void SetupNrSlStack(NrSlStack& stack)
+{
     // NR parameters. We will take the input from the command line, and then we
     // will pass them inside the NR module.
     uint16_t numerologyBwpSl = 1;
@@ -840,15 +1546,26 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
     /*
      * Setup the NR module. We create the various helpers needed for the
      * NR simulation:
-     * - EpcHelper, which will setup the core network
+     * - EpcHelper, which will setup the core network (only without slOnlyIp)
      * - NrHelper, which takes care of creating and connecting the various
      * part of the NR stack
      */
-    Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper>();
+    Ptr<NrPointToPointEpcHelper> epcHelper;
     Ptr<NrHelper> nrHelper = CreateObject<NrHelper>();
-
-    // Put the pointers inside nrHelper
-    nrHelper->SetEpcHelper(epcHelper);
+    if (!slOnlyIp)
+    {
+        epcHelper = CreateObject<NrPointToPointEpcHelper>();
+        // Put the pointers inside nrHelper
+        nrHelper->SetEpcHelper(epcHelper);
+    }
+    else
+    {
+        // The address plan of the EPC: 7.0.0.1 would be the PGW, UEs from 7.0.0.2
+        stack.ueAddress.SetBase("7.0.0.0", "255.0.0.0", "0.0.0.2");
+        stack.ueGateway = Ipv4Address("7.0.0.1");
+    }
+    stack.epcHelper = epcHelper;
+    stack.nrHelper = nrHelper;
 
     /*
      * Spectrum division. We create one operational band, containing
@@ -856,7 +1573,7 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
      * centered at the frequency specified by the input parameters.
      * We will use the StreetCanyon channel modeling.
      */
-    BandwidthPartInfoPtrVector allBwps;
+    BandwidthPartInfoPtrVector& allBwps = stack.allBwps;
     CcBwpCreator ccBwpCreator;
     const uint8_t numCcPerBand = 1;
 
@@ -869,7 +1586,9 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
                                                      BandwidthPartInfo::V2V_Highway);
 
     // By using the configuration created, it is time to make the operation bands
-    OperationBandInfo bandSl = ccBwpCreator.CreateOperationBandContiguousCc(bandConfSl);
+    // Kept in the stack: allBwps refers into it for every later InstallUeDevice().
+    OperationBandInfo& bandSl = stack.bandSl;
+    bandSl = ccBwpCreator.CreateOperationBandContiguousCc(bandConfSl);
 
     /*
      * The configured spectrum division is:
@@ -925,7 +1644,10 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
      *  Case (i): Attributes valid for all the nodes
      */
     // Core latency
-    epcHelper->SetAttribute("S1uLinkDelay", TimeValue(MilliSeconds(0)));
+    if (epcHelper)
+    {
+        epcHelper->SetAttribute("S1uLinkDelay", TimeValue(MilliSeconds(0)));
+    }
 
     /*
      * Antennas for all the UEs
@@ -962,7 +1684,7 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
     nrHelper->SetUeBwpManagerAlgorithmAttribute("GBR_MC_PUSH_TO_TALK",
                                                 UintegerValue(bwpIdForGbrMcptt));
 
-    std::set<uint8_t> bwpIdContainer;
+    std::set<uint8_t>& bwpIdContainer = stack.bwpIdContainer;
     bwpIdContainer.insert(bwpIdForGbrMcptt);
 
     /*
@@ -977,23 +1699,6 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
 
     // NOT PRESENT IN THIS SIMPLE EXAMPLE
 
-    /*
-     * We have configured the attributes we needed. Now, install and get the pointers
-     * to the NetDevices, which contains all the NR stack:
-     */
-    NetDeviceContainer ueVoiceNetDev = nrHelper->InstallUeDevice(vehicles, allBwps);
-
-    /*
-     * Case (iii): Go node for node and change the attributes we have to setup
-     * per-node.
-     */
-
-    // When all the configuration is done, explicitly call UpdateConfig ()
-    for (auto it = ueVoiceNetDev.Begin(); it != ueVoiceNetDev.End(); ++it)
-    {
-        DynamicCast<NrUeNetDevice>(*it)->UpdateConfig();
-    }
-
     /*
      * Configure Sidelink. We create the following helpers needed for the
      * NR Sidelink, i.e., V2X simulation:
@@ -1003,10 +1708,16 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
      *   to establish the NR Sidelink bearer (s). We note that, at this stage
      *   just communicate the pointer of already instantiated EpcHelper object,
      *   which is the same pointer communicated to the NrHelper above.
+     *   ActivateNrSlBearers() and SlBearerCache talk to EpcUeNas directly, so
+     *   without the EPC there is nothing to communicate.
      */
     Ptr<NrSlHelper> nrSlHelper = CreateObject<NrSlHelper>();
+    stack.nrSlHelper = nrSlHelper;
     // Put the pointers inside NrSlHelper
-    nrSlHelper->SetEpcHelper(epcHelper);
+    if (epcHelper)
+    {
+        nrSlHelper->SetEpcHelper(epcHelper);
+    }
 
     /*
      * Set the SL error model and AMC
@@ -1029,14 +1740,6 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
     // nrSlHelper->SetUeSlSchedulerAttribute("Mcs", UintegerValue(14));
     nrSlHelper->SetUeSlSchedulerAttribute("Mcs", UintegerValue(20));
 
-    /*
-     * Very important method to configure UE protocol stack, i.e., it would
-     * configure all the SAPs among the layers, setup callbacks, configure
-     * error model, configure AMC, and configure ChunkProcessor in Interference
-     * API.
-     */
-    nrSlHelper->PrepareUeForSidelink(ueVoiceNetDev, bwpIdContainer);
-
     /*
      * Start preparing for all the sub Structs/RRC Information Element (IEs)
      * of LteRrcSap::SidelinkPreconfigNr. This is the main structure, which would
@@ -1143,27 +1846,90 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
      * Finally, configure the SidelinkPreconfigNr This is the main structure
      * that needs to be communicated to NrSlUeRrc class
      */
-    LteRrcSap::SidelinkPreconfigNr slPreConfigNr;
+    LteRrcSap::SidelinkPreconfigNr& slPreConfigNr = stack.slPreConfigNr;
     slPreConfigNr.slPreconfigGeneral = slPreconfigGeneralNr;
     slPreConfigNr.slUeSelectedPreConfig = slUeSelectedPreConfig;
     slPreConfigNr.slPreconfigFreqInfoList[0] = slFreConfigCommonNr;
 
-    // Communicate the above pre-configuration to the NrSlHelper
-    nrSlHelper->InstallNrSlPreConfiguration(ueVoiceNetDev, slPreConfigNr);
-
     Config::SetDefault("ns3::LteRlcUm::MaxTxBufferSize", UintegerValue(100 * 1024 * 1024));
 
-    /****************************** End SL Configuration ***********************/
+    NazonoNrSlHelper = nrSlHelper;
+}
+
+void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
+{
+    if(nVehicles >= n_vehicles) return;
+
+    const auto initStart = std::chrono::steady_clock::now();
+    if (!nrSlStack) {
+        nrSlStack = std::make_unique<NrSlStack>();
+        SetupNrSlStack(*nrSlStack);
+    }
+    NrSlStack& stack = *nrSlStack;
+
+    const Time now = Simulator::Now();
+    const Time appStartTime = now;
+    const Time bearerActivationTime = std::max(finalSlBearersActivationTime, now);
+    slBearersReadyTime = bearerActivationTime;
+
+    // Only the new UEs [first, n_vehicles) are built; existing nodes, devices and
+    // applications stay untouched.
+    const uint32_t first = vehicles.GetN();
+    nVehicles = n_vehicles;
+    NodeContainer newUes;
+    newUes.Create(n_vehicles - first);
+    vehicles.Add(newUes);
+    registry.Resize(n_vehicles);
+
+    /*
+     * Assign mobility to the UEs.
+     *  1. Set mobility model type.
+     *  2. Assign position to the UEss
+     *  3. Install mobility model
+     */
+    std::cout << "[INFO] Installing MobilityModel\n";
+    MobilityHelper mobility;
+    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator>();
+    for (uint32_t i = 0; i < newUes.GetN(); i++) {
+        positionAlloc->Add(Vector(0, 0, 0)); // 初始位置
+    }
+    mobility.SetPositionAllocator(positionAlloc);
+    mobility.SetMobilityModel("ns3::CarlaMobilityModel");
+    mobility.Install(newUes);
+    
+    // 提前安装网络栈，确保TrafficControlLayer在NR设备安装前正确初始化
+    std::cout << "[INFO] Installing Internet Stack\n";
+    InternetStackHelper internet;
+    internet.Install(newUes);
+
+    /*
+     * Install the NR stack of the new UEs on the existing band/channel.
+     */
+    NetDeviceContainer ueVoiceNetDev = stack.nrHelper->InstallUeDevice(newUes, stack.allBwps);
+
+    // When all the configuration is done, explicitly call UpdateConfig ()
+    for (auto it = ueVoiceNetDev.Begin(); it != ueVoiceNetDev.End(); ++it)
+    {
+        DynamicCast<NrUeNetDevice>(*it)->UpdateConfig();
+    }
+
+    /*
+     * Very important method to configure UE protocol stack, i.e., it would
+     * configure all the SAPs among the layers, setup callbacks, configure
+     * error model, configure AMC, and configure ChunkProcessor in Interference
+     * API.
+     */
+    stack.nrSlHelper->PrepareUeForSidelink(ueVoiceNetDev, stack.bwpIdContainer);
+    stack.nrSlHelper->InstallNrSlPreConfiguration(ueVoiceNetDev, stack.slPreConfigNr);
 
     /*
      * Fix the random streams
      */
-    int64_t stream = 1;
-    stream += nrHelper->AssignStreams(ueVoiceNetDev, stream);
-    stream += nrSlHelper->AssignStreams(ueVoiceNetDev, stream);
+    stack.stream += stack.nrHelper->AssignStreams(ueVoiceNetDev, stack.stream);
+    stack.stream += stack.nrSlHelper->AssignStreams(ueVoiceNetDev, stack.stream);
     
     // 网络栈已提前安装，这里只需要分配流
-    stream += internet.AssignStreams(vehicles, stream);
+    stack.stream += internet.AssignStreams(newUes, stack.stream);
     
     /* 
      * Configure the IP stack, and activate NR Sidelink bearer (s) as per the
@@ -1171,23 +1937,26 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
      *
      * This example supports IPV4 and IPV6
      */
-    // Ipv4Address groupAddress4("225.0.0.0"); // use multicast address as destination
-
-    Ipv4InterfaceContainer ueIpIface;
-    ueIpIface = epcHelper->AssignUeIpv4Address(ueVoiceNetDev);
-
-    // set the default gateway for the UE
+    Ipv4InterfaceContainer newIpIface = stack.epcHelper
+        ? stack.epcHelper->AssignUeIpv4Address(ueVoiceNetDev)
+        : stack.ueAddress.Assign(ueVoiceNetDev);
+    const Ipv4Address ueGateway =
+        stack.epcHelper ? stack.epcHelper->GetUeDefaultGatewayAddress() : stack.ueGateway;
+
+    // set the default gateway for the UE; without the EPC nothing answers on it,
+    // the route only sends groupcast destinations out of the NR device
     Ipv4StaticRoutingHelper ipv4RoutingHelper;
-    for (uint32_t u = 0; u < vehicles.GetN(); ++u)
+    for (uint32_t u = 0; u < newUes.GetN(); ++u)
     {
-        Ptr<Node> ueNode = vehicles.Get(u);
+        Ptr<Node> ueNode = newUes.Get(u);
         // Set the default gateway for the UE
         Ptr<Ipv4StaticRouting> ueStaticRouting =
             ipv4RoutingHelper.GetStaticRouting(ueNode->GetObject<Ipv4>());
-        ueStaticRouting->SetDefaultRoute(epcHelper->GetUeDefaultGatewayAddress(), 1);
+        ueStaticRouting->SetDefaultRoute(ueGateway, 1);
     }
+    stack.ueDevices.Add(ueVoiceNetDev);
+    stack.ueIpIface.Add(newIpIface);
 
-    Ipv4Address groupAddress4("225.0.0.0"); // use multicast address as destination
     SidelinkInfo slInfo;
     slInfo.m_castType = SidelinkInfo::CastType::Unicast;
     slInfo.m_dstL2Id = 255;
@@ -1197,79 +1966,116 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
     slInfo.m_harqEnabled = false;
     slInfo.m_dynamic = true;
 
-    for(uint32_t i = 0; i < ueIpIface.GetN(); ++i)
+    slBearers.SetSidelinkInfo(slInfo);
+    slBearers.SetIdleTimeout(Seconds(slBearerIdleTimeout));
+
+    for(uint32_t i = first; i < n_vehicles; ++i)
+    {
+      Ptr<NrUeNetDevice> ueDev = DynamicCast<NrUeNetDevice>(stack.ueDevices.Get(i));
+      uint32_t dstL2Id = ueDev->GetMac(0)->GetObject<NrSlUeMac>()->GetSrcL2Id();
+      registry.SetL2Id(i, dstL2Id);
+      slBearers.SetDevice(i, ueDev);
+    }
+    // Receive bearers for the new UEs. Without lazySlBearers also the transmit
+    // bearers for every pair with at least one new end (existing pairs already have theirs).
+    // Collected per UE and activated by a single event.
+    // Every new UE also joins the sidelink group, for both directions.
+    std::vector<NrSlBearerBatch> bearerBatches(n_vehicles);
+    for(uint32_t j = 0; j < n_vehicles; ++j)
+    {
+      bearerBatches[j].ue = DynamicCast<NrUeNetDevice>(stack.ueDevices.Get(j));
+      if (!lazySlBearers)
+      {
+        bearerBatches[j].tfts.reserve(j >= first ? n_vehicles + 1 : n_vehicles - first + 1);
+      }
+    }
+    for(uint32_t i = 0; i < n_vehicles; ++i)
     {
-      NetDeviceContainer receiver;
-      receiver.Add(ueVoiceNetDev.Get(i));
-      Ipv4Address destIp = ueIpIface.GetAddress(i);
-      uint32_t dstL2Id = DynamicCast<NrUeNetDevice>(ueVoiceNetDev.Get(i))->GetMac(0)->GetObject<NrSlUeMac>()->GetSrcL2Id();
-      slInfo.m_dstL2Id = dstL2Id;
-      vehicleL2Ids[i] = dstL2Id;
-      Ptr<LteSlTft> tftUnicastReceiver = Create<LteSlTft>(
-        LteSlTft::Direction::RECEIVE,
-        destIp, 
-        slInfo
-      );
-      std::cout << "SLINFO.dstL2Id: " << slInfo.m_dstL2Id << std::endl;
-      nrSlHelper->ActivateNrSlBearer(bearerActivationTime, receiver, tftUnicastReceiver);
-      for (uint32_t j = 0; j < ueIpIface.GetN(); ++j)
+      Ipv4Address destIp = stack.ueIpIface.GetAddress(i);
+      slInfo.m_dstL2Id = registry.GetL2Id(i);
+      if (i >= first)
+      {
+        Ptr<LteSlTft> tftUnicastReceiver = Create<LteSlTft>(
+          LteSlTft::Direction::RECEIVE,
+          destIp, 
+          slInfo
+        );
+        std::cout << "SLINFO.dstL2Id: " << slInfo.m_dstL2Id << std::endl;
+        bearerBatches[i].tfts.push_back(tftUnicastReceiver);
+      }
+      for (uint32_t j = (i >= first ? 0 : first); j < n_vehicles && !lazySlBearers; ++j)
       {
         if (i == j)
           continue;
-        NetDeviceContainer sender;
-        sender.Add(ueVoiceNetDev.Get(j));
         Ptr<LteSlTft> tftUnicastSender = Create<LteSlTft>(
             LteSlTft::Direction::TRANSMIT,
             destIp, 
             slInfo
         );
-        nrSlHelper->ActivateNrSlBearer(bearerActivationTime, sender, tftUnicastSender);
-        // nrSlHelper->ActivateNrSlBearer(finalSlBearersActivationTime, ueVoiceNetDev, tftUnicast);
+        bearerBatches[j].tfts.push_back(tftUnicastSender);
       }
     }
+    SidelinkInfo groupInfo = slInfo;
+    groupInfo.m_castType = SidelinkInfo::CastType::Groupcast;
+    groupInfo.m_dstL2Id = kSlGroupL2Id;
+    for(uint32_t i = first; i < n_vehicles; ++i)
+    {
+        bearerBatches[i].tfts.push_back(Create<LteSlTft>(
+            LteSlTft::Direction::BIDIRECTIONAL, slGroupAddress, groupInfo));
+    }
+    // bearerActivationTime is absolute, Schedule() takes a delay.
+    Simulator::Schedule(bearerActivationTime - now, [batches = std::move(bearerBatches)] {
+        ActivateNrSlBearers(batches);
+    });
 
-    NazonoNrSlHelper = nrSlHelper;
     // // Install Application
     std::cout << "[INFO] Installing Application\n";    
-    for (uint32_t i = 0; i < vehicles.GetN(); i++) {
-        Ipv4Address ip = ueIpIface.GetAddress(i);
+    for (uint32_t i = first; i < n_vehicles; i++) {
+        Ipv4Address ip = stack.ueIpIface.GetAddress(i);
         std::cout << "[INFO] Vehicle " << i << " IP address: " << ip << "\n";
-        vehicleIps.push_back(ip);
 
         Ptr<CamSenderNR> sender = CreateObject<CamSenderNR>();
         sender->SetVehicleId(i+1);
         sender->SetInterval(Seconds(camInterval));
+        sender->SetMaxFragmentSize(transferFragmentSize);
+        sender->SetKpi(kpi.get());
         sender->SetIp(ip);
+        sender->SetGroup(slGroupAddress, kSlGroupPort, kSlGroupL2Id);
         vehicles.Get(i)->AddApplication(sender);
-        sender->SetStartTime(appStartTime);
-        sender->SetStopTime(Seconds(simTime));
-        if (appStartTime <= Simulator::Now()) {
-          sender->StartApplication();
+        // Start and stop times count from the application's Initialize(), which runs now
+        // (or at Run() for the initial fleet).
+        sender->SetStartTime(Seconds(0));
+        sender->SetStopTime(Seconds(simTime) - appStartTime);
+        if (autoCam) {
+          // Group bearers of the new UEs come up at slBearersReadyTime.
+          sender->EnableAutoCam(&camWheel, camSize, Seconds(camJitter), slBearersReadyTime);
         }
-        senders.push_back(sender);
 
         Ptr<CamReceiverNR> receiver = CreateObject<CamReceiverNR>();
         receiver->SetVehicleId(i+1);
         receiver->SetIp(ip);
+        receiver->SetGroupPort(kSlGroupPort);
+        receiver->SetGroupFilter([](uint32_t sender, uint64_t sendTimeMs, uint32_t self, double distance) {
+            return groupAudience.Accepts(sender, sendTimeMs, self, distance);
+        });
 
         vehicles.Get(i)->AddApplication(receiver);
-        receiver->SetStartTime(appStartTime);
-        receiver->SetStopTime(Seconds(simTime));
-        receiver->SetReplyFunction([i](const std::string& msg) {
-          // Simulator::Schedule(MilliSeconds(i), [msg] { SendMsgToCarla(msg); });
-          return SendMsgToCarla(msg);
-        });
-        if (appStartTime <= Simulator::Now()) {
-          receiver->StartApplication();
+        receiver->SetStartTime(Seconds(0));
+        receiver->SetStopTime(Seconds(simTime) - appStartTime);
+        if (camReports) {
+          receiver->SetReplyFunction(&ReportReception);
+        }
+        if (kpi) {
+          receiver->SetKpi(kpi.get());
         }
-        receivers.push_back(receiver);
+        registry.SetVehicle(i, vehicles.Get(i), ip, sender, receiver);
     }
 
     Ptr<Node> node = vehicles.Get(0);
     Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
 
     Ptr<Ipv4ListRouting> listRouting = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
-    if (listRouting)
+    if (listRouting && first == 0)
     {
         for (uint32_t j = 0; j < listRouting->GetNRoutingProtocols(); ++j)
         {
@@ -1285,5 +2091,9 @@ void InitializeVehicles_NR_V2X_Mode2(uint32_t n_vehicles = 3)
         }
     }
 
-    std::cout << "[INFO] NR-V2X Mode2 vehicles initialized: " << vehicles.GetN() << " UE nodes.\n";
+    const double initMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - initStart).count();
+    std::cout << "[INFO] NR-V2X Mode2 vehicles initialized: " << vehicles.GetN() << " UE nodes ("
+              << (n_vehicles - first) << " new) in " << initMs << " ms, resident memory "
+              << ResidentMemoryMb() << " MB.\n";
 }
@@ -0,0 +1,82 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace ns3 {
+
+// Unbounded lock-free multi-producer / single-consumer queue (intrusive Vyukov
+// design). Push() is wait-free and may be called from any thread; Pop() must only
+// be called from one consumer thread. A Pop() racing with a Push() that has not
+// linked its node yet returns false; the element shows up on a later Pop().
+template <typename T>
+class MpscQueue {
+public:
+  MpscQueue() : m_head(&m_stub), m_tail(&m_stub) {}
+
+  ~MpscQueue() {
+    T discarded;
+    while (Pop(discarded)) {
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  void Push(T value) {
+    Node* node = new Node(std::move(value));
+    Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  bool Pop(T& out) {
+    Node* tail = m_tail;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &m_stub) {
+      if (next == nullptr) {
+        return false;
+      }
+      m_tail = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      m_tail = next;
+      out = std::move(tail->value);
+      delete tail;
+      return true;
+    }
+    if (tail != m_head.load(std::memory_order_acquire)) {
+      return false;  // a producer is between exchange() and linking its node
+    }
+    // tail is the last node: re-insert the stub so it can be released.
+    m_stub.next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = m_head.exchange(&m_stub, std::memory_order_acq_rel);
+    prev->next.store(&m_stub, std::memory_order_release);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return false;
+    }
+    m_tail = next;
+    out = std::move(tail->value);
+    delete tail;
+    return true;
+  }
+
+private:
+  struct Node {
+    Node() = default;
+    explicit Node(T v) : value(std::move(v)) {}
+    std::atomic<Node*> next{nullptr};
+    T value{};
+  };
+
+  Node m_stub;
+  std::atomic<Node*> m_head;  // producers
+  Node* m_tail;               // consumer
+};
+
+} // namespace ns3
+
+#endif
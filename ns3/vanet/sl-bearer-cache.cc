@@ -0,0 +1,58 @@
+#include "sl-bearer-cache.h"
+
+#include "ns3/simulator.h"
+
+#include <iostream>
+
+namespace ns3 {
+
+void SlBearerCache::SetDevice(uint32_t slot, Ptr<NrUeNetDevice> device) {
+  if (slot >= m_devices.size()) {
+    m_devices.resize(slot + 1);
+  }
+  m_devices[slot] = device;
+}
+
+bool SlBearerCache::Ensure(uint32_t src, uint32_t dst, Ipv4Address dstIp, uint32_t dstL2Id) {
+  const Time now = Simulator::Now();
+  auto [it, inserted] = m_bearers.try_emplace(Key(src, dst));
+  it->second.lastUse = now;
+  if (!inserted) {
+    return false;
+  }
+
+  SidelinkInfo slInfo = m_slInfo;
+  slInfo.m_dstL2Id = dstL2Id;
+  it->second.tft = Create<LteSlTft>(LteSlTft::Direction::TRANSMIT, dstIp, slInfo);
+  m_devices[src]->GetNas()->ActivateNrSlBearer(it->second.tft);
+
+  if (!m_sweepEvent.IsPending()) {
+    m_sweepEvent = Simulator::Schedule(m_idleTimeout, &SlBearerCache::Sweep, this);
+  }
+  return true;
+}
+
+void SlBearerCache::Sweep() {
+  const Time now = Simulator::Now();
+  size_t released = 0;
+  for (auto it = m_bearers.begin(); it != m_bearers.end();) {
+    if (now - it->second.lastUse >= m_idleTimeout) {
+      const uint32_t src = static_cast<uint32_t>(it->first >> 32);
+      m_devices[src]->GetNas()->DeleteNrSlBearer(it->second.tft);
+      it = m_bearers.erase(it);
+      ++released;
+    } else {
+      ++it;
+    }
+  }
+  if (released > 0) {
+    std::cout << "[INFO] Released " << released << " idle sidelink bearer(s), "
+              << m_bearers.size() << " active\n";
+  }
+  if (!m_bearers.empty()) {
+    // Half the timeout: an idle bearer lives at most 1.5x IdleTimeout.
+    m_sweepEvent = Simulator::Schedule(m_idleTimeout / 2, &SlBearerCache::Sweep, this);
+  }
+}
+
+} // namespace ns3
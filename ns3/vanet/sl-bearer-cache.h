@@ -0,0 +1,61 @@
+#ifndef SL_BEARER_CACHE_H
+#define SL_BEARER_CACHE_H
+
+#include "ns3/epc-ue-nas.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/lte-sl-tft.h"
+#include "ns3/nr-ue-net-device.h"
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Unicast sidelink TX bearers created on demand, one per (source slot, target slot)
+ * pair, instead of all N*(N-1) of them at initialization.
+ *
+ * Ensure() activates a missing bearer through the source UE's NAS right away: out of
+ * coverage, RRC sets up the SL-DRB and MAC LC synchronously, so a packet sent in the
+ * same event already finds an active bearer instead of being discarded as pending.
+ * Bearers unused for IdleTimeout are deleted again by a periodic sweep.
+ *
+ * Simulator thread only.
+ */
+class SlBearerCache {
+public:
+  // Cast type, RRI, PDB, ... of the bearers; m_dstL2Id is set per pair.
+  void SetSidelinkInfo(const SidelinkInfo& slInfo) { m_slInfo = slInfo; }
+  void SetIdleTimeout(Time timeout) { m_idleTimeout = timeout; }
+  void SetDevice(uint32_t slot, Ptr<NrUeNetDevice> device);
+
+  // Makes sure src has an active TX bearer to dst and marks it used. Returns true if
+  // it had to be activated.
+  bool Ensure(uint32_t src, uint32_t dst, Ipv4Address dstIp, uint32_t dstL2Id);
+
+  size_t GetN() const { return m_bearers.size(); }
+
+private:
+  struct Entry {
+    Ptr<LteSlTft> tft;
+    Time lastUse;
+  };
+
+  static uint64_t Key(uint32_t src, uint32_t dst) {
+    return (static_cast<uint64_t>(src) << 32) | dst;
+  }
+  void Sweep();
+
+  SidelinkInfo m_slInfo;
+  Time m_idleTimeout{Seconds(5)};
+  std::vector<Ptr<NrUeNetDevice>> m_devices;  // indexed by slot
+  std::unordered_map<uint64_t, Entry> m_bearers;
+  EventId m_sweepEvent;
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,100 @@
+// Stand-in for the ns-3 side of the CARLA bridge, for transport measurements without a
+// network simulation: it serves --transport=tcp (ports 5556/5557, CarlaBridgeIo) or
+// --transport=shm (CarlaShmTransport), decodes every message like main.cc does and
+// answers each tick_bundle or sync_request with a tick_result at once. Driven by
+// src/bridge/transport_bench.py.
+
+#include "carla-bridge-io.h"
+#include "carla-json-decoder.h"
+#include "carla-shm-transport.h"
+
+#include "ns3/core-module.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace ns3;
+
+namespace {
+
+std::atomic<bool> g_running{true};
+std::function<void(std::string)> g_send;
+CarlaJsonDecoder g_decoder;
+std::vector<VehicleSample> g_vehicles;
+std::vector<TransferRequest> g_requests;
+uint64_t g_vehicleUpdates = 0;
+
+void HandleMessage(std::string_view msg) {
+  CarlaJsonDecoder::Result decoded;
+  if (g_decoder.Decode(msg, decoded, g_vehicles, g_requests) != CarlaJsonDecoder::Status::OK) {
+    std::cerr << "[WARN] Message outside the fast decoder path ignored\n";
+    return;
+  }
+  if (decoded.hasVehicles || decoded.type == CarlaJsonDecoder::Type::VEHICLES_POSITION) {
+    ++g_vehicleUpdates;
+  }
+  if (decoded.hasSync || decoded.type == CarlaJsonDecoder::Type::SYNC_REQUEST) {
+    g_send(R"({"type":"tick_result","carla_time":)" + std::to_string(decoded.sync.carlaTime) +
+           R"(,"ns3_time":)" + std::to_string(decoded.sync.carlaTime) + R"(,"receptions":[]})");
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  std::string transport = "tcp";
+  std::string shmName = "/carla_ns3";
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("transport", "tcp or shm", transport);
+  cmd.AddValue("shmName", "Shared-memory segment created with transport=shm", shmName);
+  cmd.Parse(argc, argv);
+  std::signal(SIGINT, [](int) { g_running = false; });
+  std::signal(SIGTERM, [](int) { g_running = false; });
+
+  std::unique_ptr<CarlaBridgeIo> tcp;
+  std::unique_ptr<CarlaShmTransport> shm;
+  if (transport == "shm") {
+    shm = std::make_unique<CarlaShmTransport>();
+    g_send = [&shm](std::string msg) {
+      shm->Enqueue(std::move(msg));
+      shm->Flush();
+    };
+    shm->SetCommandHandler(&HandleMessage);
+    shm->SetVehicleTableHandler([](std::vector<VehicleSample>&, double) { ++g_vehicleUpdates; });
+    if (!shm->Create(shmName) || !shm->Start()) {
+      return 1;
+    }
+  } else {
+    tcp = std::make_unique<CarlaBridgeIo>(5556, 5557, "auto");
+    g_send = [&tcp](std::string msg) {
+      tcp->Enqueue(std::move(msg));
+      tcp->Flush();
+    };
+    tcp->SetFrameHandler([](IngressFramer& framer) {
+      std::string_view frame;
+      while (framer.NextFrame(frame)) {
+        HandleMessage(frame);
+      }
+    });
+    if (!tcp->Start()) {
+      return 1;
+    }
+  }
+  std::cout << "[INFO] bridge-echo serving " << transport << "\n" << std::flush;
+  while (g_running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  if (shm) {
+    shm->Stop();
+  }
+  if (tcp) {
+    tcp->Stop();
+  }
+  std::cout << "[INFO] " << g_vehicleUpdates << " vehicle updates received\n";
+  return 0;
+}
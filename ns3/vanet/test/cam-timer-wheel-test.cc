@@ -0,0 +1,153 @@
+// CamTimerWheel against its contract: a timer fires once, never early and less than
+// one tick late; re-arming replaces the pending expiry; cancelled timers stay
+// silent; delays beyond both wheel levels (overflow) still land on time; and no
+// event runs while nothing is armed.
+
+#include "cam-timer-wheel.h"
+#include "vanet-test.h"
+
+#include "ns3/simulator.h"
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+const Time kTick = MilliSeconds(10);
+
+int64_t NowNs() { return Simulator::Now().GetNanoSeconds(); }
+
+void TestSingleTimer() {
+  CamTimerWheel wheel(kTick);
+  std::vector<int64_t> fired;
+  const CamTimerWheel::TimerId id = wheel.Add([&] { fired.push_back(NowNs()); });
+
+  // Re-arming replaces the pending expiry: one firing, at the second deadline.
+  wheel.Arm(id, MilliSeconds(500));
+  wheel.Arm(id, MilliSeconds(123));
+  VANET_CHECK(wheel.GetNArmed() == 1);
+  Simulator::Stop(Seconds(2));
+  Simulator::Run();
+  VANET_CHECK(fired.size() == 1);
+  VANET_CHECK(fired[0] >= MilliSeconds(123).GetNanoSeconds());
+  VANET_CHECK(fired[0] < (MilliSeconds(123) + kTick).GetNanoSeconds());
+  VANET_CHECK(wheel.GetNArmed() == 0);
+
+  // Cancelled and removed timers never fire.
+  wheel.Arm(id, MilliSeconds(50));
+  wheel.Cancel(id);
+  const CamTimerWheel::TimerId removed = wheel.Add([&] { fired.push_back(-1); });
+  wheel.Arm(removed, MilliSeconds(70));
+  wheel.Remove(removed);
+  VANET_CHECK(wheel.GetNArmed() == 0);
+  Simulator::Stop(Seconds(1));
+  Simulator::Run();
+  VANET_CHECK(fired.size() == 1);
+
+  // Beyond level 1 (256 * 256 ticks = 655 s at 10 ms): parked in the overflow list.
+  const Time far = Seconds(2000) + MilliSeconds(7);
+  const int64_t armedAt = NowNs();
+  wheel.Arm(id, far);
+  Simulator::Stop(Seconds(2100));
+  Simulator::Run();
+  VANET_CHECK(fired.size() == 2);
+  VANET_CHECK(fired[1] >= armedAt + far.GetNanoSeconds());
+  VANET_CHECK(fired[1] < armedAt + (far + kTick).GetNanoSeconds());
+  Simulator::Destroy();
+}
+
+// 1000 self re-arming timers with CAM-like 100 ms periods, occasional multi-minute
+// pauses, and random cancels and re-arms from outside the wheel.
+void TestRandomized() {
+  constexpr int kTimers = 1000;
+  CamTimerWheel wheel(kTick);
+  std::mt19937_64 rng(1);
+  std::vector<int64_t> due(kTimers, -1);
+  std::vector<CamTimerWheel::TimerId> ids(kTimers);
+  uint64_t fires = 0;
+
+  for (int i = 0; i < kTimers; ++i) {
+    ids[i] = wheel.Add([&, i] {
+      const int64_t now = NowNs();
+      VANET_CHECK(due[i] >= 0);                                  // armed
+      VANET_CHECK(now >= due[i]);                                // never early
+      VANET_CHECK(now < due[i] + kTick.GetNanoSeconds());        // less than a tick late
+      ++fires;
+      due[i] = -1;
+      if (rng() % 50 == 0) {
+        return;  // goes quiet until re-armed from outside
+      }
+      const int64_t delay = (rng() % 3 == 0)
+                                ? static_cast<int64_t>(rng() % 2000'000'000'000ULL)  // up to 2000 s
+                                : 100'000'000 + static_cast<int64_t>(rng() % 10'000'000);
+      due[i] = now + delay;
+      wheel.Arm(ids[i], NanoSeconds(delay));
+    });
+  }
+  for (int i = 0; i < kTimers; ++i) {
+    const int64_t delay = static_cast<int64_t>(rng() % 100'000'000);
+    due[i] = delay;
+    wheel.Arm(ids[i], NanoSeconds(delay));
+  }
+
+  // Every 50 ms, cancel an armed timer or re-arm a quiet one.
+  bool poking = true;
+  std::function<void()> poke = [&] {
+    if (!poking) {
+      return;
+    }
+    const int i = static_cast<int>(rng() % kTimers);
+    if (due[i] >= 0) {
+      wheel.Cancel(ids[i]);
+      due[i] = -1;
+    } else {
+      const int64_t delay = static_cast<int64_t>(rng() % 5'000'000'000ULL);
+      due[i] = NowNs() + delay;
+      wheel.Arm(ids[i], NanoSeconds(delay));
+    }
+    Simulator::Schedule(MilliSeconds(50), poke);
+  };
+  Simulator::Schedule(MilliSeconds(50), poke);
+  Simulator::Stop(Seconds(4000));
+  Simulator::Run();
+
+  size_t armed = 0;
+  for (int i = 0; i < kTimers; ++i) {
+    if (due[i] >= 0) {
+      VANET_CHECK(due[i] + kTick.GetNanoSeconds() > NowNs());  // nothing overdue
+      ++armed;
+    }
+  }
+  VANET_CHECK(armed == wheel.GetNArmed());
+  VANET_CHECK(fires > 100000);
+
+  // With every timer cancelled the wheel schedules nothing: at most the dispatch
+  // event already pending runs once more, and finds only stale entries.
+  poking = false;
+  Simulator::Stop(MilliSeconds(50));
+  Simulator::Run();
+  for (int i = 0; i < kTimers; ++i) {
+    wheel.Cancel(ids[i]);
+  }
+  VANET_CHECK(wheel.GetNArmed() == 0);
+  const uint64_t events = Simulator::GetEventCount();
+  Simulator::Stop(Seconds(100));
+  Simulator::Run();
+  VANET_CHECK(Simulator::GetEventCount() - events <= 2);  // that dispatch and the Stop event
+  std::cout << "cam-timer-wheel-test: " << fires << " firings checked\n";
+  Simulator::Destroy();
+}
+
+} // namespace
+
+int main() {
+  TestSingleTimer();
+  TestRandomized();
+  std::cout << "cam-timer-wheel-test: ok\n";
+  return 0;
+}
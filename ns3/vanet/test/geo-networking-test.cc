@@ -0,0 +1,196 @@
+// CamHeader and GeoNetHeader round trips through a packet, in the full and the
+// compact encoding: sizes, exact values on the fixed-point grid, rounding to the
+// nearest step, clamping at the field bounds, heading wrap-around and the expansion
+// of the 16-bit generation delta time against the receiver's clock.
+
+#include "geo-networking.h"
+#include "vanet-test.h"
+
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+
+using namespace ns3;
+
+namespace {
+
+void SetCompact(bool compact) {
+  CamHeader::SetCompactEncoding(compact);
+  GeoNetHeader::SetCompactEncoding(compact);
+}
+
+// Sets the simulation clock, which the receiver expands timestamps against.
+void SetNow(Time t) {
+  Simulator::Destroy();
+  Simulator::Stop(t);
+  Simulator::Run();
+}
+
+CamHeader RoundTrip(const CamHeader& sent) {
+  Ptr<Packet> packet = Create<Packet>(100);
+  packet->AddHeader(sent);
+  VANET_CHECK(packet->GetSize() == 100 + sent.GetSerializedSize());
+  CamHeader received;
+  VANET_CHECK(packet->RemoveHeader(received) == sent.GetSerializedSize());
+  VANET_CHECK(packet->GetSize() == 100);
+  return received;
+}
+
+GeoNetHeader RoundTrip(const GeoNetHeader& sent) {
+  Ptr<Packet> packet = Create<Packet>();
+  packet->AddHeader(sent);
+  GeoNetHeader received;
+  VANET_CHECK(packet->RemoveHeader(received) == sent.GetSerializedSize());
+  return received;
+}
+
+CamHeader MakeCam(double x, double y, double speed, double heading) {
+  CamHeader header;
+  header.SetVehicleId(42);
+  header.SetPositionX(x);
+  header.SetPositionY(y);
+  header.SetSpeed(speed);
+  header.SetHeading(heading);
+  header.SetTimestamp(Simulator::Now().GetMilliSeconds());
+  return header;
+}
+
+void TestFull() {
+  SetCompact(false);
+  CamHeader sent = MakeCam(-1234.56789, 1e9, 13.8765, -17.25);
+  sent.SetVehicleId(std::numeric_limits<uint32_t>::max());
+  sent.SetTimestamp(123456789012ULL);
+  sent.SetPktId(-1);
+  sent.SetFragment(3, 7);
+  VANET_CHECK(sent.GetSerializedSize() == 52);
+  const CamHeader r = RoundTrip(sent);
+  VANET_CHECK(r.GetVehicleId() == std::numeric_limits<uint32_t>::max());
+  VANET_CHECK(r.GetPositionX() == -1234.56789 && r.GetPositionY() == 1e9);
+  VANET_CHECK(r.GetSpeed() == 13.8765 && r.GetHeading() == -17.25);
+  VANET_CHECK(r.GetTimestamp() == 123456789012ULL);
+  VANET_CHECK(r.GetPktId() == -1);
+  VANET_CHECK(r.GetFragmentIndex() == 3 && r.GetFragmentCount() == 7);
+
+  GeoNetHeader geo;
+  geo.SetSourcePosition(0.123456, -98765.4321);
+  geo.SetSourceId(9);
+  VANET_CHECK(geo.GetSerializedSize() == 27);
+  const GeoNetHeader g = RoundTrip(geo);
+  VANET_CHECK(g.GetSourcePositionX() == 0.123456 && g.GetSourcePositionY() == -98765.4321);
+  VANET_CHECK(g.GetSourceId() == 9 && g.GetRadius() == 10000 && g.GetLifetime() == 60);
+}
+
+// Values on the grid come back as exactly the same double; others round to the
+// nearest step.
+void TestCompactQuantization() {
+  SetCompact(true);
+  VANET_CHECK(CamHeader().GetSerializedSize() == 26);
+  VANET_CHECK(GeoNetHeader().GetSerializedSize() == 19);
+
+  std::mt19937_64 rng(3);
+  for (int i = 0; i < 100000; ++i) {
+    const double x = (static_cast<int64_t>(rng() % 20'000'001) - 10'000'000) / 10.0;
+    const double y = (static_cast<int64_t>(rng() % 20'000'001) - 10'000'000) / 10.0;
+    const double speed = static_cast<double>(rng() % 65536) / 100.0;
+    const double heading = static_cast<double>(rng() % 3600) / 10.0;
+    const CamHeader r = RoundTrip(MakeCam(x, y, speed, heading));
+    VANET_CHECK(r.GetVehicleId() == 42);
+    VANET_CHECK(r.GetPositionX() == x && r.GetPositionY() == y);
+    VANET_CHECK(r.GetSpeed() == speed && r.GetHeading() == heading);
+
+    GeoNetHeader geo;
+    geo.SetSourcePosition(x, y);
+    const GeoNetHeader g = RoundTrip(geo);
+    VANET_CHECK(g.GetSourcePositionX() == x && g.GetSourcePositionY() == y);
+  }
+
+  for (int i = 0; i < 100000; ++i) {
+    const double x = std::uniform_real_distribution<double>(-1e6, 1e6)(rng);
+    const double speed = std::uniform_real_distribution<double>(0.0, 655.0)(rng);
+    const double heading = std::uniform_real_distribution<double>(0.0, 359.9)(rng);
+    const CamHeader r = RoundTrip(MakeCam(x, -x, speed, heading));
+    VANET_CHECK_NEAR(r.GetPositionX(), x, 0.05 + 1e-9);
+    VANET_CHECK_NEAR(r.GetPositionY(), -x, 0.05 + 1e-9);
+    VANET_CHECK_NEAR(r.GetSpeed(), speed, 0.005 + 1e-9);
+    VANET_CHECK_NEAR(r.GetHeading(), heading, 0.05 + 1e-9);
+  }
+
+  // Half a step rounds away from zero.
+  const CamHeader r = RoundTrip(MakeCam(1.25, -1.25, 0.125, 0.25));
+  VANET_CHECK(r.GetPositionX() == 1.3 && r.GetPositionY() == -1.3);
+  VANET_CHECK(r.GetSpeed() == 0.13 && r.GetHeading() == 0.3);
+}
+
+void TestCompactBounds() {
+  SetCompact(true);
+  const double maxPosition = std::numeric_limits<int32_t>::max() / 10.0;
+  const double minPosition = std::numeric_limits<int32_t>::min() / 10.0;
+
+  CamHeader r = RoundTrip(MakeCam(1e12, -1e12, 1000.0, 0.0));
+  VANET_CHECK(r.GetPositionX() == maxPosition && r.GetPositionY() == minPosition);
+  VANET_CHECK(r.GetSpeed() == 655.35);
+  r = RoundTrip(MakeCam(maxPosition, minPosition, 655.35, 0.0));
+  VANET_CHECK(r.GetPositionX() == maxPosition && r.GetPositionY() == minPosition);
+  VANET_CHECK(r.GetSpeed() == 655.35);
+  r = RoundTrip(MakeCam(0.0, 0.0, -3.0, 0.0));
+  VANET_CHECK(r.GetSpeed() == 0.0);
+
+  // Heading wraps into [0, 360); what rounds up to 360 becomes 0.
+  VANET_CHECK(RoundTrip(MakeCam(0, 0, 0, -90.0)).GetHeading() == 270.0);
+  VANET_CHECK(RoundTrip(MakeCam(0, 0, 0, 720.5)).GetHeading() == 0.5);
+  VANET_CHECK(RoundTrip(MakeCam(0, 0, 0, -0.04)).GetHeading() == 0.0);
+  VANET_CHECK(RoundTrip(MakeCam(0, 0, 0, 359.94)).GetHeading() == 359.9);
+  VANET_CHECK(RoundTrip(MakeCam(0, 0, 0, 359.97)).GetHeading() == 0.0);
+
+  GeoNetHeader geo;
+  geo.SetSourcePosition(-1e12, 1e12);
+  const GeoNetHeader g = RoundTrip(geo);
+  VANET_CHECK(g.GetSourcePositionX() == minPosition && g.GetSourcePositionY() == maxPosition);
+
+  // Transfer fields are carried at full width.
+  CamHeader sent;
+  sent.SetPktId(std::numeric_limits<int32_t>::max());
+  sent.SetFragment(65534, 65535);
+  r = RoundTrip(sent);
+  VANET_CHECK(r.GetPktId() == std::numeric_limits<int32_t>::max());
+  VANET_CHECK(r.GetFragmentIndex() == 65534 && r.GetFragmentCount() == 65535);
+  sent.SetPktId(-1);
+  VANET_CHECK(RoundTrip(sent).GetPktId() == -1);
+}
+
+// The timestamp travels as milliseconds modulo 65536 and is expanded to the latest
+// time not after the receiver's clock, so it is exact for CAMs younger than 65.5 s.
+void TestCompactTimestamp() {
+  SetCompact(true);
+  const uint64_t sentMs[] = {0, 100, 65535, 65536, 70000, 131071, 1'000'000'007};
+  const uint64_t ageMs[] = {0, 1, 999, 65535};
+  for (uint64_t sent : sentMs) {
+    for (uint64_t age : ageMs) {
+      SetNow(MilliSeconds(sent + age));
+      CamHeader header;
+      header.SetTimestamp(sent);
+      VANET_CHECK(RoundTrip(header).GetTimestamp() == sent);
+    }
+  }
+  // 65.536 s old: indistinguishable from a CAM sent now.
+  SetNow(MilliSeconds(1'000'000'007 + 65536));
+  CamHeader header;
+  header.SetTimestamp(1'000'000'007);
+  VANET_CHECK(RoundTrip(header).GetTimestamp() == 1'000'000'007 + 65536);
+  Simulator::Destroy();
+}
+
+} // namespace
+
+int main() {
+  TestFull();
+  TestCompactQuantization();
+  TestCompactBounds();
+  TestCompactTimestamp();
+  std::cout << "geo-networking-test: ok\n";
+  return 0;
+}
@@ -0,0 +1,116 @@
+// GroupcastAudience on its own (targets, radius, everyone, same-millisecond union,
+// expiry) and with the ids the applications actually use: a request is recorded
+// under CARLA ids, VehicleRegistry::Bind() hands those ids to the slot's sender and
+// receiver, and Accepts() is asked with what they stamp into and read from CAMs.
+
+#include "groupcast-audience.h"
+#include "vanet-test.h"
+#include "vehicle-registry.h"
+
+#include "ns3/node.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+TransferRequest Groupcast(int source, std::vector<int> targets, double radius) {
+  TransferRequest req;
+  req.groupcast = true;
+  req.source = source;
+  req.targets = std::move(targets);
+  req.radius = radius;
+  return req;
+}
+
+void TestAudience() {
+  GroupcastAudience audience;
+  audience.Add(Groupcast(5, {7, 3}, 0.0), 1000);
+  VANET_CHECK(audience.Accepts(5, 1000, 7, 900.0));
+  VANET_CHECK(audience.Accepts(5, 1000, 3, 900.0));
+  VANET_CHECK(!audience.Accepts(5, 1000, 4, 1.0));
+  // Another sender or send time is not this transfer: nothing narrows it.
+  VANET_CHECK(audience.Accepts(6, 1000, 4, 1.0));
+  VANET_CHECK(audience.Accepts(5, 1001, 4, 1.0));
+
+  // Same sender and millisecond: union of targets, largest radius.
+  audience.Add(Groupcast(5, {4}, 100.0), 1000);
+  VANET_CHECK(audience.Accepts(5, 1000, 4, 900.0));
+  VANET_CHECK(audience.Accepts(5, 1000, 9, 100.0));
+  VANET_CHECK(!audience.Accepts(5, 1000, 9, 100.5));
+  VANET_CHECK(audience.Accepts(5, 1000, 7, 900.0));
+
+  audience.Add(Groupcast(8, {}, 0.0), 1500);
+  VANET_CHECK(audience.Accepts(8, 1500, 42, 1e6));
+  VANET_CHECK(audience.GetN() == 2);
+
+  // Entries older than the lifetime go when newer ones come in.
+  audience.SetLifetimeMs(2000);
+  audience.Add(Groupcast(9, {1}, 0.0), 3001);
+  VANET_CHECK(audience.GetN() == 2);
+  VANET_CHECK(audience.Accepts(5, 1000, 9, 900.0));
+}
+
+struct Slot {
+  Ptr<CamSenderNR> sender;
+  Ptr<CamReceiverNR> receiver;
+};
+
+void TestThroughRegistry() {
+  VehicleRegistry registry;
+  registry.Resize(3);
+  std::vector<Slot> slots(3);
+  for (uint32_t slot = 0; slot < 3; ++slot) {
+    slots[slot].sender = CreateObject<CamSenderNR>();
+    slots[slot].receiver = CreateObject<CamReceiverNR>();
+    // Ids before binding, as InitializeVehicles_* sets them.
+    slots[slot].sender->SetVehicleId(slot + 1);
+    slots[slot].receiver->SetVehicleId(slot + 1);
+    registry.SetVehicle(slot, CreateObject<Node>(), Ipv4Address(0x0A000001 + slot), slots[slot].sender,
+                        slots[slot].receiver);
+  }
+  // CARLA id 1 lands in slot 2, so slot 0's former id (slot + 1) belongs to it now.
+  VANET_CHECK(registry.Bind(57, 0));
+  VANET_CHECK(registry.Bind(9, 1));
+  VANET_CHECK(registry.Bind(1, 2));
+  for (uint32_t slot = 0; slot < 3; ++slot) {
+    VANET_CHECK(slots[slot].sender->GetVehicleId() == static_cast<uint32_t>(registry.GetCarlaId(slot)));
+    VANET_CHECK(slots[slot].receiver->GetVehicleId() == static_cast<uint32_t>(registry.GetCarlaId(slot)));
+  }
+
+  const auto accepts = [&](const GroupcastAudience& audience, uint32_t from, uint64_t sendTimeMs,
+                           uint32_t to, double distance) {
+    return audience.Accepts(slots[from].sender->GetVehicleId(), sendTimeMs,
+                            slots[to].receiver->GetVehicleId(), distance);
+  };
+
+  GroupcastAudience audience;
+  audience.Add(Groupcast(57, {9}, 0.0), 1000);
+  VANET_CHECK(accepts(audience, 0, 1000, 1, 800.0));
+  VANET_CHECK(!accepts(audience, 0, 1000, 2, 10.0));
+  // A CAM of CARLA id 1 stamped in the same millisecond is not filtered against
+  // the audience of 57.
+  VANET_CHECK(accepts(audience, 2, 1000, 0, 800.0));
+
+  // 9 despawns and 12 takes over its slot: the old audience does not cover 12, a new
+  // request for 12 reaches it, and the other slots are untouched.
+  VANET_CHECK(registry.Release(9) == 1);
+  VANET_CHECK(registry.BindFree(12, 0) == 1);
+  VANET_CHECK(slots[1].receiver->GetVehicleId() == 12);
+  VANET_CHECK(!accepts(audience, 0, 1000, 1, 800.0));
+  audience.Add(Groupcast(57, {12}, 50.0), 1100);
+  VANET_CHECK(accepts(audience, 0, 1100, 1, 800.0));
+  VANET_CHECK(accepts(audience, 0, 1100, 2, 50.0));
+  VANET_CHECK(!accepts(audience, 0, 1100, 2, 51.0));
+}
+
+} // namespace
+
+int main() {
+  TestAudience();
+  TestThroughRegistry();
+  std::cout << "groupcast-audience-test: ok\n";
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Ingress framing throughput: IngressFramer against the substr/erase loop it replaced.
+// A multi-MB burst of "\n\r"-delimited frames is fed in recv()-sized chunks and every
+// frame is extracted; each configuration reports MB/s and frames/s of both framers.
+
+#include "ingress-framer.h"
+#include "vanet-test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+using vanet_test::Clock;
+
+namespace {
+
+constexpr size_t kRecvChunk = 64 * 1024;
+
+std::string MakeBurst(size_t burstBytes, size_t frameBytes, size_t& frames) {
+  std::string burst;
+  burst.reserve(burstBytes + frameBytes);
+  frames = 0;
+  while (burst.size() < burstBytes) {
+    std::string frame = "{\"type\":\"vehicles_position\",\"seq\":" + std::to_string(frames) +
+                        ",\"vehicles\":[";
+    while (frame.size() + 2 < frameBytes) {
+      frame += "{\"id\":1,\"x\":12.5,\"y\":-3.25,\"z\":0.0},";
+    }
+    frame += "]}\n\r";
+    burst += frame;
+    ++frames;
+  }
+  return burst;
+}
+
+size_t RunIngressFramer(const std::string& burst, int rounds) {
+  IngressFramer framer;
+  size_t frames = 0;
+  for (int r = 0; r < rounds; ++r) {
+    for (size_t pos = 0; pos < burst.size();) {
+      const size_t n = std::min(kRecvChunk, burst.size() - pos);
+      char* w = framer.PrepareWrite(kRecvChunk);
+      std::memcpy(w, burst.data() + pos, n);
+      framer.Commit(n);
+      pos += n;
+      std::string_view frame;
+      while (framer.NextFrame(frame)) {
+        vanet_test::DoNotOptimize(frame.data());
+        ++frames;
+      }
+    }
+  }
+  return frames;
+}
+
+// The pre-IngressFramer receive path, with the partial frame kept across reads.
+size_t RunSubstrErase(const std::string& burst, int rounds) {
+  std::string buffer;
+  size_t frames = 0;
+  for (int r = 0; r < rounds; ++r) {
+    for (size_t pos = 0; pos < burst.size();) {
+      const size_t n = std::min(kRecvChunk, burst.size() - pos);
+      buffer.append(burst.data() + pos, n);
+      pos += n;
+      size_t delim;
+      while ((delim = buffer.find("\n\r")) != std::string::npos) {
+        std::string frame = buffer.substr(0, delim);
+        buffer.erase(0, delim + 2);
+        vanet_test::DoNotOptimize(frame.data());
+        ++frames;
+      }
+    }
+  }
+  return frames;
+}
+
+} // namespace
+
+int main() {
+  const size_t burstSizes[] = {1 << 20, 4 << 20, 16 << 20};
+  const size_t frameSizes[] = {1024, 64 * 1024};
+
+  std::printf("%-10s %-10s %14s %14s %14s %14s\n", "burst MB", "frame B", "framer MB/s",
+              "framer fr/s", "substr MB/s", "substr fr/s");
+  for (size_t burstBytes : burstSizes) {
+    for (size_t frameBytes : frameSizes) {
+      size_t burstFrames = 0;
+      const std::string burst = MakeBurst(burstBytes, frameBytes, burstFrames);
+      const int rounds = static_cast<int>(std::max<size_t>(1, (64u << 20) / burst.size()));
+      const double mb = static_cast<double>(burst.size()) * rounds / (1 << 20);
+
+      Clock::time_point start = Clock::now();
+      const size_t framerFrames = RunIngressFramer(burst, rounds);
+      const double framerSeconds = vanet_test::SecondsSince(start);
+
+      start = Clock::now();
+      const size_t legacyFrames = RunSubstrErase(burst, rounds);
+      const double legacySeconds = vanet_test::SecondsSince(start);
+
+      VANET_CHECK(framerFrames == burstFrames * rounds);
+      VANET_CHECK(legacyFrames == framerFrames);
+      std::printf("%-10zu %-10zu %14.0f %14.0f %14.0f %14.0f\n", burstBytes >> 20, frameBytes,
+                  mb / framerSeconds, framerFrames / framerSeconds, mb / legacySeconds,
+                  legacyFrames / legacySeconds);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+// Decode cost of one vehicles_position tick at 100, 500 and 2000 vehicles:
+// CarlaJsonDecoder against nlohmann::json::parse plus the field extraction of the
+// generic path in main.cc. Both decode into one reused vector, like the bridge thread.
+
+#include "carla-json-decoder.h"
+#include "vanet-test.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+using json = nlohmann::json;
+using vanet_test::Clock;
+
+namespace {
+
+// Same shape as CarlaNs3Bridge.send_vehicles_position() produces.
+std::string MakeTick(int vehicles) {
+  std::string msg = "{\"type\": \"vehicles_position\", \"carla_time\": 12.35, \"vehicles_position\": [";
+  for (int i = 0; i < vehicles; ++i) {
+    char record[320];
+    std::snprintf(record, sizeof(record),
+                  "%s{\"id\": %d, \"carla_id\": %d, \"position\": {\"x\": %.6f, \"y\": %.6f, "
+                  "\"z\": 0.0021}, \"velocity\": {\"x\": %.6f, \"y\": %.6f, \"z\": 0.0}, "
+                  "\"heading\": %.4f, \"speed\": %.4f}",
+                  i == 0 ? "" : ", ", i + 1, 100 + i, 10.0 + i * 3.217, -45.5 + i * 0.731,
+                  8.3 - i * 0.01, 0.25 + i * 0.002, 90.0 + i * 0.1, 8.31);
+    msg += record;
+  }
+  msg += "]}";
+  return msg;
+}
+
+void ParseGeneric(const std::string& data, std::vector<VehicleSample>& out) {
+  const json msg = json::parse(data);
+  const json& array = msg["vehicles_position"];
+  out.clear();
+  for (const auto& vehicle : array) {
+    VehicleSample& v = out.emplace_back();
+    v.carlaId = vehicle.value("carla_id", -1);
+    v.index = vehicle.value("id", -1);
+    const json& position = vehicle["position"];
+    const json& velocity = vehicle["velocity"];
+    v.position = Vector(position.value("x", 0.0), position.value("y", 0.0), position.value("z", 0.0));
+    v.velocity = Vector(velocity.value("x", 0.0), velocity.value("y", 0.0), velocity.value("z", 0.0));
+    v.yawRate = vehicle.value("yaw_rate", 0.0);
+  }
+}
+
+} // namespace
+
+int main() {
+  std::printf("%-9s %-10s %14s %14s %9s\n", "vehicles", "bytes", "decoder us", "json us",
+              "speedup");
+  for (int vehicles : {100, 500, 2000}) {
+    const std::string tick = MakeTick(vehicles);
+    const int rounds = 2000000 / vehicles;
+
+    CarlaJsonDecoder decoder;
+    CarlaJsonDecoder::Result result;
+    std::vector<VehicleSample> fast;
+    std::vector<TransferRequest> requests;
+    std::vector<VehicleSample> generic;
+
+    VANET_CHECK(decoder.Decode(tick, result, fast, requests) == CarlaJsonDecoder::Status::OK);
+    ParseGeneric(tick, generic);
+    VANET_CHECK(fast.size() == static_cast<size_t>(vehicles) && generic.size() == fast.size());
+    for (size_t i = 0; i < fast.size(); ++i) {
+      VANET_CHECK(fast[i].carlaId == generic[i].carlaId && fast[i].index == generic[i].index);
+      VANET_CHECK(fast[i].position.x == generic[i].position.x);
+      VANET_CHECK(fast[i].velocity.y == generic[i].velocity.y);
+    }
+
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      decoder.Decode(tick, result, fast, requests);
+      vanet_test::DoNotOptimize(fast.data());
+    }
+    const double decoderUs = vanet_test::SecondsSince(start) * 1e6 / rounds;
+
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      ParseGeneric(tick, generic);
+      vanet_test::DoNotOptimize(generic.data());
+    }
+    const double jsonUs = vanet_test::SecondsSince(start) * 1e6 / rounds;
+
+    std::printf("%-9d %-10zu %14.1f %14.1f %8.1fx\n", vehicles, tick.size(), decoderUs, jsonUs,
+                jsonUs / decoderUs);
+  }
+  return 0;
+}
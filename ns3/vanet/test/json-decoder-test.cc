@@ -0,0 +1,77 @@
+// CarlaJsonDecoder on the message shapes CarlaNs3Bridge sends, in particular
+// vehicles_despawn, standalone and inside a tick_bundle, which must stay on the fast
+// path instead of falling back to nlohmann::json.
+
+#include "carla-json-decoder.h"
+#include "vanet-test.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+using Status = CarlaJsonDecoder::Status;
+using Type = CarlaJsonDecoder::Type;
+
+struct Decoded {
+  Status status;
+  CarlaJsonDecoder::Result result;
+  std::vector<VehicleSample> vehicles;
+  std::vector<TransferRequest> requests;
+};
+
+Decoded Decode(CarlaJsonDecoder& decoder, const std::string& msg) {
+  Decoded d;
+  d.status = decoder.Decode(msg, d.result, d.vehicles, d.requests);
+  return d;
+}
+
+void TestStandaloneDespawn() {
+  CarlaJsonDecoder decoder;
+  Decoded d = Decode(decoder, R"({"type": "vehicles_despawn", "vehicles_despawn": [104, 7, 250]})");
+  VANET_CHECK(d.status == Status::OK);
+  VANET_CHECK(d.result.type == Type::VEHICLES_DESPAWN);
+  VANET_CHECK((d.result.despawned == std::vector<int>{104, 7, 250}));
+
+  d = Decode(decoder, R"({"type": "vehicles_despawn", "vehicles_despawn": []})");
+  VANET_CHECK(d.status == Status::OK && d.result.despawned.empty());
+
+  // Type and payload disagree: left to the generic path.
+  d = Decode(decoder, R"({"type": "vehicles_num", "vehicles_despawn": [1]})");
+  VANET_CHECK(d.status == Status::UNSUPPORTED);
+  d = Decode(decoder, R"({"type": "vehicles_despawn", "vehicles_despawn": [1, "x"]})");
+  VANET_CHECK(d.status != Status::OK);
+}
+
+void TestTickBundleDespawn() {
+  CarlaJsonDecoder decoder;
+  const std::string bundle =
+      R"({"type": "tick_bundle", "tick_bundle": {"vehicles_position": [)"
+      R"({"id": 0, "carla_id": 300, "position": {"x": 1.5, "y": 2.0, "z": 0.0},)"
+      R"( "velocity": {"x": 8.0, "y": 0.0, "z": 0.0}}], "transfer_requests": [],)"
+      R"( "sync_request": {"carla_time": 3.25, "request_time": 1.0},)"
+      R"( "vehicles_num": 12, "vehicles_despawn": [101, 102]}})";
+  Decoded d = Decode(decoder, bundle);
+  VANET_CHECK(d.status == Status::OK);
+  VANET_CHECK(d.result.type == Type::TICK_BUNDLE);
+  VANET_CHECK((d.result.despawned == std::vector<int>{101, 102}));
+  VANET_CHECK(d.result.hasVehicles && d.vehicles.size() == 1 && d.vehicles[0].carlaId == 300);
+  VANET_CHECK(d.result.hasSync && d.result.sync.carlaTime == 3.25);
+  VANET_CHECK(d.result.hasVehiclesNum && d.result.vehiclesNum == 12);
+
+  // Despawns of one bundle never leak into the next.
+  d = Decode(decoder, R"({"type": "tick_bundle", "tick_bundle": {"sync_request": {"carla_time": 3.3}}})");
+  VANET_CHECK(d.status == Status::OK && d.result.despawned.empty() && !d.result.hasVehicles);
+}
+
+} // namespace
+
+int main() {
+  TestStandaloneDespawn();
+  TestTickBundleDespawn();
+  std::cout << "json-decoder-test: ok\n";
+  return 0;
+}
@@ -0,0 +1,323 @@
+// LinkKpi and its building blocks: LatencyHistogram percentiles within the bucket
+// resolution of the exact ones, SlidingWindowSum expiring whole sub-windows, and
+// delivery ratios that never exceed 1, whichever way vehicles move, listen or
+// duplicate reports between a transmission and its delivery.
+
+#include "link-kpi.h"
+#include "vanet-test.h"
+
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+void RunUntil(Time t) {
+  Simulator::Stop(t - Simulator::Now());
+  Simulator::Run();
+}
+
+// Value of "key": in a flat summary, as text.
+std::string Field(const std::string& summary, const std::string& key) {
+  const std::string tag = "\"" + key + "\":";
+  const size_t start = summary.find(tag);
+  VANET_CHECK(start != std::string::npos);
+  const size_t begin = start + tag.size();
+  return summary.substr(begin, summary.find_first_of(",}", begin) - begin);
+}
+
+void TestHistogram() {
+  LatencyHistogram empty;
+  VANET_CHECK(empty.GetQuantile(0.5) == 0.0 && empty.GetMean() == 0.0);
+
+  // Below 64 us every value has its own bucket.
+  LatencyHistogram small;
+  for (uint64_t us = 0; us < 64; ++us) {
+    small.Add(us);
+  }
+  VANET_CHECK(small.GetQuantile(0.5) == 31.0);
+  VANET_CHECK(small.GetQuantile(1.0) == 63.0 && small.GetMax() == 63);
+  VANET_CHECK(small.GetMean() == 31.5);
+
+  // Log-uniform from 1 us to ~3 h: every percentile within 1/32 of the exact one.
+  LatencyHistogram h;
+  std::mt19937_64 rng(1);
+  std::vector<uint64_t> values;
+  for (int i = 0; i < 200000; ++i) {
+    const uint64_t us = static_cast<uint64_t>(std::exp(std::uniform_real_distribution<>(0.0, 23.0)(rng)));
+    values.push_back(us);
+    h.Add(us);
+  }
+  std::sort(values.begin(), values.end());
+  VANET_CHECK(h.GetCount() == values.size() && h.GetMax() == values.back());
+  for (double q : {0.001, 0.01, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+    const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(q * values.size())));
+    const double exact = static_cast<double>(values[rank - 1]);
+    VANET_CHECK(std::abs(h.GetQuantile(q) - exact) <= exact / 32.0);
+  }
+  VANET_CHECK(h.GetQuantile(1.0) == static_cast<double>(values.back()));
+}
+
+void TestWindow() {
+  // 1000 bytes every ms for 3 s: 1 MB/s over any full window.
+  SlidingWindowSum steady(Seconds(1));
+  for (int ms = 0; ms < 3000; ++ms) {
+    steady.Add(MilliSeconds(ms), 1000);
+  }
+  VANET_CHECK_NEAR(steady.GetRate(MilliSeconds(2999)), 1e6, 1e6 * 0.002);
+  VANET_CHECK(steady.GetRate(Seconds(10)) == 0.0);
+
+  // Shorter than a window since the start: the rate covers the time elapsed.
+  SlidingWindowSum early(Seconds(1));
+  early.Add(MilliSeconds(100), 500);
+  VANET_CHECK_NEAR(early.GetRate(MilliSeconds(250)), 2000.0, 1e-6);
+
+  // A burst leaves the window with its sub-window, 100 ms steps at a 1 s window.
+  SlidingWindowSum burst(Seconds(1));
+  burst.Add(MilliSeconds(1050), 1000);
+  VANET_CHECK_NEAR(burst.GetRate(MilliSeconds(1999)), 1000 / 0.999, 1e-6);
+  VANET_CHECK(burst.GetRate(MilliSeconds(2000)) == 0.0);
+  burst.Add(MilliSeconds(2010), 300);
+  burst.Add(MilliSeconds(2510), 700);
+  VANET_CHECK_NEAR(burst.GetRate(MilliSeconds(2999)), 1000 / 0.999, 1e-6);
+  VANET_CHECK_NEAR(burst.GetRate(MilliSeconds(3000)), 700 / 0.9, 1e-6);
+}
+
+struct Fleet {
+  LinkKpi kpi{50.0, 1000.0, Seconds(1)};
+  std::vector<Ptr<ConstantPositionMobilityModel>> mobility;
+
+  explicit Fleet(int vehicles) {
+    for (int id = 0; id < vehicles; ++id) {
+      mobility.push_back(CreateObject<ConstantPositionMobilityModel>());
+      kpi.AddVehicle(id, Address(id), mobility.back());
+      kpi.SetListening(id, true);
+    }
+  }
+  static Ipv4Address Address(uint32_t id) { return Ipv4Address(0x0A000001 + id); }
+  void Move(uint32_t id, double x) { mobility[id]->SetPosition(Vector(x, 0.0, 0.0)); }
+  uint64_t NowMs() const { return Simulator::Now().GetMilliSeconds(); }
+  void Deliver(uint32_t sender, uint32_t receiver, uint64_t sendTimeMs, bool complete = true) {
+    const Time latency = Simulator::Now() - MilliSeconds(sendTimeMs);
+    kpi.OnDelivered(sender, receiver, sendTimeMs, latency, latency, 100, complete);
+  }
+};
+
+void TestDeliveryRatio() {
+  // 0 sends; 1 at 100 m, 2 at 620 m, 3 out of range at 1100 m, 4 parked.
+  Fleet fleet(5);
+  fleet.Move(1, 100);
+  fleet.Move(2, 620);
+  fleet.Move(3, 1100);
+  fleet.kpi.SetListening(4, false);
+  RunUntil(Seconds(1));
+
+  const uint64_t sent = fleet.NowMs();
+  fleet.kpi.OnTransmit(0, sent, Ipv4Address::GetBroadcast(), 100);  // expects 1 and 2
+  fleet.kpi.OnTransmit(0, sent, Fleet::Address(3), 100);            // out of range
+  RunUntil(Seconds(1) + MilliSeconds(20));
+
+  // 3 moved into range and 4 woke up after the transmission: neither was expected,
+  // so their receptions do not count. 2 left the range: its reception still counts,
+  // in the bin it was expected in.
+  fleet.Move(3, 200);
+  fleet.kpi.SetListening(4, true);
+  fleet.Move(2, 1500);
+  fleet.Deliver(0, 3, sent);
+  fleet.Deliver(0, 4, sent);
+  fleet.Deliver(0, 1, sent);
+  fleet.Deliver(0, 2, sent);
+  fleet.Deliver(0, 1, sent);  // a second report of the same transfer
+  std::string summary = fleet.kpi.GetSummary();
+  VANET_CHECK(Field(summary, "transfers") == "2");
+  VANET_CHECK(Field(summary, "expected") == "2");
+  VANET_CHECK(Field(summary, "delivered") == "2");
+  VANET_CHECK(Field(summary, "unmatched") == "3");
+  VANET_CHECK(Field(summary, "pdr") == "1.0000");
+  VANET_CHECK(summary.find(R"("bin_expected":[0,0,1,0,0,0,0,0,0,0,0,0,1,0,)") != std::string::npos);
+  VANET_CHECK(summary.find(R"("bin_prr":[0.0000,0.0000,1.0000,)") != std::string::npos);
+  VANET_CHECK(summary.find("[0,1,1,1,20.000]") != std::string::npos);
+  VANET_CHECK(summary.find("[0,2,1,1,20.000]") != std::string::npos);
+  VANET_CHECK(Field(summary, "p50") == "20.000");
+
+  // Lost and late: a transfer delivered past the horizon counts as lost, and so
+  // does an incomplete one.
+  fleet.Move(2, 620);
+  const uint64_t lost = fleet.NowMs();
+  fleet.kpi.OnTransmit(0, lost, Ipv4Address::GetBroadcast(), 100);  // expects 1, 2, 3, 4
+  RunUntil(Seconds(2));
+  fleet.Deliver(0, 3, lost, false);
+  RunUntil(Seconds(8));
+  fleet.Deliver(0, 1, lost);
+  summary = fleet.kpi.GetSummary();
+  VANET_CHECK(Field(summary, "expected") == "6");
+  VANET_CHECK(Field(summary, "delivered") == "2");
+  VANET_CHECK(Field(summary, "incomplete") == "1");
+  VANET_CHECK(Field(summary, "unmatched") == "4");
+  VANET_CHECK(Field(summary, "pdr") == "0.3333");
+  Simulator::Destroy();
+}
+
+// Vehicles register under slot + 1 and are then bound to CARLA ids, which is what
+// their CAMs carry from then on: CamReceiver::SetVehicleId() registers the same IP
+// again. Distances, unicast addresses, listening states and deliveries all follow the
+// CARLA id, also when an id collides with another slot's former one and when a slot
+// is handed over to another id after a despawn.
+void TestRebind() {
+  LinkKpi kpi(50.0, 1000.0, Seconds(1));
+  std::vector<Ptr<ConstantPositionMobilityModel>> mobility;
+  for (uint32_t slot = 0; slot < 3; ++slot) {
+    mobility.push_back(CreateObject<ConstantPositionMobilityModel>());
+    mobility.back()->SetPosition(Vector(100.0 * slot, 0.0, 0.0));
+    kpi.AddVehicle(slot + 1, Fleet::Address(slot), mobility.back());
+    kpi.SetListening(slot + 1, true);
+  }
+  const uint32_t carlaId[] = {57, 9, 1};  // 1 was slot 0's id
+  for (uint32_t slot = 0; slot < 3; ++slot) {
+    kpi.AddVehicle(carlaId[slot], Fleet::Address(slot), mobility[slot]);
+  }
+  RunUntil(Seconds(1));
+  const auto deliver = [&](uint32_t sender, uint32_t receiver, uint64_t sendTimeMs) {
+    const Time latency = Simulator::Now() - MilliSeconds(sendTimeMs);
+    kpi.OnDelivered(sender, receiver, sendTimeMs, latency, latency, 100, true);
+  };
+
+  uint64_t sent = Simulator::Now().GetMilliSeconds();
+  kpi.OnTransmit(57, sent, Ipv4Address::GetBroadcast(), 100);
+  kpi.OnTransmit(1, sent, Fleet::Address(1), 100);
+  RunUntil(Seconds(1) + MilliSeconds(10));
+  deliver(57, 9, sent);
+  deliver(57, 1, sent);
+  deliver(1, 9, sent);
+  std::string summary = kpi.GetSummary();
+  VANET_CHECK(Field(summary, "expected") == "3");
+  VANET_CHECK(Field(summary, "delivered") == "3");
+  VANET_CHECK(Field(summary, "unmatched") == "0");
+  VANET_CHECK(summary.find("[57,9,1,1,10.000]") != std::string::npos);
+  VANET_CHECK(summary.find("[57,1,1,1,10.000]") != std::string::npos);
+  VANET_CHECK(summary.find("[1,9,1,1,10.000]") != std::string::npos);
+  VANET_CHECK(summary.find(R"("bin_expected":[0,0,2,0,1,0,)") != std::string::npos);
+
+  // 9 despawns: its slot is parked, then handed to 12, which keeps the parked state
+  // until it is resumed. Nothing is expected at the parked slot, and neither 9 nor
+  // 12 count for what was sent before.
+  kpi.SetListening(9, false);
+  sent = Simulator::Now().GetMilliSeconds();
+  kpi.OnTransmit(57, sent, Ipv4Address::GetBroadcast(), 100);
+  kpi.AddVehicle(12, Fleet::Address(1), mobility[1]);
+  kpi.OnTransmit(57, sent + 1, Ipv4Address::GetBroadcast(), 100);
+  kpi.SetListening(12, true);
+  RunUntil(Seconds(1) + MilliSeconds(20));
+  deliver(57, 12, sent);
+  deliver(57, 9, sent);
+  deliver(57, 1, sent);
+  summary = kpi.GetSummary();
+  VANET_CHECK(Field(summary, "expected") == "5");
+  VANET_CHECK(Field(summary, "delivered") == "4");
+  VANET_CHECK(Field(summary, "unmatched") == "2");
+
+  sent = Simulator::Now().GetMilliSeconds();
+  kpi.OnTransmit(12, sent, Fleet::Address(0), 100);
+  kpi.OnTransmit(57, sent, Ipv4Address::GetBroadcast(), 100);
+  RunUntil(Seconds(1) + MilliSeconds(30));
+  deliver(12, 57, sent);
+  deliver(57, 12, sent);
+  summary = kpi.GetSummary();
+  VANET_CHECK(Field(summary, "expected") == "8");
+  VANET_CHECK(Field(summary, "delivered") == "6");
+  VANET_CHECK(summary.find("[12,57,1,1,10.000]") != std::string::npos);
+  VANET_CHECK(summary.find("[57,12,1,1,10.000]") != std::string::npos);
+
+  // An id bound to another slot moves there; the slot it left is not counted.
+  kpi.AddVehicle(57, Fleet::Address(2), mobility[2]);
+  sent = Simulator::Now().GetMilliSeconds();
+  kpi.OnTransmit(12, sent, Ipv4Address::GetBroadcast(), 100);
+  kpi.OnTransmit(12, sent, Fleet::Address(0), 100);
+  summary = kpi.GetSummary();
+  VANET_CHECK(Field(summary, "expected") == "9");
+  VANET_CHECK(summary.find("[12,57,2,1,") != std::string::npos);
+  Simulator::Destroy();
+}
+
+// Random moves, listening changes, losses and duplicate reports: delivered never
+// exceeds expected, overall, per bin and per link.
+void TestRandomized() {
+  constexpr int kVehicles = 30;
+  Fleet fleet(kVehicles);
+  std::mt19937_64 rng(7);
+  std::uniform_real_distribution<double> position(0.0, 1500.0);
+  for (int id = 0; id < kVehicles; ++id) {
+    fleet.Move(id, position(rng));
+  }
+
+  struct Sent {
+    uint32_t sender;
+    uint64_t sendTimeMs;
+  };
+  std::vector<Sent> sent;
+  for (int step = 1; step <= 2000; ++step) {
+    RunUntil(MilliSeconds(step * 10));
+    const uint32_t sender = static_cast<uint32_t>(rng() % kVehicles);
+    const Ipv4Address dest = rng() % 3 ? Ipv4Address::GetBroadcast()
+                                       : Fleet::Address(static_cast<uint32_t>(rng() % kVehicles));
+    fleet.kpi.OnTransmit(sender, fleet.NowMs(), dest, 100);
+    sent.push_back({sender, fleet.NowMs()});
+    fleet.Move(static_cast<uint32_t>(rng() % kVehicles), position(rng));
+    fleet.kpi.SetListening(static_cast<uint32_t>(rng() % kVehicles), rng() % 4 != 0);
+    // A few recent transfers are heard by random vehicles, some more than once.
+    for (int i = 0; i < 20; ++i) {
+      const Sent& s = sent[sent.size() - 1 - rng() % std::min<size_t>(sent.size(), 50)];
+      fleet.Deliver(s.sender, static_cast<uint32_t>(rng() % kVehicles), s.sendTimeMs);
+    }
+  }
+
+  const std::string summary = fleet.kpi.GetSummary();
+  const double expected = std::stod(Field(summary, "expected"));
+  const double delivered = std::stod(Field(summary, "delivered"));
+  VANET_CHECK(expected > 1000 && delivered > 100 && delivered <= expected);
+  VANET_CHECK(std::stod(Field(summary, "pdr")) <= 1.0);
+  VANET_CHECK(std::stod(Field(summary, "unmatched")) > 0);
+
+  // Every bin_prr entry, then every link: [sender, receiver, expected, delivered, ms]
+  const char* cur = summary.c_str() + summary.find(R"("bin_prr":[)") + 11;
+  for (char* next = nullptr;; cur = next + 1) {
+    VANET_CHECK(std::strtod(cur, &next) <= 1.0);
+    if (*next != ',') {
+      break;
+    }
+  }
+  size_t checkedLinks = 0;
+  const size_t links = summary.find(R"("links":[)");
+  for (size_t pos = summary.find('[', links + 9); pos != std::string::npos; pos = summary.find('[', pos + 1)) {
+    unsigned long sender, receiver, linkExpected, linkDelivered;
+    VANET_CHECK(std::sscanf(summary.c_str() + pos, "[%lu,%lu,%lu,%lu,", &sender, &receiver, &linkExpected,
+                            &linkDelivered) == 4);
+    VANET_CHECK(linkDelivered <= linkExpected);
+    ++checkedLinks;
+  }
+  VANET_CHECK(checkedLinks > 100);
+  Simulator::Destroy();
+}
+
+} // namespace
+
+int main() {
+  TestHistogram();
+  TestWindow();
+  TestDeliveryRatio();
+  TestRebind();
+  TestRandomized();
+  std::cout << "link-kpi-test: ok\n";
+  return 0;
+}
@@ -0,0 +1,132 @@
+// Lockstep overhead per CARLA tick at 20 and 100 Hz: the former Stop()/Run() per tick
+// against one persistent Run() gated by an event at every sync target (SyncGate in
+// main.cc). A driver thread plays CARLA and requests the next target as soon as the
+// previous one was acked, so the wall time per tick is the co-simulation overhead plus
+// the load events of `vehicles` nodes, each firing every 100 ms.
+
+#include "vanet-test.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+using vanet_test::Clock;
+
+namespace {
+
+std::mutex g_mutex;
+std::condition_variable g_cv;
+int64_t g_requested = 0;  // last tick requested by the driver
+int64_t g_acked = 0;      // last tick acked by the simulator thread
+int64_t g_ticks = 0;
+Time g_step;
+
+void Load(Time period) {
+  Simulator::Schedule(period, &Load, period);
+}
+
+void Ack(int64_t tick) {
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_acked = tick;
+  }
+  g_cv.notify_all();
+}
+
+void WaitForRequest(int64_t tick) {
+  std::unique_lock<std::mutex> lock(g_mutex);
+  g_cv.wait(lock, [tick] { return g_requested >= tick; });
+}
+
+void RunPerTick() {
+  for (int64_t tick = 1; tick <= g_ticks; ++tick) {
+    WaitForRequest(tick);
+    Simulator::Stop(g_step * tick - Simulator::Now());
+    Simulator::Run();
+    Ack(tick);
+  }
+}
+
+void Gate(int64_t tick) {
+  Ack(tick);
+  if (tick == g_ticks) {
+    Simulator::Stop();
+    return;
+  }
+  WaitForRequest(tick + 1);
+  Simulator::Schedule(g_step * (tick + 1) - Simulator::Now(), &Gate, tick + 1);
+}
+
+void RunGated() {
+  WaitForRequest(1);
+  Simulator::Schedule(g_step, &Gate, int64_t{1});
+  Simulator::Run();
+}
+
+// Returns the wall time of every tick, request to ack, in microseconds.
+std::vector<double> Measure(bool gated, double rateHz, int vehicles) {
+  g_requested = 0;
+  g_acked = 0;
+  g_step = Seconds(1.0 / rateHz);
+  for (int i = 0; i < vehicles; ++i) {
+    Simulator::Schedule(MilliSeconds(100) * i / vehicles, &Load, MilliSeconds(100));
+  }
+
+  std::vector<double> latencies;
+  latencies.reserve(g_ticks);
+  std::thread carla([&latencies] {
+    for (int64_t tick = 1; tick <= g_ticks; ++tick) {
+      const Clock::time_point start = Clock::now();
+      {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_requested = tick;
+      }
+      g_cv.notify_all();
+      std::unique_lock<std::mutex> lock(g_mutex);
+      g_cv.wait(lock, [tick] { return g_acked >= tick; });
+      latencies.push_back(vanet_test::SecondsSince(start) * 1e6);
+    }
+  });
+  if (gated) {
+    RunGated();
+  } else {
+    RunPerTick();
+  }
+  carla.join();
+  Simulator::Destroy();
+  return latencies;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  int vehicles = 100;
+  g_ticks = 2000;
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("vehicles", "Nodes generating one load event every 100 ms", vehicles);
+  cmd.AddValue("ticks", "CARLA ticks per measurement", g_ticks);
+  cmd.Parse(argc, argv);
+
+  std::printf("%-6s %-9s %12s %12s %12s\n", "rate", "mode", "ticks/s", "mean us", "p99 us");
+  for (double rateHz : {20.0, 100.0}) {
+    for (bool gated : {false, true}) {
+      std::vector<double> latencies = Measure(gated, rateHz, vehicles);
+      VANET_CHECK(static_cast<int64_t>(latencies.size()) == g_ticks);
+      double total = 0;
+      for (double l : latencies) {
+        total += l;
+      }
+      std::sort(latencies.begin(), latencies.end());
+      std::printf("%-6.0f %-9s %12.0f %12.1f %12.1f\n", rateHz, gated ? "gate" : "run/tick",
+                  latencies.size() / (total / 1e6), total / latencies.size(),
+                  latencies[latencies.size() * 99 / 100]);
+    }
+  }
+  return 0;
+}
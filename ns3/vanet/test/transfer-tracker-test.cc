@@ -0,0 +1,193 @@
+// TransferTracker reassembly of fragmented transfers: a transfer is reported exactly
+// once, complete when its last fragment arrives in whatever order, or incomplete
+// once Timeout after its first fragment, or on Flush(); interleaved transfers of
+// different senders, pkt ids and send times stay apart.
+
+#include "transfer-tracker.h"
+#include "vanet-test.h"
+
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+using Completion = TransferTracker::Completion;
+
+struct Recorder {
+  std::vector<Completion> reports;
+  std::vector<Time> at;
+
+  void Attach(TransferTracker& tracker) {
+    tracker.SetCallback([this](const Completion& c) {
+      reports.push_back(c);
+      at.push_back(Simulator::Now());
+    });
+  }
+};
+
+void ReceiveAt(TransferTracker& tracker, Time at, uint32_t senderId, int32_t pktId,
+               uint64_t sendTimeMs, uint16_t index, uint16_t count, uint32_t bytes) {
+  Simulator::Schedule(at - Simulator::Now(), [=, &tracker] {
+    tracker.Receive(senderId, pktId, sendTimeMs, index, count, bytes);
+  });
+}
+
+void RunUntil(Time t) {
+  Simulator::Stop(t - Simulator::Now());
+  Simulator::Run();
+}
+
+void TestSingleAndComplete() {
+  TransferTracker tracker;
+  Recorder rec;
+  rec.Attach(tracker);
+
+  // A single-fragment transfer is reported at once and never stored.
+  tracker.Receive(1, 5, 100, 0, 1, 200);
+  VANET_CHECK(rec.reports.size() == 1 && tracker.GetNPending() == 0);
+  VANET_CHECK(rec.reports[0].complete && rec.reports[0].bytes == 200);
+  VANET_CHECK(rec.reports[0].fragments == 1 && rec.reports[0].received == 1);
+
+  // Three fragments out of order, interleaved with the same pkt id of another sender
+  // and of another send time.
+  ReceiveAt(tracker, MilliSeconds(1), 1, 6, 100, 2, 3, 100);
+  ReceiveAt(tracker, MilliSeconds(2), 2, 6, 100, 0, 2, 50);
+  ReceiveAt(tracker, MilliSeconds(3), 1, 6, 200, 0, 2, 70);
+  ReceiveAt(tracker, MilliSeconds(4), 1, 6, 100, 0, 3, 100);
+  ReceiveAt(tracker, MilliSeconds(5), 1, 6, 100, 1, 3, 60);
+  RunUntil(MilliSeconds(10));
+  VANET_CHECK(rec.reports.size() == 2);
+  const Completion& c = rec.reports[1];
+  VANET_CHECK(c.complete && c.senderId == 1 && c.pktId == 6 && c.sendTimeMs == 100);
+  VANET_CHECK(c.fragments == 3 && c.received == 3 && c.bytes == 260);
+  VANET_CHECK(c.firstRx == MilliSeconds(1) && c.lastRx == MilliSeconds(5));
+  VANET_CHECK(rec.at[1] == MilliSeconds(5));
+  VANET_CHECK(tracker.GetNPending() == 2);
+
+  ReceiveAt(tracker, MilliSeconds(20), 1, 6, 200, 1, 2, 70);
+  ReceiveAt(tracker, MilliSeconds(21), 2, 6, 100, 1, 2, 50);
+  RunUntil(Seconds(5));
+  VANET_CHECK(rec.reports.size() == 4);
+  VANET_CHECK(rec.reports[2].sendTimeMs == 200 && rec.reports[2].bytes == 140);
+  VANET_CHECK(rec.reports[3].senderId == 2 && rec.reports[3].bytes == 100);
+  for (const Completion& r : rec.reports) {
+    VANET_CHECK(r.complete);
+  }
+  VANET_CHECK(tracker.GetNPending() == 0);
+  Simulator::Destroy();
+}
+
+void TestTimeoutAndFlush() {
+  TransferTracker tracker;
+  tracker.SetTimeout(Seconds(1));
+  Recorder rec;
+  rec.Attach(tracker);
+
+  // Lost fragments: reported once, incomplete, one timeout after the first fragment,
+  // even if later fragments kept arriving.
+  ReceiveAt(tracker, MilliSeconds(100), 1, 1, 0, 0, 4, 10);
+  ReceiveAt(tracker, MilliSeconds(600), 1, 1, 0, 2, 4, 10);
+  ReceiveAt(tracker, MilliSeconds(900), 2, 1, 0, 0, 2, 30);
+  RunUntil(MilliSeconds(1099));
+  VANET_CHECK(rec.reports.empty());
+  RunUntil(MilliSeconds(1100));
+  VANET_CHECK(rec.reports.size() == 1);
+  VANET_CHECK(!rec.reports[0].complete && rec.reports[0].received == 2);
+  VANET_CHECK(rec.reports[0].fragments == 4 && rec.reports[0].bytes == 20);
+  VANET_CHECK(rec.reports[0].lastRx == MilliSeconds(600));
+  VANET_CHECK(rec.at[0] == MilliSeconds(100) + Seconds(1));
+
+  // The expiry timer moves on to the next transfer's deadline.
+  RunUntil(MilliSeconds(1899));
+  VANET_CHECK(rec.reports.size() == 1);
+  RunUntil(Seconds(3));
+  VANET_CHECK(rec.reports.size() == 2 && rec.at[1] == MilliSeconds(1900));
+  VANET_CHECK(rec.reports[1].senderId == 2 && !rec.reports[1].complete);
+  VANET_CHECK(tracker.GetNPending() == 0);
+
+  // Flush reports what is pending, once, and cancels the expiry.
+  tracker.Receive(3, 1, 0, 0, 2, 10);
+  tracker.Receive(4, 1, 0, 1, 2, 10);
+  tracker.Flush();
+  VANET_CHECK(rec.reports.size() == 4 && tracker.GetNPending() == 0);
+  VANET_CHECK(rec.reports[2].senderId == 3 && rec.reports[3].senderId == 4);
+  RunUntil(Seconds(10));
+  VANET_CHECK(rec.reports.size() == 4);
+  Simulator::Destroy();
+}
+
+// Many concurrent transfers with shuffled fragments, some of them lossy: every
+// transfer is reported exactly once, complete iff nothing was lost, at its last
+// fragment if complete and one timeout after its first one otherwise.
+void TestRandomized() {
+  constexpr int kTransfers = 2000;
+  TransferTracker tracker;
+  tracker.SetTimeout(Seconds(1));
+  Recorder rec;
+  rec.Attach(tracker);
+  std::mt19937_64 rng(5);
+
+  struct Expected {
+    uint16_t fragments;
+    uint16_t received;
+    uint32_t bytes;
+    Time lastRx;
+  };
+  std::map<std::tuple<uint32_t, int32_t, uint64_t>, Expected> expected;
+  for (int i = 0; i < kTransfers; ++i) {
+    const uint32_t sender = static_cast<uint32_t>(rng() % 20);
+    const int32_t pktId = (rng() % 10 == 0) ? -1 : static_cast<int32_t>(rng() % 50);
+    const uint64_t sendTimeMs = static_cast<uint64_t>(i) * 3;
+    const uint16_t count = static_cast<uint16_t>(1 + rng() % 8);
+    const bool lossy = count > 1 && rng() % 5 == 0;
+    Expected e{count, 0, 0, Time()};
+    for (uint16_t index = 0; index < count; ++index) {
+      if (lossy && index == count - 1) {
+        continue;
+      }
+      const Time at = MilliSeconds(sendTimeMs + 1 + rng() % 200);
+      const uint32_t bytes = static_cast<uint32_t>(1 + rng() % 1500);
+      ReceiveAt(tracker, at, sender, pktId, sendTimeMs, index, count, bytes);
+      ++e.received;
+      e.bytes += bytes;
+      e.lastRx = std::max(e.lastRx, at);
+    }
+    expected[{sender, pktId, sendTimeMs}] = e;
+  }
+  RunUntil(Seconds(100));
+
+  VANET_CHECK(rec.reports.size() == expected.size());
+  VANET_CHECK(tracker.GetNPending() == 0);
+  for (size_t i = 0; i < rec.reports.size(); ++i) {
+    const Completion& c = rec.reports[i];
+    auto it = expected.find({c.senderId, c.pktId, c.sendTimeMs});
+    VANET_CHECK(it != expected.end());  // reported at most once
+    const Expected& e = it->second;
+    VANET_CHECK(c.fragments == e.fragments && c.received == e.received && c.bytes == e.bytes);
+    VANET_CHECK(c.complete == (e.received == e.fragments));
+    VANET_CHECK(c.lastRx == e.lastRx);
+    VANET_CHECK(c.complete ? rec.at[i] == e.lastRx : rec.at[i] == c.firstRx + Seconds(1));
+    expected.erase(it);
+  }
+  VANET_CHECK(expected.empty());
+  Simulator::Destroy();
+}
+
+} // namespace
+
+int main() {
+  TestSingleAndComplete();
+  TestTimeoutAndFlush();
+  TestRandomized();
+  std::cout << "transfer-tracker-test: ok\n";
+  return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef VANET_TEST_H
+#define VANET_TEST_H
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// Minimal check and timing helpers shared by the programs in this directory.
+
+#define VANET_CHECK(cond)                                                          \
+  do {                                                                             \
+    if (!(cond)) {                                                                 \
+      std::cerr << "[ERR] " << __FILE__ << ":" << __LINE__ << ": check failed: "   \
+                << #cond << "\n";                                                  \
+      std::exit(1);                                                                \
+    }                                                                              \
+  } while (0)
+
+#define VANET_CHECK_NEAR(a, b, tolerance) VANET_CHECK(std::abs((a) - (b)) <= (tolerance))
+
+namespace vanet_test {
+
+using Clock = std::chrono::steady_clock;
+
+inline double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keeps the optimizer from discarding a benchmarked result.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace vanet_test
+
+#endif
@@ -0,0 +1,127 @@
+// Slot pooling of VehicleRegistry under CARLA despawn/respawn churn: a full pool
+// stays full, released slots are handed out again (preferably the requested one),
+// growth keeps every binding, and no id ever maps to a slot bound to another id.
+
+#include "vanet-test.h"
+#include "vehicle-registry.h"
+
+#include <cstdint>
+#include <iostream>
+
+using namespace ns3;
+
+namespace {
+
+// Every bound id maps to a slot bound back to it, and the free count matches.
+void CheckConsistent(const VehicleRegistry& registry, int maxId) {
+  uint32_t bound = 0;
+  for (uint32_t slot = 0; slot < registry.GetN(); ++slot) {
+    const int id = registry.GetCarlaId(slot);
+    if (id >= 0) {
+      VANET_CHECK(registry.Find(id) == slot);
+      ++bound;
+    }
+  }
+  for (int id = 0; id <= maxId; ++id) {
+    const uint32_t slot = registry.Find(id);
+    if (slot != VehicleRegistry::kNoSlot) {
+      VANET_CHECK(registry.GetCarlaId(slot) == id);
+    }
+  }
+  VANET_CHECK(registry.GetNFree() == registry.GetN() - bound);
+}
+
+void TestPool() {
+  VehicleRegistry registry;
+  registry.Resize(3);
+  VANET_CHECK(registry.GetNFree() == 3);
+  VANET_CHECK(registry.BindFree(100, 0) == 0);
+  VANET_CHECK(registry.BindFree(101, 1) == 1);
+  VANET_CHECK(registry.BindFree(102, 2) == 2);
+  VANET_CHECK(registry.GetNFree() == 0);
+  VANET_CHECK(registry.BindFree(103, 0) == VehicleRegistry::kNoSlot);
+
+  VANET_CHECK(registry.Release(101) == 1);
+  VANET_CHECK(registry.Release(101) == VehicleRegistry::kNoSlot);
+  VANET_CHECK(registry.Find(101) == VehicleRegistry::kNoSlot);
+  VANET_CHECK(registry.GetNFree() == 1);
+  // The preferred slot is taken, so the freed one is handed out.
+  VANET_CHECK(registry.BindFree(104, 0) == 1);
+  VANET_CHECK(registry.Find(104) == 1);
+  VANET_CHECK(registry.GetNFree() == 0);
+
+  // Growth keeps the bindings; new slots are free, in ascending order.
+  registry.Resize(5);
+  VANET_CHECK(registry.GetNFree() == 2);
+  VANET_CHECK(registry.Find(100) == 0 && registry.Find(104) == 1 && registry.Find(102) == 2);
+  VANET_CHECK(registry.BindFree(105, 99) == 3);
+  VANET_CHECK(registry.BindFree(106, 99) == 4);
+
+  // Bind moves an id and drops the one bound to the target slot.
+  VANET_CHECK(registry.Bind(100, 2));
+  VANET_CHECK(registry.Find(102) == VehicleRegistry::kNoSlot);
+  VANET_CHECK(registry.Find(100) == 2);
+  VANET_CHECK(registry.GetNFree() == 1);
+  VANET_CHECK(registry.BindFree(200, 99) == 0);
+  CheckConsistent(registry, 300);
+
+  VANET_CHECK(!registry.Bind(-1, 0));
+  VANET_CHECK(!registry.Bind(VehicleRegistry::kMaxCarlaId, 0));
+  VANET_CHECK(!registry.Bind(1, registry.GetN()));
+}
+
+void TestChurn() {
+  constexpr uint32_t kSlots = 64;
+  constexpr int kCycles = 20000;
+  VehicleRegistry registry;
+  registry.Resize(kSlots);
+  int nextId = 0;
+  for (uint32_t slot = 0; slot < kSlots; ++slot) {
+    VANET_CHECK(registry.BindFree(nextId++, slot) == slot);
+  }
+
+  // Despawn a live vehicle and spawn a new one in every cycle, the way a long CARLA
+  // session recycles actors; the pool never grows and every slot stays in use.
+  uint32_t victim = 0;
+  for (int cycle = 0; cycle < kCycles; ++cycle) {
+    victim = (victim * 29 + 7) % kSlots;
+    const int departed = registry.GetCarlaId(victim);
+    VANET_CHECK(registry.Release(departed) == victim);
+    registry.SetParked(victim, true);
+    VANET_CHECK(registry.GetNFree() == 1);
+    // The spawned vehicle asks for some other slot and still gets the parked one.
+    const uint32_t slot = registry.BindFree(nextId, (victim + 1) % kSlots);
+    VANET_CHECK(slot == victim);
+    VANET_CHECK(registry.IsParked(slot));
+    registry.SetParked(slot, false);
+    VANET_CHECK(registry.Find(departed) == VehicleRegistry::kNoSlot);
+    VANET_CHECK(registry.Find(nextId) == slot);
+    ++nextId;
+    VANET_CHECK(registry.GetN() == kSlots && registry.GetNFree() == 0);
+  }
+  CheckConsistent(registry, nextId);
+
+  // A burst of despawns followed by a burst of spawns.
+  for (int id = nextId - static_cast<int>(kSlots) / 2; id < nextId; ++id) {
+    if (registry.Find(id) != VehicleRegistry::kNoSlot) {
+      registry.Release(id);
+    }
+  }
+  const uint32_t free = registry.GetNFree();
+  VANET_CHECK(free > 0);
+  for (uint32_t i = 0; i < free; ++i) {
+    VANET_CHECK(registry.BindFree(nextId++, 0) != VehicleRegistry::kNoSlot);
+  }
+  VANET_CHECK(registry.GetNFree() == 0);
+  VANET_CHECK(registry.BindFree(nextId, 0) == VehicleRegistry::kNoSlot);
+  CheckConsistent(registry, nextId);
+}
+
+} // namespace
+
+int main() {
+  TestPool();
+  TestChurn();
+  std::cout << "vehicle-registry-test: ok\n";
+  return 0;
+}
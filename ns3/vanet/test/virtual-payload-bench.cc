@@ -0,0 +1,141 @@
+// Memory and throughput of 64 KB CAM transfers through a real LteRlcUm pair. The
+// transmitting RLC segments each SDU (a CamHeader in front of the payload) into PDUs
+// at MAC transmit opportunities of --pdu bytes; a loopback MAC hands a copy of every
+// PDU, as the PHY would, to the receiving RLC, which reassembles it in
+// LteRlcUm::ReassembleAndDeliver() and delivers it to the bench.
+//
+// Two payloads: real bytes, and a virtual (zero-area) payload as the CAM senders
+// create it. The bytes a delivered SDU holds in memory are the data areas of its
+// buffer, which is what Packet::GetSerializedSize() counts once the tags are gone;
+// zero areas only carry a size. Run it against lte-rlc-um.cc with and without
+// KeepFirstSegment() to compare the reassembly before and after.
+
+#include "geo-networking.h"
+#include "vanet-test.h"
+
+#include "ns3/boolean.h"
+#include "ns3/core-module.h"
+#include "ns3/lte-mac-sap.h"
+#include "ns3/lte-rlc-sap.h"
+#include "ns3/lte-rlc-um.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+constexpr uint16_t kRnti = 1;
+constexpr uint8_t kLcid = 4;
+
+// Passes every PDU of the transmitting RLC straight up to the receiving one.
+class LoopbackMac : public LteMacSapProvider {
+public:
+  explicit LoopbackMac(LteMacSapUser* receiver) : m_receiver(receiver) {}
+
+  void TransmitPdu(TransmitPduParameters params) override {
+    LteMacSapUser::ReceivePduParameters rx;
+    rx.p = params.pdu->Copy();
+    rx.rnti = params.rnti;
+    rx.lcid = params.lcid;
+    m_receiver->ReceivePdu(rx);
+  }
+  void ReportBufferStatus(ReportBufferStatusParameters) override {}
+
+private:
+  LteMacSapUser* m_receiver;
+};
+
+class Sink : public LteRlcSapUser {
+public:
+  void ReceivePdcpPdu(Ptr<Packet> p) override { sdus.push_back(p); }
+  std::vector<Ptr<Packet>> sdus;
+};
+
+Ptr<LteRlcUm> MakeRlc() {
+  Ptr<LteRlcUm> rlc = CreateObject<LteRlcUm>();
+  rlc->SetAttribute("MaxTxBufferSize", UintegerValue(16 * 1024 * 1024));
+  rlc->SetAttribute("EnablePdcpDiscarding", BooleanValue(false));
+  rlc->SetRnti(kRnti);
+  rlc->SetLcId(kLcid);
+  return rlc;
+}
+
+Ptr<Packet> MakeSdu(bool virtualPayload, const std::vector<uint8_t>& bytes, int32_t pktId) {
+  Ptr<Packet> sdu = virtualPayload ? Create<Packet>(bytes.size()) : Create<Packet>(bytes.data(), bytes.size());
+  CamHeader header;
+  header.SetVehicleId(7);
+  header.SetPktId(pktId);
+  sdu->AddHeader(header);
+  return sdu;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t payload = 64 * 1024;
+  uint32_t pduSize = 1500;
+  int transfers = 2000;
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("payload", "Payload bytes per transfer", payload);
+  cmd.AddValue("pdu", "MAC transmit opportunity (RLC PDU) in bytes", pduSize);
+  cmd.AddValue("transfers", "Transfers per configuration", transfers);
+  cmd.Parse(argc, argv);
+  VANET_CHECK(pduSize > 2);
+
+  const std::vector<uint8_t> bytes(payload, 0);
+  std::printf("%-12s %12s %12s %14s\n", "payload", "transfers/s", "MB/s", "held KB/SDU");
+  for (bool virtualPayload : {false, true}) {
+    Ptr<LteRlcUm> tx = MakeRlc();
+    Ptr<LteRlcUm> rx = MakeRlc();
+    LoopbackMac mac(rx->GetLteMacSapUser());
+    Sink sink;
+    tx->SetLteMacSapProvider(&mac);
+    rx->SetLteRlcSapUser(&sink);
+
+    LteMacSapUser::TxOpportunityParameters txOp;
+    txOp.bytes = pduSize;
+    txOp.layer = 0;
+    txOp.harqId = 0;
+    txOp.componentCarrierId = 0;
+    txOp.rnti = kRnti;
+    txOp.lcid = kLcid;
+
+    uint64_t held = 0;
+    const vanet_test::Clock::time_point start = vanet_test::Clock::now();
+    for (int i = 0; i < transfers; ++i) {
+      LteRlcSapProvider::TransmitPdcpPduParameters params;
+      params.pdcpPdu = MakeSdu(virtualPayload, bytes, i);
+      params.rnti = kRnti;
+      params.lcid = kLcid;
+      tx->GetLteRlcSapProvider()->TransmitPdcpPdu(params);
+      // The receiver delivers the SDU with its last PDU (2 bytes of RLC header each).
+      for (uint32_t opportunities = 0; sink.sdus.empty(); ++opportunities) {
+        VANET_CHECK(opportunities <= (payload + 1024) / (pduSize - 2));
+        tx->GetLteMacSapUser()->NotifyTxOpportunity(txOp);
+      }
+      Ptr<Packet> sdu = sink.sdus.front();
+      sink.sdus.clear();
+      sdu->RemoveAllPacketTags();
+      sdu->RemoveAllByteTags();
+      held += sdu->GetSerializedSize();
+      CamHeader header;
+      sdu->RemoveHeader(header);
+      VANET_CHECK(header.GetPktId() == i);
+      VANET_CHECK(sdu->GetSize() == payload);
+      vanet_test::DoNotOptimize(sdu);
+    }
+    const double seconds = vanet_test::SecondsSince(start);
+    std::printf("%-12s %12.0f %12.1f %14.1f\n", virtualPayload ? "virtual" : "bytes", transfers / seconds,
+                static_cast<double>(payload) * transfers / seconds / 1e6,
+                static_cast<double>(held) / transfers / 1024);
+
+    tx->Dispose();
+    rx->Dispose();
+    Simulator::Destroy();
+  }
+  return 0;
+}
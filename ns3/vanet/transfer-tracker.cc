@@ -0,0 +1,86 @@
+#include "transfer-tracker.h"
+
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+void TransferTracker::Receive(uint32_t senderId, int32_t pktId, uint64_t sendTimeMs,
+                              uint16_t /* index */, uint16_t count, uint32_t bytes) {
+  const Time now = Simulator::Now();
+  if (count <= 1) {
+    Completion c;
+    c.senderId = senderId;
+    c.pktId = pktId;
+    c.sendTimeMs = sendTimeMs;
+    c.firstRx = now;
+    c.lastRx = now;
+    c.bytes = bytes;
+    c.fragments = 1;
+    c.received = 1;
+    c.complete = true;
+    Report(c);
+    return;
+  }
+
+  const Key key{senderId, pktId, sendTimeMs};
+  auto [it, inserted] = m_pending.try_emplace(key);
+  Completion& c = it->second;
+  if (inserted) {
+    c.senderId = senderId;
+    c.pktId = pktId;
+    c.sendTimeMs = sendTimeMs;
+    c.firstRx = now;
+    c.fragments = count;
+    m_order.push_back(key);
+    if (!m_expireEvent.IsPending()) {
+      m_expireEvent = Simulator::Schedule(m_timeout, &TransferTracker::Expire, this);
+    }
+  }
+  c.lastRx = now;
+  c.bytes += bytes;
+  ++c.received;
+  if (c.received >= c.fragments) {
+    c.complete = true;
+    Report(c);
+    m_pending.erase(it);
+  }
+}
+
+void TransferTracker::Flush() {
+  for (const Key& key : m_order) {
+    auto it = m_pending.find(key);
+    if (it != m_pending.end()) {
+      Report(it->second);
+    }
+  }
+  m_pending.clear();
+  m_order.clear();
+  m_expireEvent.Cancel();
+}
+
+void TransferTracker::Report(const Completion& c) const {
+  if (m_callback) {
+    m_callback(c);
+  }
+}
+
+void TransferTracker::Expire() {
+  const Time now = Simulator::Now();
+  while (!m_order.empty()) {
+    auto it = m_pending.find(m_order.front());
+    if (it == m_pending.end()) {
+      m_order.pop_front();  // already complete
+      continue;
+    }
+    const Time age = now - it->second.firstRx;
+    if (age < m_timeout) {
+      m_expireEvent = Simulator::Schedule(m_timeout - age, &TransferTracker::Expire, this);
+      return;
+    }
+    Report(it->second);
+    m_pending.erase(it);
+    m_order.pop_front();
+  }
+}
+
+} // namespace ns3
@@ -0,0 +1,79 @@
+#ifndef TRANSFER_TRACKER_H
+#define TRANSFER_TRACKER_H
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+namespace ns3 {
+
+/*
+ * Receiver-side reassembly of transfers that the sender split into several CAM
+ * fragments, so that CARLA gets one record per transfer instead of one per packet.
+ *
+ * A transfer is identified by (sender id, pkt_id, send timestamp ms): every fragment
+ * of it carries the same three, so transfers without a pkt_id (-1) stay apart too.
+ * The record goes out when the last missing fragment arrives, or after Timeout from
+ * the first one (complete = false) if fragments were lost. Single-fragment
+ * transfers are reported right away without being stored.
+ *
+ * Simulator thread only.
+ */
+class TransferTracker {
+public:
+  struct Completion {
+    uint32_t senderId{0};
+    int32_t pktId{-1};
+    uint64_t sendTimeMs{0};
+    Time firstRx;  // first fragment
+    Time lastRx;   // last fragment (complete) or latest one received
+    uint32_t bytes{0};
+    uint16_t fragments{1};
+    uint16_t received{0};
+    bool complete{false};
+  };
+
+  void SetCallback(std::function<void(const Completion&)> callback) { m_callback = callback; }
+  void SetTimeout(Time timeout) { m_timeout = timeout; }
+
+  void Receive(uint32_t senderId, int32_t pktId, uint64_t sendTimeMs,
+               uint16_t index, uint16_t count, uint32_t bytes);
+  // Reports every pending transfer as incomplete, e.g. when the receiver stops.
+  void Flush();
+
+  size_t GetNPending() const { return m_pending.size(); }
+
+private:
+  struct Key {
+    uint32_t senderId;
+    int32_t pktId;
+    uint64_t sendTimeMs;
+    bool operator==(const Key& o) const {
+      return senderId == o.senderId && pktId == o.pktId && sendTimeMs == o.sendTimeMs;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& k) const {
+      uint64_t h = (static_cast<uint64_t>(k.senderId) << 32) ^ static_cast<uint32_t>(k.pktId);
+      h ^= k.sendTimeMs * 0x9E3779B97F4A7C15ULL;
+      return static_cast<size_t>(h ^ (h >> 29));
+    }
+  };
+
+  void Report(const Completion& c) const;
+  void Expire();
+
+  std::function<void(const Completion&)> m_callback;
+  Time m_timeout{Seconds(1)};
+  std::unordered_map<Key, Completion, KeyHash> m_pending;
+  std::deque<Key> m_order;  // oldest first; entries of reported transfers go stale
+  EventId m_expireEvent;
+};
+
+} // namespace ns3
+
+#endif
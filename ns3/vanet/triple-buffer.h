@@ -0,0 +1,54 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace ns3 {
+
+// Wait-free single-writer / single-reader snapshot exchange. The writer fills Back()
+// and Publish()es it; the reader calls Update() and then reads Front(), which always
+// is one complete snapshot. Neither side ever blocks or copies: the three slots only
+// change owners through one atomic exchange of the middle index. Snapshots published
+// between two Update() calls are skipped, the reader only gets the latest one.
+template <typename T>
+class TripleBuffer {
+public:
+  TripleBuffer() = default;
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // Writer only. Holds whatever an older snapshot left behind; overwrite it fully.
+  T& Back() { return m_slots[m_back]; }
+
+  void Publish() {
+    const uint8_t prev = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel);
+    m_back = prev & kIndexMask;
+  }
+
+  // Reader only. Returns true if a newer snapshot became the front.
+  bool Update() {
+    if ((m_middle.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+    const uint8_t prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+    m_front = prev & kIndexMask;
+    return true;
+  }
+
+  const T& Front() const { return m_slots[m_front]; }
+
+private:
+  static constexpr uint8_t kIndexMask = 0x3;
+  static constexpr uint8_t kFresh = 0x4;  // middle slot holds an unread snapshot
+
+  T m_slots[3];
+  alignas(64) uint8_t m_back{0};  // writer
+  alignas(64) std::atomic<uint8_t> m_middle{1};
+  alignas(64) uint8_t m_front{2};  // reader
+};
+
+} // namespace ns3
+
+#endif
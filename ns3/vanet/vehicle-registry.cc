@@ -0,0 +1,127 @@
+#include "vehicle-registry.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+void VehicleRegistry::Resize(uint32_t n) {
+  if (n <= GetN()) {
+    return;
+  }
+  // Pushed highest first so that fresh slots are handed out in ascending order.
+  for (uint32_t slot = n; slot-- > GetN();) {
+    m_free.push_back(slot);
+  }
+  m_carlaId.resize(n, -1);
+  m_position.resize(n);
+  m_velocity.resize(n);
+  m_ip.resize(n);
+  m_l2Id.resize(n, 0);
+  m_mobility.resize(n);
+  m_sender.resize(n);
+  m_receiver.resize(n);
+  m_node.resize(n);
+  m_parked.resize(n, 0);
+}
+
+void VehicleRegistry::SetVehicle(uint32_t slot, Ptr<Node> node, Ipv4Address ip,
+                                 Ptr<CamSender> sender, Ptr<CamReceiver> receiver) {
+  m_node[slot] = node;
+  m_parked[slot] = 0;
+  m_mobility[slot] = node->GetObject<CarlaMobilityModel>();
+  m_ip[slot] = ip;
+  m_sender[slot] = sender;
+  m_receiver[slot] = receiver;
+  if (m_carlaId[slot] >= 0) {
+    sender->SetVehicleId(m_carlaId[slot]);
+    receiver->SetVehicleId(m_carlaId[slot]);
+  }
+}
+
+bool VehicleRegistry::Bind(int carlaId, uint32_t slot) {
+  if (carlaId < 0 || carlaId >= kMaxCarlaId || slot >= GetN()) {
+    return false;
+  }
+  if (static_cast<size_t>(carlaId) >= m_slotOfId.size()) {
+    m_slotOfId.resize(std::max<size_t>(carlaId + 1, m_slotOfId.size() * 2), kNoSlot);
+  }
+  const uint32_t oldSlot = m_slotOfId[carlaId];
+  if (oldSlot != kNoSlot && oldSlot != slot) {
+    m_carlaId[oldSlot] = -1;
+    m_free.push_back(oldSlot);
+    --m_nBound;
+  }
+  const int oldId = m_carlaId[slot];
+  if (oldId >= 0 && oldId != carlaId) {
+    m_slotOfId[oldId] = kNoSlot;
+    --m_nBound;
+  }
+  if (m_carlaId[slot] != carlaId) {
+    ++m_nBound;
+  }
+  m_slotOfId[carlaId] = slot;
+  m_carlaId[slot] = carlaId;
+  if (m_sender[slot]) {
+    m_sender[slot]->SetVehicleId(carlaId);
+  }
+  if (m_receiver[slot]) {
+    m_receiver[slot]->SetVehicleId(carlaId);
+  }
+  return true;
+}
+
+uint32_t VehicleRegistry::BindFree(int carlaId, uint32_t preferred) {
+  if (carlaId < 0 || carlaId >= kMaxCarlaId) {
+    return kNoSlot;
+  }
+  uint32_t slot = kNoSlot;
+  if (preferred < GetN() && m_carlaId[preferred] < 0) {
+    slot = preferred;  // its m_free entry goes stale
+    if (m_free.size() > GetN()) {
+      // Mostly stale entries: rebuild, keeping the ascending hand-out order.
+      m_free.clear();
+      for (uint32_t s = GetN(); s-- > 0;) {
+        if (m_carlaId[s] < 0 && s != preferred) {
+          m_free.push_back(s);
+        }
+      }
+    }
+  } else {
+    while (!m_free.empty()) {
+      const uint32_t candidate = m_free.back();
+      m_free.pop_back();
+      if (m_carlaId[candidate] < 0) {
+        slot = candidate;
+        break;
+      }
+    }
+  }
+  if (slot != kNoSlot) {
+    Bind(carlaId, slot);
+  }
+  return slot;
+}
+
+uint32_t VehicleRegistry::Release(int carlaId) {
+  const uint32_t slot = Find(carlaId);
+  if (slot == kNoSlot) {
+    return kNoSlot;
+  }
+  m_slotOfId[carlaId] = kNoSlot;
+  m_carlaId[slot] = -1;
+  m_free.push_back(slot);
+  --m_nBound;
+  return slot;
+}
+
+bool VehicleRegistry::SetState(uint32_t slot, const VehicleSample& sample, Time sampleTime) {
+  m_position[slot] = sample.position;
+  m_velocity[slot] = sample.velocity;
+  if (!m_mobility[slot]) {
+    return false;
+  }
+  return m_mobility[slot]->SetState(sampleTime, sample.position, sample.velocity,
+                                    sample.acceleration, sample.yawRate);
+}
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+#ifndef VEHICLE_REGISTRY_H
+#define VEHICLE_REGISTRY_H
+
+#include "cam-application.h"
+#include "carla-messages.h"
+#include "carla-mobility-model.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/vector.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * All per-vehicle state of the simulation, addressed by slot (the ns-3 node index).
+ * CARLA ids map to slots through a flat table indexed by the id itself, so a lookup
+ * is one bounds check and one load and never inserts anything. The per-slot state is
+ * kept as parallel arrays, so the per-tick position update walks contiguous memory.
+ *
+ * Slots are pooled: a despawned CARLA id releases its slot, which is parked (radio
+ * detached, applications stopped by the caller) and handed to the next unbound id
+ * with its node, IP and L2 id unchanged.
+ *
+ * Simulator thread only.
+ */
+class VehicleRegistry {
+public:
+  static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+  // CARLA actor ids are small and dense; larger ids are rejected instead of growing
+  // the table without bound.
+  static constexpr int kMaxCarlaId = 1 << 22;
+
+  // Grows to n slots; existing slots and bindings are kept, new slots are unbound.
+  void Resize(uint32_t n);
+  uint32_t GetN() const { return static_cast<uint32_t>(m_carlaId.size()); }
+  // Slots not bound to any CARLA id.
+  uint32_t GetNFree() const { return GetN() - m_nBound; }
+
+  // (Re)attaches the ns-3 side of a slot. A slot that is already bound keeps its
+  // CARLA id, which is pushed to the new sender/receiver.
+  void SetVehicle(uint32_t slot, Ptr<Node> node, Ipv4Address ip, Ptr<CamSender> sender,
+                  Ptr<CamReceiver> receiver);
+  void SetL2Id(uint32_t slot, uint32_t l2Id) { m_l2Id[slot] = l2Id; }
+
+  // Binds carlaId to slot, dropping whatever either of them was bound to before.
+  bool Bind(int carlaId, uint32_t slot);
+  // Binds carlaId to an unbound slot, `preferred` if that one is free. Returns the slot,
+  // or kNoSlot if the pool is exhausted.
+  uint32_t BindFree(int carlaId, uint32_t preferred);
+  // Unbinds carlaId and returns its slot to the pool; kNoSlot if it was not bound.
+  uint32_t Release(int carlaId);
+  // Slot of carlaId, or kNoSlot.
+  uint32_t Find(int carlaId) const {
+    if (carlaId < 0 || static_cast<size_t>(carlaId) >= m_slotOfId.size()) {
+      return kNoSlot;
+    }
+    return m_slotOfId[carlaId];
+  }
+
+  // Stores the latest CARLA state of a slot and hands it to the node's mobility model.
+  // Returns false if the model skipped it as already predicted.
+  bool SetState(uint32_t slot, const VehicleSample& sample, Time sampleTime);
+
+  int GetCarlaId(uint32_t slot) const { return m_carlaId[slot]; }
+  const Vector& GetPosition(uint32_t slot) const { return m_position[slot]; }
+  const Vector& GetVelocity(uint32_t slot) const { return m_velocity[slot]; }
+  Ipv4Address GetIp(uint32_t slot) const { return m_ip[slot]; }
+  uint32_t GetL2Id(uint32_t slot) const { return m_l2Id[slot]; }
+  const Ptr<CamSender>& GetSender(uint32_t slot) const { return m_sender[slot]; }
+  const Ptr<CamReceiver>& GetReceiver(uint32_t slot) const { return m_receiver[slot]; }
+  Ptr<Node> GetNode(uint32_t slot) const { return m_node[slot]; }
+
+  // A parked slot is off the channel until SetParked(slot, false).
+  bool IsParked(uint32_t slot) const { return m_parked[slot] != 0; }
+  void SetParked(uint32_t slot, bool parked) { m_parked[slot] = parked ? 1 : 0; }
+
+private:
+  std::vector<uint32_t> m_slotOfId;  // indexed by CARLA id
+  std::vector<uint32_t> m_free;      // unbound slots; may hold stale entries, checked on pop
+  uint32_t m_nBound{0};
+
+  // Per-slot state, all of length GetN().
+  std::vector<int> m_carlaId;  // -1 while unbound
+  std::vector<Vector> m_position;
+  std::vector<Vector> m_velocity;
+  std::vector<Ipv4Address> m_ip;
+  std::vector<uint32_t> m_l2Id;
+  std::vector<Ptr<CarlaMobilityModel>> m_mobility;
+  std::vector<Ptr<CamSender>> m_sender;
+  std::vector<Ptr<CamReceiver>> m_receiver;
+  std::vector<Ptr<Node>> m_node;
+  std::vector<uint8_t> m_parked;
+};
+
+} // namespace ns3
+
+#endif
@@ -1,5 +1,6 @@
 import json
 import socket
+import struct
 import threading
 import time
 import sys
@@ -7,11 +8,88 @@ from src.common.logger import logger
 from config.settings import NS3_HOST, NS3_SEND_PORT, NS3_RECV_PORT
 from typing import *
 
+# Binary wire format understood by ns3/vanet (see carla-wire-format.h)
+WIRE_MAGIC = 0x334E5343  # "CNS3"
+WIRE_VERSION = 1
+WIRE_HEADER = struct.Struct("<IBBHII")
+WIRE_VEHICLE = struct.Struct("<ii6d")
+WIRE_KINEMATIC_VEHICLE = struct.Struct("<ii10d")
+WIRE_FLAG_KINEMATICS = 0x0001
+WIRE_TRANSFER_SUBCHANNEL = 0x01
+WIRE_TRANSFER_GROUPCAST = 0x02
+WIRE_TRANSFER = struct.Struct("<iiiiBBBxd")
+WIRE_SYNC = struct.Struct("<dd")
+WIRE_DESPAWN = struct.Struct("<i")
+WIRE_TYPES = {
+    "vehicles_position": 1,
+    "transfer_requests": 2,
+    "vehicles_num": 3,
+    "sync_request": 4,
+    "vehicles_despawn": 6,
+    "kpi_request": 7,
+}
+
+
+def encode_binary_message(msg_type: str, data, carla_time: Optional[float] = None) -> bytes:
+    """Encode one message in the length-prefixed binary wire format"""
+    flags = 0
+    if msg_type == "vehicles_position" and carla_time is not None:
+        # Timestamped records with acceleration and yaw rate for dead reckoning
+        zero = {"x": 0.0, "y": 0.0, "z": 0.0}
+        payload = struct.pack("<d", carla_time) + b"".join(
+            WIRE_KINEMATIC_VEHICLE.pack(v["carla_id"], v["id"],
+                                        v["position"]["x"], v["position"]["y"], v["position"]["z"],
+                                        v["velocity"]["x"], v["velocity"]["y"], v["velocity"]["z"],
+                                        v.get("acceleration", zero)["x"], v.get("acceleration", zero)["y"],
+                                        v.get("acceleration", zero)["z"], v.get("yaw_rate", 0.0))
+            for v in data)
+        count = len(data)
+        flags = WIRE_FLAG_KINEMATICS
+    elif msg_type == "vehicles_position":
+        payload = b"".join(
+            WIRE_VEHICLE.pack(v["carla_id"], v["id"],
+                              v["position"]["x"], v["position"]["y"], v["position"]["z"],
+                              v["velocity"]["x"], v["velocity"]["y"], v["velocity"]["z"])
+            for v in data)
+        count = len(data)
+    elif msg_type == "transfer_requests":
+        records = []
+        for r in data:
+            if "targets" in r:
+                raise ValueError("groupcast target lists have no binary encoding, use the JSON wire format")
+            groupcast = "radius" in r
+            # A groupcast carries its radius (whole meters) in the target field
+            target = int(round(r["radius"])) if groupcast else r["target"]
+            flags = (WIRE_TRANSFER_SUBCHANNEL if ("sc_start" in r and "sc_num" in r) else 0) | \
+                    (WIRE_TRANSFER_GROUPCAST if groupcast else 0)
+            records.append(WIRE_TRANSFER.pack(r["source"], target, r["size"], r.get("pkt_id", -1), flags,
+                                              r.get("sc_start", 0), r.get("sc_num", 0), r.get("tx_power", 0.1)))
+        payload = b"".join(records)
+        count = len(data)
+    elif msg_type == "vehicles_num":
+        payload = b""
+        count = int(data)
+    elif msg_type == "sync_request":
+        payload = WIRE_SYNC.pack(data.get("carla_time", 0.0), data.get("request_time", 0.0))
+        count = 1
+    elif msg_type == "vehicles_despawn":
+        payload = b"".join(WIRE_DESPAWN.pack(carla_id) for carla_id in data)
+        count = len(data)
+    elif msg_type == "kpi_request":
+        payload = b""
+        count = 0
+    else:
+        raise ValueError(f"message type {msg_type} has no binary encoding")
+    return WIRE_HEADER.pack(WIRE_MAGIC, WIRE_VERSION, WIRE_TYPES[msg_type], flags, count, len(payload)) + payload
+
+
 class CarlaNs3Bridge:
     """Bridge for communication between CARLA and ns-3 using standard sockets"""
     
-    def __init__(self, ns3_host: str = NS3_HOST, ns3_send_port: int = NS3_SEND_PORT, ns3_recv_port: int = NS3_RECV_PORT):
+    def __init__(self, ns3_host: str = NS3_HOST, ns3_send_port: int = NS3_SEND_PORT, ns3_recv_port: int = NS3_RECV_PORT,
+                 wire_format: str = "json"):
         self.ns3_host = ns3_host
+        self.wire_format = wire_format
         self.ns3_send_port = ns3_send_port
         self.ns3_recv_port = ns3_recv_port
         self.socket = None
@@ -21,6 +99,8 @@ class CarlaNs3Bridge:
         self.reconnect_thread = None
         self.receiver_thread = None
         self.received_messages = []
+        self.last_tick_result = None
+        self.last_kpi = None
 
     def _connect(self) -> bool:
         """Connect to ns-3 server"""
@@ -29,7 +109,13 @@ class CarlaNs3Bridge:
             
         try:
             self.socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            # One message per tick: Nagle would hold it back until ns-3's delayed ACK
+            self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
             self.socket.connect((self.ns3_host, self.ns3_send_port))
+            if self.wire_format == "binary":
+                # The handshake itself is JSON; every frame after it is binary
+                handshake = json.dumps({"type": "wire_format", "wire_format": "binary"})
+                self.socket.sendall((handshake + "\n\r").encode('utf-8'))
             self.connected = True
             return True
         except Exception as e:
@@ -59,23 +145,22 @@ class CarlaNs3Bridge:
             self.receiver_socket.bind((self.ns3_host, self.ns3_recv_port))
             self.receiver_socket.listen(1)
             client_socket, addr = self.receiver_socket.accept()
+            # ns-3 batches its messages, so one recv() may hold several "\r\n"-terminated ones
+            pending = b""
             while self.running:
                 try:
-                    data = client_socket.recv(1024)
-                    if data:
+                    data = client_socket.recv(65536)
+                    if not data:
+                        break
+                    pending += data
+                    *lines, pending = pending.split(b"\r\n")
+                    for line in lines:
                         try:
-                            message = json.loads(data.decode('utf-8'))
-                            if message.get("type") == "simulation_end":
-                                logger.info("Received simulation end signal from NS-3")
-                                self.running = False
-                                break
-                            elif message.get("type") == "cam_received":
-                                receiver_id = message.get("receiver_id")
-                                sender_id = message.get("sender_id")
-                                logger.info(f"Info from NS-3: Vehicle {receiver_id} received msg from Vehicle {sender_id}, " +
-                                            f"msg sent at {message.get('send_timestamp')}, received at {message.get('receive_timestamp')}")
+                            message = json.loads(line.decode('utf-8'))
                         except json.JSONDecodeError:
-                            pass
+                            continue
+                        if not self._handle_ns3_message(message):
+                            break
                     # client_socket.close()
                 except socket.error:
                     break
@@ -94,7 +179,35 @@ class CarlaNs3Bridge:
             self.receiver_thread.daemon = True
             self.receiver_thread.start()
 
-    def send_something_to_ns3(self, msg_type: str, data):
+    def _handle_ns3_message(self, message) -> bool:
+        """Handle one message from ns-3; returns False once the simulation ended"""
+        msg_type = message.get("type")
+        if msg_type == "simulation_end":
+            logger.info("Received simulation end signal from NS-3")
+            self.running = False
+            return False
+        if msg_type == "cam_received":
+            receiver_id = message.get("receiver_id")
+            sender_id = message.get("sender_id")
+            # One record per transfer, after its last fragment (or a timeout if some were lost)
+            logger.info(f"Info from NS-3: Vehicle {receiver_id} received msg from Vehicle {sender_id}, " +
+                        f"pkt_id {message.get('pkt_id')}, " +
+                        f"msg sent at {message.get('send_timestamp')}, received at {message.get('receive_timestamp')}, " +
+                        f"{message.get('fragments_received', 1)}/{message.get('fragments', 1)} fragments")
+        elif msg_type == "link_kpi":
+            self.last_kpi = message
+            logger.info(f"Link KPIs from NS-3 at {message.get('ns3_time')}s: PDR {message.get('pdr')}, " +
+                        f"latency p50/p99 {message['latency_ms']['p50']}/{message['latency_ms']['p99']} ms, " +
+                        f"{message.get('delivered_bps')} bit/s delivered")
+        elif msg_type == "tick_result":
+            self.last_tick_result = message
+            for reception in message.get("receptions", []):
+                self._handle_ns3_message(reception)
+            if "kpi" in message:
+                self._handle_ns3_message(message["kpi"])
+        return True
+
+    def send_something_to_ns3(self, msg_type: str, data, carla_time: Optional[float] = None):
         """Send something to ns-3"""
         if not self.running:
             logger.info("Simulation ended, not sending more vehicle states")
@@ -108,7 +221,12 @@ class CarlaNs3Bridge:
                 return False
         
         try:
+            if self.wire_format == "binary" and msg_type in WIRE_TYPES:
+                self.socket.sendall(encode_binary_message(msg_type, data, carla_time))
+                return True
             message_obj = {"type": msg_type, msg_type: data}
+            if carla_time is not None:
+                message_obj["carla_time"] = carla_time
             message = json.dumps(message_obj)
             self.socket.sendall((message + "\n\r").encode('utf-8'))
             # logger.info(f"Sent {len(message)} bytes to NS-3 successfully")
@@ -144,24 +262,63 @@ class CarlaNs3Bridge:
         """Check if the simulation is running"""
         return self.running
 
+    def send_tick_bundle(self, vehicles: List[Dict], requests: List[Dict], carla_time: float,
+                         vehicles_num: Optional[int] = None, despawned: Optional[List[int]] = None):
+        """
+        Send all inputs of one tick in a single message. ns-3 then answers every
+        tick with one tick_result (ack + receptions) instead of sync_ack and
+        individual cam_received messages.
+        """
+        bundle = {
+            "vehicles_position": vehicles,
+            "transfer_requests": requests,
+            "sync_request": {"carla_time": carla_time, "request_time": time.time()},
+        }
+        if vehicles_num is not None:
+            bundle["vehicles_num"] = vehicles_num
+        if despawned:
+            bundle["vehicles_despawn"] = despawned
+        return self.send_something_to_ns3(msg_type = "tick_bundle", data = bundle)
+
+    def request_kpi(self):
+        """
+        Ask ns-3 (run with --linkKpi=true) for a link_kpi summary now; it arrives
+        through the receiver thread and is kept in last_kpi
+        """
+        self.send_something_to_ns3(msg_type = "kpi_request", data = None)
+
     def send_vehicles_num(self, vehicles_num: int):
         self.send_something_to_ns3(msg_type = "vehicles_num", data = vehicles_num)
 
+    def send_vehicles_despawn(self, carla_ids: List[int]):
+        """
+        carla_ids: ids of destroyed actors; ns-3 parks their UEs and hands them
+        to the next spawned vehicles
+        """
+        self.send_something_to_ns3(msg_type = "vehicles_despawn", data = carla_ids)
+
     def send_transfer_requests(self, requests: List[Dict[str, int]]):
         """
         requests: [{"source":s, "target":t, "size":n}, {...}, ...]
+        A request with "targets": [t1, t2, ...] and/or "radius": meters instead of
+        "target" is sent once as a sidelink groupcast (NR only); cam_received is
+        reported for the listed targets and for every vehicle within the radius
         """
         self.send_something_to_ns3(msg_type = "transfer_requests", data = requests)
 
-    def send_vehicles_position(self, vehicles: List[Dict[str, int]]):
+    def send_vehicles_position(self, vehicles: List[Dict[str, int]], carla_time: Optional[float] = None):
         """
         vehicles: [{
             "id": index,
             "carla_id": vehicle.id,
             "position": position,
             "velocity": velocity_data,
+            "acceleration": acceleration_data,
+            "yaw_rate": yaw_rate,
             "heading": heading,
             "speed": speed
         }, ...]
+        carla_time: simulation time the states were sampled at; ns-3 applies them
+        at exactly that time when time sync is enabled
         """
-        self.send_something_to_ns3(msg_type = "vehicles_position", data = vehicles)
\ No newline at end of file
+        self.send_something_to_ns3(msg_type = "vehicles_position", data = vehicles, carla_time = carla_time)
\ No newline at end of file
@@ -0,0 +1,219 @@
+import ctypes
+import json
+import mmap
+import os
+import struct
+import time
+from src.bridge.carla_ns3_bridge import CarlaNs3Bridge, WIRE_TYPES, WIRE_KINEMATIC_VEHICLE, encode_binary_message
+from src.common.logger import logger
+from typing import *
+
+# Segment layout of ns3/vanet/carla-shm-transport.h (ns-3 runs with --transport=shm)
+SHM_MAGIC = 0x4D534E43  # "CNSM"
+SHM_VERSION = 2
+SHM_SEGMENT = struct.Struct("<IIQI")        # magic, version, size, clientAttached
+SHM_COMMANDS = 64                            # RingControl offsets in the segment
+SHM_RESULTS = 256
+SHM_VEHICLES = 448                           # VehicleTableControl
+RING_HEAD, RING_TAIL, RING_WAKE, RING_SLEEPING, RING_DATA, RING_CAPACITY = 0, 64, 128, 132, 136, 144
+TABLE_SEQ, TABLE_PUBLISHED, TABLE_COUNT, TABLE_TIME, TABLE_CAPACITY, TABLE_DATA = 0, 4, 8, 16, 32, 40
+RECORD_HEADER = struct.Struct("<II")         # length, reserved
+U32 = struct.Struct("<I")
+U64 = struct.Struct("<Q")
+F64 = struct.Struct("<d")
+
+SYS_FUTEX = 202  # x86-64
+FUTEX_WAIT = 0
+FUTEX_WAKE = 1
+RESULT_WAIT_S = 0.01
+
+_libc = ctypes.CDLL(None, use_errno=True)
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+class CarlaNs3ShmBridge(CarlaNs3Bridge):
+    """
+    CarlaNs3Bridge over the shared-memory segment ns-3 creates with --transport=shm
+    instead of the two loopback TCP connections. Vehicle states go into the shared
+    vehicle table; every other message is one record of the command ring, and ns-3's
+    results are read from the result ring. Only for CARLA and ns-3 on the same host.
+
+    Plain Python stores are used for the ring indices: on x86-64 aligned 8-byte stores
+    are atomic and not reordered with each other. A wakeup the consumer misses is
+    covered by its wait timeout.
+    """
+
+    def __init__(self, shm_name: str = "/carla_ns3", wire_format: str = "json"):
+        super().__init__(wire_format = wire_format)
+        self.shm_name = shm_name
+        self.shm = None
+        self._base = 0
+
+    def _connect(self) -> bool:
+        try:
+            fd = os.open("/dev/shm/" + self.shm_name.lstrip("/"), os.O_RDWR)
+            try:
+                size = os.fstat(fd).st_size
+                self.shm = mmap.mmap(fd, size)
+            finally:
+                os.close(fd)
+            magic, version, segment_size, _ = SHM_SEGMENT.unpack_from(self.shm, 0)
+            if magic != SHM_MAGIC or version != SHM_VERSION or segment_size != size:
+                logger.error(f"Shared-memory segment {self.shm_name} has an incompatible layout")
+                self.shm.close()
+                self.shm = None
+                return False
+            anchor = ctypes.c_char.from_buffer(self.shm)
+            self._base = ctypes.addressof(anchor)
+            del anchor  # an exported buffer would keep mmap.close() from working
+            U32.pack_into(self.shm, 16, 1)
+            self.connected = True
+            return True
+        except OSError as e:
+            logger.error(f"Error attaching to shared-memory segment {self.shm_name}: {e}")
+            self.connected = False
+            return False
+
+    # ---- futex-backed rings, same protocol as CarlaShmTransport::RingWrite/RingRead ----
+
+    def _futex(self, offset: int, op: int, value: int, timeout: Optional[float] = None):
+        ts = None
+        if timeout is not None:
+            ts = ctypes.byref(_Timespec(int(timeout), int((timeout % 1) * 1e9)))
+        _libc.syscall(SYS_FUTEX, ctypes.c_void_p(self._base + offset), op, value, ts, None, 0)
+
+    def _wake(self, ring: int):
+        wake_seq = U32.unpack_from(self.shm, ring + RING_WAKE)[0]
+        U32.pack_into(self.shm, ring + RING_WAKE, (wake_seq + 1) & 0xFFFFFFFF)
+        if U32.unpack_from(self.shm, ring + RING_SLEEPING)[0]:
+            self._futex(ring + RING_WAKE, FUTEX_WAKE, 1)
+
+    def _copy_in(self, ring: int, pos: int, data: bytes):
+        capacity = U32.unpack_from(self.shm, ring + RING_CAPACITY)[0]
+        base = U64.unpack_from(self.shm, ring + RING_DATA)[0]
+        offset = pos & (capacity - 1)
+        first = min(len(data), capacity - offset)
+        self.shm[base + offset:base + offset + first] = data[:first]
+        if first < len(data):
+            self.shm[base:base + len(data) - first] = data[first:]
+
+    def _copy_out(self, ring: int, pos: int, length: int) -> bytes:
+        capacity = U32.unpack_from(self.shm, ring + RING_CAPACITY)[0]
+        base = U64.unpack_from(self.shm, ring + RING_DATA)[0]
+        offset = pos & (capacity - 1)
+        first = min(length, capacity - offset)
+        return self.shm[base + offset:base + offset + first] + self.shm[base:base + length - first]
+
+    def _ring_write(self, ring: int, record: bytes) -> bool:
+        need = RECORD_HEADER.size + ((len(record) + 7) & ~7)
+        capacity = U32.unpack_from(self.shm, ring + RING_CAPACITY)[0]
+        head = U64.unpack_from(self.shm, ring + RING_HEAD)[0]
+        tail = U64.unpack_from(self.shm, ring + RING_TAIL)[0]
+        if capacity - (head - tail) < need:
+            return False
+        self._copy_in(ring, head, RECORD_HEADER.pack(len(record), 0) + record)
+        U64.pack_into(self.shm, ring + RING_HEAD, head + need)
+        self._wake(ring)
+        return True
+
+    def _ring_read(self, ring: int) -> Optional[bytes]:
+        tail = U64.unpack_from(self.shm, ring + RING_TAIL)[0]
+        head = U64.unpack_from(self.shm, ring + RING_HEAD)[0]
+        if head == tail:
+            return None
+        length, _ = RECORD_HEADER.unpack(self._copy_out(ring, tail, RECORD_HEADER.size))
+        record = self._copy_out(ring, tail + RECORD_HEADER.size, length)
+        U64.pack_into(self.shm, ring + RING_TAIL, tail + RECORD_HEADER.size + ((length + 7) & ~7))
+        return record
+
+    def _ring_wait(self, ring: int, timeout: float):
+        wake_seq = U32.unpack_from(self.shm, ring + RING_WAKE)[0]
+        U32.pack_into(self.shm, ring + RING_SLEEPING, 1)
+        if U64.unpack_from(self.shm, ring + RING_HEAD)[0] == U64.unpack_from(self.shm, ring + RING_TAIL)[0]:
+            self._futex(ring + RING_WAKE, FUTEX_WAIT, wake_seq, timeout)
+        U32.pack_into(self.shm, ring + RING_SLEEPING, 0)
+
+    def _publish_vehicles(self, vehicles: List[Dict], carla_time: Optional[float]) -> bool:
+        table = SHM_VEHICLES
+        capacity = U32.unpack_from(self.shm, table + TABLE_CAPACITY)[0]
+        if len(vehicles) > capacity:
+            logger.error(f"{len(vehicles)} vehicles exceed the shared table capacity {capacity}")
+            return False
+        buffer = 1 - U32.unpack_from(self.shm, table + TABLE_PUBLISHED)[0]
+        offset = U64.unpack_from(self.shm, table + TABLE_DATA + 8 * buffer)[0]
+        for i, v in enumerate(vehicles):
+            p, vel = v["position"], v["velocity"]
+            acc = v.get("acceleration", {"x": 0.0, "y": 0.0, "z": 0.0})
+            WIRE_KINEMATIC_VEHICLE.pack_into(self.shm, offset + i * WIRE_KINEMATIC_VEHICLE.size,
+                                             v["carla_id"], v["id"], p["x"], p["y"], p["z"],
+                                             vel["x"], vel["y"], vel["z"], acc["x"], acc["y"], acc["z"],
+                                             v.get("yaw_rate", 0.0))
+        U32.pack_into(self.shm, table + TABLE_COUNT + 4 * buffer, len(vehicles))
+        F64.pack_into(self.shm, table + TABLE_TIME + 8 * buffer, -1.0 if carla_time is None else carla_time)
+        U32.pack_into(self.shm, table + TABLE_PUBLISHED, buffer)
+        seq = U32.unpack_from(self.shm, table + TABLE_SEQ)[0]
+        U32.pack_into(self.shm, table + TABLE_SEQ, (seq + 1) & 0xFFFFFFFF)
+        # Let a sleeping ns-3 loop pick the table up even without a following command
+        self._wake(SHM_COMMANDS)
+        return True
+
+    # ---- CarlaNs3Bridge transport hooks ----
+
+    def _listen_for_messages(self):
+        """Read ns-3's results from the result ring"""
+        while self.running and not self.connected:
+            time.sleep(RESULT_WAIT_S)
+        while self.running:
+            record = self._ring_read(SHM_RESULTS)
+            if record is None:
+                self._ring_wait(SHM_RESULTS, RESULT_WAIT_S)
+                continue
+            try:
+                message = json.loads(record.decode('utf-8'))
+            except (json.JSONDecodeError, UnicodeDecodeError):
+                continue
+            if not self._handle_ns3_message(message):
+                break
+
+    def send_something_to_ns3(self, msg_type: str, data, carla_time: Optional[float] = None):
+        if not self.running:
+            logger.info("Simulation ended, not sending more vehicle states")
+            return False
+        if not self.connected and not self._connect():
+            return False
+
+        if msg_type == "vehicles_position":
+            return self._publish_vehicles(data, carla_time)
+        if msg_type == "tick_bundle" and "vehicles_position" in data:
+            # The table is handed to ns-3 before the command records that follow it
+            data = dict(data)
+            self._publish_vehicles(data.pop("vehicles_position"), data["sync_request"]["carla_time"])
+
+        if self.wire_format == "binary" and msg_type in WIRE_TYPES:
+            record = encode_binary_message(msg_type, data, carla_time)
+        else:
+            message_obj = {"type": msg_type, msg_type: data}
+            if carla_time is not None:
+                message_obj["carla_time"] = carla_time
+            record = json.dumps(message_obj).encode('utf-8')
+        # A full command ring means ns-3 is busy; it drains it every few ms
+        deadline = time.monotonic() + 1.0
+        while not self._ring_write(SHM_COMMANDS, record):
+            if time.monotonic() >= deadline:
+                logger.error(f"Shared-memory command ring full, {msg_type} dropped")
+                return False
+            time.sleep(0.0001)
+        return True
+
+    def stop(self):
+        """Detach from the segment; ns-3 owns and removes it"""
+        self.running = False
+        if self.receiver_thread:
+            self.receiver_thread.join(timeout=1.0)
+        if self.shm:
+            U32.pack_into(self.shm, 16, 0)
+            self.shm.close()
+            self.shm = None
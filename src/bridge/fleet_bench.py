@@ -0,0 +1,91 @@
+"""
+Cost of growing the ns-3 fleet while the co-simulation runs.
+
+Start the simulation first, in lockstep so that every tick is answered as soon as it
+is simulated:
+    ns-3-dev/ns3 run scratch/vanet/main.cc -- --lockstep=true
+then, from the project directory:
+    python -m src.bridge.fleet_bench --ns3-pid $(pgrep -f scratch/vanet/main)
+Every step adds --step vehicles to the tick_bundle. ns-3 then creates the UEs of
+the new vehicles before it simulates that tick, so the round trip of the growth tick is
+mostly UE creation. For each fleet size it prints that round trip, the mean round trip
+of the following steady ticks, and, with --ns3-pid, the resident memory of ns-3.
+
+Startup cost and memory of one fleet, e.g. 200 vehicles, with unicast traffic that
+activates sidelink bearers on demand (compare ns-3 runs with --lazySlBearers=false):
+    python -m src.bridge.fleet_bench --start 200 --stop 200 --transfers 50 --ns3-pid <pid>
+"""
+import argparse
+import random
+import time
+from src.bridge.carla_ns3_bridge import CarlaNs3Bridge
+from src.bridge.transport_bench import make_vehicles, with_result_event
+
+TICK_S = 0.05
+
+
+def resident_mb(pid: int) -> float:
+    with open(f"/proc/{pid}/status") as status:
+        for line in status:
+            if line.startswith("VmRSS:"):
+                return int(line.split()[1]) / 1024.0
+    return float("nan")
+
+
+def make_transfers(vehicles: int, count: int, rng: random.Random):
+    """count unicast transfers between random pairs; carla ids as in make_vehicles"""
+    requests = []
+    for _ in range(count):
+        source, target = rng.sample(range(vehicles), 2)
+        requests.append({"source": 100 + source, "target": 100 + target, "size": 200})
+    return requests
+
+
+class Fleet:
+    def __init__(self, bridge, seed: int = 1):
+        self.bridge = bridge
+        self.tick = 0
+        self.rng = random.Random(seed)
+
+    def send(self, vehicles: int, timeout: float, transfers: int = 0) -> float:
+        """One tick with the given fleet and transfers; returns its round trip in ms"""
+        requests = make_transfers(vehicles, transfers, self.rng) if transfers and vehicles > 1 else []
+        self.bridge.tick_done.clear()
+        start = time.perf_counter()
+        self.bridge.send_tick_bundle(make_vehicles(vehicles, self.tick), requests, 1.0 + self.tick * TICK_S,
+                                     vehicles_num = vehicles)
+        if not self.bridge.tick_done.wait(timeout = timeout):
+            raise RuntimeError(f"no tick_result for tick {self.tick} ({vehicles} vehicles)")
+        self.tick += 1
+        return (time.perf_counter() - start) * 1e3
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--start", type=int, default=10, help="initial fleet")
+    parser.add_argument("--stop", type=int, default=500, help="final fleet")
+    parser.add_argument("--step", type=int, default=10, help="vehicles added per step")
+    parser.add_argument("--steady-ticks", type=int, default=5, help="ticks measured after every step")
+    parser.add_argument("--transfers", type=int, default=0,
+                        help="unicast transfers between random pairs in every steady tick")
+    parser.add_argument("--ns3-pid", type=int, help="pid of the ns-3 process, for its resident memory")
+    parser.add_argument("--timeout", type=float, default=600.0, help="longest wait for one tick_result (s)")
+    args = parser.parse_args()
+
+    bridge = with_result_event(CarlaNs3Bridge)()
+    bridge.start()
+    time.sleep(0.5)  # lets ns-3 open its callback connection
+    fleet = Fleet(bridge)
+
+    print(f"{'vehicles':>8} {'growth ms':>10} {'steady ms':>10} {'rss MB':>8}")
+    for vehicles in range(args.start, args.stop + 1, args.step):
+        growth = fleet.send(vehicles, args.timeout)
+        steady = [fleet.send(vehicles, args.timeout, args.transfers) for _ in range(args.steady_ticks)]
+        mean = sum(steady) / len(steady) if steady else float("nan")
+        rss = resident_mb(args.ns3_pid) if args.ns3_pid else float("nan")
+        print(f"{vehicles:>8} {growth:>10.1f} {mean:>10.1f} {rss:>8.1f}", flush = True)
+    bridge.stop()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,88 @@
+"""
+Tick round-trip time of the CARLA -> ns-3 bridge over TCP and over shared memory.
+
+Start the ns-3 side first, either the simulation itself or the stand-in without a
+network simulation (ns3/vanet/test/bridge-echo):
+    ./ns3 run "bridge-echo --transport=shm"
+then, from the project directory:
+    python -m src.bridge.transport_bench --transport shm
+Every tick sends one tick_bundle with the given number of vehicles and waits for its
+tick_result; mean, p50 and p99 of the round trip are printed per fleet size.
+"""
+import argparse
+import threading
+import time
+from src.bridge.carla_ns3_bridge import CarlaNs3Bridge
+from src.bridge.carla_ns3_shm import CarlaNs3ShmBridge
+
+
+def make_vehicles(n: int, tick: int):
+    return [{
+        "id": i,
+        "carla_id": 100 + i,
+        "position": {"x": 10.0 + i * 3.2 + tick * 0.5, "y": -45.5 + i * 0.7, "z": 0.0},
+        "velocity": {"x": 8.3, "y": 0.25, "z": 0.0},
+        "acceleration": {"x": 0.1, "y": 0.0, "z": 0.0},
+        "yaw_rate": 0.01,
+        "heading": 90.0,
+        "speed": 8.3,
+    } for i in range(n)]
+
+
+def with_result_event(bridge_class):
+    """bridge_class whose tick_result wakes a waiting sender instead of being polled"""
+    class Bridge(bridge_class):
+        def __init__(self, *args, **kwargs):
+            super().__init__(*args, **kwargs)
+            self.tick_done = threading.Event()
+
+        def _handle_ns3_message(self, message) -> bool:
+            handled = super()._handle_ns3_message(message)
+            if message.get("type") == "tick_result":
+                self.tick_done.set()
+            return handled
+    return Bridge
+
+
+def measure(bridge, vehicles: int, ticks: int, start_time: float):
+    samples = []
+    for tick in range(ticks):
+        states = make_vehicles(vehicles, tick)
+        bridge.tick_done.clear()
+        start = time.perf_counter()
+        bridge.send_tick_bundle(states, [], start_time + tick * 0.05)
+        if not bridge.tick_done.wait(timeout=5.0):
+            raise RuntimeError(f"no tick_result for tick {tick}")
+        samples.append((time.perf_counter() - start) * 1e6)
+    samples.sort()
+    return sum(samples) / len(samples), samples[len(samples) // 2], samples[len(samples) * 99 // 100]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--transport", choices=["tcp", "shm"], default="tcp")
+    parser.add_argument("--shm-name", default="/carla_ns3")
+    parser.add_argument("--ticks", type=int, default=500)
+    parser.add_argument("--vehicles", type=int, nargs="+", default=[10, 100, 500])
+    args = parser.parse_args()
+
+    if args.transport == "shm":
+        bridge = with_result_event(CarlaNs3ShmBridge)(shm_name = args.shm_name)
+    else:
+        bridge = with_result_event(CarlaNs3Bridge)()
+    bridge.start()
+    time.sleep(0.5)  # lets ns-3 open its callback connection
+
+    print(f"{'vehicles':>8} {'mean us':>10} {'p50 us':>10} {'p99 us':>10}   ({args.transport})")
+    start_time = 1.0
+    for vehicles in args.vehicles:
+        measure(bridge, vehicles, 20, start_time)  # warm-up
+        start_time += 20 * 0.05
+        mean, p50, p99 = measure(bridge, vehicles, args.ticks, start_time)
+        start_time += args.ticks * 0.05
+        print(f"{vehicles:>8} {mean:>10.0f} {p50:>10.0f} {p99:>10.0f}")
+    bridge.stop()
+
+
+if __name__ == '__main__':
+    main()
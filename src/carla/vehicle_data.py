@@ -1,12 +1,16 @@
-from typing import List
+import math
+from typing import List, Optional
 import carla
 from src.common.vehicle_data_logger import vehicle_data_logger
 
-def collect_vehicle_data(vehicles: List[carla.Vehicle]) -> List[dict]:
+def collect_vehicle_data(vehicles: List[carla.Vehicle], snapshot: Optional[carla.WorldSnapshot] = None) -> List[dict]:
     """Collect position and velocity data for all vehicles
     
     Args:
         vehicles: List of carla.Vehicle objects
+        snapshot: World snapshot to read the states from, so that they all belong to
+            snapshot.timestamp (the carla_time sent with them); the actors' latest
+            states if omitted
         
     Returns:
         List of dictionaries containing vehicle data including position, velocity, heading and speed
@@ -14,8 +18,13 @@ def collect_vehicle_data(vehicles: List[carla.Vehicle]) -> List[dict]:
     vehicle_data = []
     
     for index, vehicle in enumerate(vehicles):
-        transform = vehicle.get_transform()
-        velocity = vehicle.get_velocity()
+        state = snapshot.find(vehicle.id) if snapshot is not None else None
+        if state is None:
+            state = vehicle
+        transform = state.get_transform()
+        velocity = state.get_velocity()
+        acceleration = state.get_acceleration()
+        angular_velocity = state.get_angular_velocity()
 
         position = {
             "x": round(transform.location.x, 2),
@@ -29,6 +38,15 @@ def collect_vehicle_data(vehicles: List[carla.Vehicle]) -> List[dict]:
             "z": round(velocity.z, 2)
         }
 
+        acceleration_data = {
+            "x": round(acceleration.x, 2),
+            "y": round(acceleration.y, 2),
+            "z": round(acceleration.z, 2)
+        }
+
+        # CARLA reports deg/s; ns-3 dead-reckons in rad/s
+        yaw_rate = round(math.radians(angular_velocity.z), 4)
+
         heading = round(transform.rotation.yaw, 2)
         speed = round((velocity.x**2 + velocity.y**2 + velocity.z**2)**0.5, 2)
 
@@ -37,6 +55,8 @@ def collect_vehicle_data(vehicles: List[carla.Vehicle]) -> List[dict]:
             "carla_id": vehicle.id,
             "position": position,
             "velocity": velocity_data,
+            "acceleration": acceleration_data,
+            "yaw_rate": yaw_rate,
             "heading": heading,
             "speed": speed
         })